@@ -0,0 +1,137 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/miniconda/lib/cmake/fmt/fmt-config-version.cmake"
+  "/root/miniconda/lib/cmake/fmt/fmt-config.cmake"
+  "/root/miniconda/lib/cmake/fmt/fmt-targets-release.cmake"
+  "/root/miniconda/lib/cmake/fmt/fmt-targets.cmake"
+  "/root/miniconda/lib/cmake/spdlog/spdlogConfig.cmake"
+  "/root/miniconda/lib/cmake/spdlog/spdlogConfigTargets-release.cmake"
+  "/root/miniconda/lib/cmake/spdlog/spdlogConfigTargets.cmake"
+  "/root/miniconda/lib/cmake/spdlog/spdlogConfigVersion.cmake"
+  "/root/repo/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/root/repo/benchmarks/CMakeLists.txt"
+  "/root/repo/cmake/Config.cmake.in"
+  "/root/repo/cmake/DefaultBuildType.cmake"
+  "/root/repo/tests/CMakeLists.txt"
+  "/root/repo/tools/CMakeLists.txt"
+  "/tmp/stubs/lib/cmake/eventpp/eventppConfig.cmake"
+  "/tmp/stubs/lib/cmake/magic_enum/magic_enumConfig.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfig.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfigVersion.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/BoostDetectToolset-1.74.0.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/boost_atomic-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/boost_atomic-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/libboost_atomic-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/libboost_atomic-variant-static.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-static.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/boost_thread-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/boost_thread-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/libboost_thread-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/libboost_thread-variant-static.cmake"
+  "/usr/share/cmake-3.25/Modules/BasicConfigVersion-AnyNewerVersion.cmake.in"
+  "/usr/share/cmake-3.25/Modules/CMakeCInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeFindDependencyMacro.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakePackageConfigHelpers.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFile.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFileCXX.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/FindBoost.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPkgConfig.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/FindZLIB.cmake"
+  "/usr/share/cmake-3.25/Modules/GNUInstallDirs.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  "/usr/share/cmake-3.25/Modules/SelectLibraryConfigurations.cmake"
+  "/usr/share/cmake-3.25/Modules/WriteBasicConfigVersionFile.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "oculus_driverConfig.cmake"
+  "oculus_driverConfigVersion.cmake"
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  "tests/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "tools/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "benchmarks/CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/oculus_driver.dir/DependInfo.cmake"
+  "tests/CMakeFiles/statusraw_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/status_display_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/client_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/async_client_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/config_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/recorder_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/filereader_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/helpers_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/message_pool_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/resync_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/latency_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/kernel_timestamp_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/clock_sync_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/simulator_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/replay_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/manager_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/dispatcher_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/thread_pool_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/scheduling_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/coroutine_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/io_uring_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/send_queue_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/config_request_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/config_transactions_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/trigger_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/demand_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/async_recorder_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/compression_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/sonar_image_codec_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/mmap_reader_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tests/CMakeFiles/file_index_test_oculus_driver_tests.dir/DependInfo.cmake"
+  "tools/CMakeFiles/oculus_simulator.dir/DependInfo.cmake"
+  "tools/CMakeFiles/oculus_replay.dir/DependInfo.cmake"
+  "benchmarks/CMakeFiles/throughput_benchmark.dir/DependInfo.cmake"
+  "benchmarks/CMakeFiles/codec_benchmark.dir/DependInfo.cmake"
+  "benchmarks/CMakeFiles/reader_benchmark.dir/DependInfo.cmake"
+  )
@@ -0,0 +1,44 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/AsyncRecorder.cpp" "CMakeFiles/oculus_driver.dir/src/AsyncRecorder.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/AsyncRecorder.cpp.o.d"
+  "/root/repo/src/AsyncService.cpp" "CMakeFiles/oculus_driver.dir/src/AsyncService.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/AsyncService.cpp.o.d"
+  "/root/repo/src/ClockSync.cpp" "CMakeFiles/oculus_driver.dir/src/ClockSync.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/ClockSync.cpp.o.d"
+  "/root/repo/src/Compression.cpp" "CMakeFiles/oculus_driver.dir/src/Compression.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/Compression.cpp.o.d"
+  "/root/repo/src/ConfigTransactions.cpp" "CMakeFiles/oculus_driver.dir/src/ConfigTransactions.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/ConfigTransactions.cpp.o.d"
+  "/root/repo/src/DemandController.cpp" "CMakeFiles/oculus_driver.dir/src/DemandController.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/DemandController.cpp.o.d"
+  "/root/repo/src/FileIndex.cpp" "CMakeFiles/oculus_driver.dir/src/FileIndex.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/FileIndex.cpp.o.d"
+  "/root/repo/src/IoUringReceiver.cpp" "CMakeFiles/oculus_driver.dir/src/IoUringReceiver.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/IoUringReceiver.cpp.o.d"
+  "/root/repo/src/KernelTimestamp.cpp" "CMakeFiles/oculus_driver.dir/src/KernelTimestamp.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/KernelTimestamp.cpp.o.d"
+  "/root/repo/src/LatencyHistogram.cpp" "CMakeFiles/oculus_driver.dir/src/LatencyHistogram.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/LatencyHistogram.cpp.o.d"
+  "/root/repo/src/MessageDispatcher.cpp" "CMakeFiles/oculus_driver.dir/src/MessageDispatcher.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/MessageDispatcher.cpp.o.d"
+  "/root/repo/src/MessagePool.cpp" "CMakeFiles/oculus_driver.dir/src/MessagePool.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/MessagePool.cpp.o.d"
+  "/root/repo/src/MmapFileReader.cpp" "CMakeFiles/oculus_driver.dir/src/MmapFileReader.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/MmapFileReader.cpp.o.d"
+  "/root/repo/src/ReceiveBuffer.cpp" "CMakeFiles/oculus_driver.dir/src/ReceiveBuffer.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/ReceiveBuffer.cpp.o.d"
+  "/root/repo/src/Recorder.cpp" "CMakeFiles/oculus_driver.dir/src/Recorder.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/Recorder.cpp.o.d"
+  "/root/repo/src/ReplayServer.cpp" "CMakeFiles/oculus_driver.dir/src/ReplayServer.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/ReplayServer.cpp.o.d"
+  "/root/repo/src/SonarClient.cpp" "CMakeFiles/oculus_driver.dir/src/SonarClient.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarClient.cpp.o.d"
+  "/root/repo/src/SonarClientCoroutine.cpp" "CMakeFiles/oculus_driver.dir/src/SonarClientCoroutine.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarClientCoroutine.cpp.o.d"
+  "/root/repo/src/SonarDriver.cpp" "CMakeFiles/oculus_driver.dir/src/SonarDriver.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarDriver.cpp.o.d"
+  "/root/repo/src/SonarImageCodec.cpp" "CMakeFiles/oculus_driver.dir/src/SonarImageCodec.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarImageCodec.cpp.o.d"
+  "/root/repo/src/SonarManager.cpp" "CMakeFiles/oculus_driver.dir/src/SonarManager.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarManager.cpp.o.d"
+  "/root/repo/src/SonarServer.cpp" "CMakeFiles/oculus_driver.dir/src/SonarServer.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarServer.cpp.o.d"
+  "/root/repo/src/SonarSimulator.cpp" "CMakeFiles/oculus_driver.dir/src/SonarSimulator.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/SonarSimulator.cpp.o.d"
+  "/root/repo/src/StatusListener.cpp" "CMakeFiles/oculus_driver.dir/src/StatusListener.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/StatusListener.cpp.o.d"
+  "/root/repo/src/TriggerScheduler.cpp" "CMakeFiles/oculus_driver.dir/src/TriggerScheduler.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/TriggerScheduler.cpp.o.d"
+  "/root/repo/src/print_utils.cpp" "CMakeFiles/oculus_driver.dir/src/print_utils.cpp.o" "gcc" "CMakeFiles/oculus_driver.dir/src/print_utils.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
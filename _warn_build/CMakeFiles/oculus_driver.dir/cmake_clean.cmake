@@ -0,0 +1,61 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/oculus_driver.dir/src/AsyncRecorder.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/AsyncRecorder.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/AsyncService.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/AsyncService.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/ClockSync.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/ClockSync.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/Compression.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/Compression.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/ConfigTransactions.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/ConfigTransactions.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/DemandController.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/DemandController.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/FileIndex.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/FileIndex.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/IoUringReceiver.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/IoUringReceiver.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/KernelTimestamp.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/KernelTimestamp.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/LatencyHistogram.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/LatencyHistogram.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/MessageDispatcher.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/MessageDispatcher.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/MessagePool.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/MessagePool.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/MmapFileReader.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/MmapFileReader.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/ReceiveBuffer.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/ReceiveBuffer.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/Recorder.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/Recorder.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/ReplayServer.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/ReplayServer.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarClient.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarClient.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarClientCoroutine.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarClientCoroutine.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarDriver.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarDriver.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarImageCodec.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarImageCodec.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarManager.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarManager.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarServer.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarServer.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/SonarSimulator.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/SonarSimulator.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/StatusListener.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/StatusListener.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/TriggerScheduler.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/TriggerScheduler.cpp.o.d"
+  "CMakeFiles/oculus_driver.dir/src/print_utils.cpp.o"
+  "CMakeFiles/oculus_driver.dir/src/print_utils.cpp.o.d"
+  "liboculus_driver.pdb"
+  "liboculus_driver.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/oculus_driver.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/codec_benchmark.dir/src/codec_benchmark.cpp.o"
+  "CMakeFiles/codec_benchmark.dir/src/codec_benchmark.cpp.o.d"
+  "codec_benchmark"
+  "codec_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/codec_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reader_benchmark.dir/src/reader_benchmark.cpp.o"
+  "CMakeFiles/reader_benchmark.dir/src/reader_benchmark.cpp.o.d"
+  "reader_benchmark"
+  "reader_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/reader_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/throughput_benchmark.dir/src/throughput_benchmark.cpp.o"
+  "CMakeFiles/throughput_benchmark.dir/src/throughput_benchmark.cpp.o.d"
+  "throughput_benchmark"
+  "throughput_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/throughput_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
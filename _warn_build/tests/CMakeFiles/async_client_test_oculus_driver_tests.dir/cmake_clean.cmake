@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/async_client_test_oculus_driver_tests.dir/src/async_client_test.cpp.o"
+  "CMakeFiles/async_client_test_oculus_driver_tests.dir/src/async_client_test.cpp.o.d"
+  "async_client_test_oculus_driver_tests"
+  "async_client_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/async_client_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/async_recorder_test_oculus_driver_tests.dir/src/async_recorder_test.cpp.o"
+  "CMakeFiles/async_recorder_test_oculus_driver_tests.dir/src/async_recorder_test.cpp.o.d"
+  "async_recorder_test_oculus_driver_tests"
+  "async_recorder_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/async_recorder_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
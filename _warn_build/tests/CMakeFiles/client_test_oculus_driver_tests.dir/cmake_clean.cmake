@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/client_test_oculus_driver_tests.dir/src/client_test.cpp.o"
+  "CMakeFiles/client_test_oculus_driver_tests.dir/src/client_test.cpp.o.d"
+  "client_test_oculus_driver_tests"
+  "client_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/client_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/clock_sync_test_oculus_driver_tests.dir/src/clock_sync_test.cpp.o"
+  "CMakeFiles/clock_sync_test_oculus_driver_tests.dir/src/clock_sync_test.cpp.o.d"
+  "clock_sync_test_oculus_driver_tests"
+  "clock_sync_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/clock_sync_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
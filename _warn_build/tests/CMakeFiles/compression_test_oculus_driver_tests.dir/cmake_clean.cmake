@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/compression_test_oculus_driver_tests.dir/src/compression_test.cpp.o"
+  "CMakeFiles/compression_test_oculus_driver_tests.dir/src/compression_test.cpp.o.d"
+  "compression_test_oculus_driver_tests"
+  "compression_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/compression_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
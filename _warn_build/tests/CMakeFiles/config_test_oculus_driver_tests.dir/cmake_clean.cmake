@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/config_test_oculus_driver_tests.dir/src/config_test.cpp.o"
+  "CMakeFiles/config_test_oculus_driver_tests.dir/src/config_test.cpp.o.d"
+  "config_test_oculus_driver_tests"
+  "config_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/config_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
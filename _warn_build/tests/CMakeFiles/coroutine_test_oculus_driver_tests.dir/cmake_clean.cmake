@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/coroutine_test_oculus_driver_tests.dir/src/coroutine_test.cpp.o"
+  "CMakeFiles/coroutine_test_oculus_driver_tests.dir/src/coroutine_test.cpp.o.d"
+  "coroutine_test_oculus_driver_tests"
+  "coroutine_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coroutine_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/demand_test_oculus_driver_tests.dir/src/demand_test.cpp.o"
+  "CMakeFiles/demand_test_oculus_driver_tests.dir/src/demand_test.cpp.o.d"
+  "demand_test_oculus_driver_tests"
+  "demand_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/demand_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dispatcher_test_oculus_driver_tests.dir/src/dispatcher_test.cpp.o"
+  "CMakeFiles/dispatcher_test_oculus_driver_tests.dir/src/dispatcher_test.cpp.o.d"
+  "dispatcher_test_oculus_driver_tests"
+  "dispatcher_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dispatcher_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/file_index_test_oculus_driver_tests.dir/src/file_index_test.cpp.o"
+  "CMakeFiles/file_index_test_oculus_driver_tests.dir/src/file_index_test.cpp.o.d"
+  "file_index_test_oculus_driver_tests"
+  "file_index_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/file_index_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/filereader_test_oculus_driver_tests.dir/src/filereader_test.cpp.o"
+  "CMakeFiles/filereader_test_oculus_driver_tests.dir/src/filereader_test.cpp.o.d"
+  "filereader_test_oculus_driver_tests"
+  "filereader_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/filereader_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
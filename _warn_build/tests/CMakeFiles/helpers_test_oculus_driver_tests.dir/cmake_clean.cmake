@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/helpers_test_oculus_driver_tests.dir/src/helpers_test.cpp.o"
+  "CMakeFiles/helpers_test_oculus_driver_tests.dir/src/helpers_test.cpp.o.d"
+  "helpers_test_oculus_driver_tests"
+  "helpers_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/helpers_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/io_uring_test_oculus_driver_tests.dir/src/io_uring_test.cpp.o"
+  "CMakeFiles/io_uring_test_oculus_driver_tests.dir/src/io_uring_test.cpp.o.d"
+  "io_uring_test_oculus_driver_tests"
+  "io_uring_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/io_uring_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
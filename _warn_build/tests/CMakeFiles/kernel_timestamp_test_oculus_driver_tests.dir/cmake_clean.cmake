@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/kernel_timestamp_test_oculus_driver_tests.dir/src/kernel_timestamp_test.cpp.o"
+  "CMakeFiles/kernel_timestamp_test_oculus_driver_tests.dir/src/kernel_timestamp_test.cpp.o.d"
+  "kernel_timestamp_test_oculus_driver_tests"
+  "kernel_timestamp_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/kernel_timestamp_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
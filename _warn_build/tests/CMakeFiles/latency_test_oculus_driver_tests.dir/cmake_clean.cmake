@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/latency_test_oculus_driver_tests.dir/src/latency_test.cpp.o"
+  "CMakeFiles/latency_test_oculus_driver_tests.dir/src/latency_test.cpp.o.d"
+  "latency_test_oculus_driver_tests"
+  "latency_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/latency_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/manager_test_oculus_driver_tests.dir/src/manager_test.cpp.o"
+  "CMakeFiles/manager_test_oculus_driver_tests.dir/src/manager_test.cpp.o.d"
+  "manager_test_oculus_driver_tests"
+  "manager_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/manager_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
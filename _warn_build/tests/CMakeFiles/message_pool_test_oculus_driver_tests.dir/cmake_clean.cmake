@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/message_pool_test_oculus_driver_tests.dir/src/message_pool_test.cpp.o"
+  "CMakeFiles/message_pool_test_oculus_driver_tests.dir/src/message_pool_test.cpp.o.d"
+  "message_pool_test_oculus_driver_tests"
+  "message_pool_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/message_pool_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mmap_reader_test_oculus_driver_tests.dir/src/mmap_reader_test.cpp.o"
+  "CMakeFiles/mmap_reader_test_oculus_driver_tests.dir/src/mmap_reader_test.cpp.o.d"
+  "mmap_reader_test_oculus_driver_tests"
+  "mmap_reader_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/mmap_reader_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/recorder_test_oculus_driver_tests.dir/src/recorder_test.cpp.o"
+  "CMakeFiles/recorder_test_oculus_driver_tests.dir/src/recorder_test.cpp.o.d"
+  "recorder_test_oculus_driver_tests"
+  "recorder_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/recorder_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/replay_test_oculus_driver_tests.dir/src/replay_test.cpp.o"
+  "CMakeFiles/replay_test_oculus_driver_tests.dir/src/replay_test.cpp.o.d"
+  "replay_test_oculus_driver_tests"
+  "replay_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/replay_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/resync_test_oculus_driver_tests.dir/src/resync_test.cpp.o"
+  "CMakeFiles/resync_test_oculus_driver_tests.dir/src/resync_test.cpp.o.d"
+  "resync_test_oculus_driver_tests"
+  "resync_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/resync_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
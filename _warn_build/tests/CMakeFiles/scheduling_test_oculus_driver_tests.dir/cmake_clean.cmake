@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scheduling_test_oculus_driver_tests.dir/src/scheduling_test.cpp.o"
+  "CMakeFiles/scheduling_test_oculus_driver_tests.dir/src/scheduling_test.cpp.o.d"
+  "scheduling_test_oculus_driver_tests"
+  "scheduling_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/scheduling_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
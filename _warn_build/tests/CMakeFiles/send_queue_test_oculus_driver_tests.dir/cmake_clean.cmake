@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/send_queue_test_oculus_driver_tests.dir/src/send_queue_test.cpp.o"
+  "CMakeFiles/send_queue_test_oculus_driver_tests.dir/src/send_queue_test.cpp.o.d"
+  "send_queue_test_oculus_driver_tests"
+  "send_queue_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/send_queue_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
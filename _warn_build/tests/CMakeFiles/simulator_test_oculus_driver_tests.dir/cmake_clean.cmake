@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/simulator_test_oculus_driver_tests.dir/src/simulator_test.cpp.o"
+  "CMakeFiles/simulator_test_oculus_driver_tests.dir/src/simulator_test.cpp.o.d"
+  "simulator_test_oculus_driver_tests"
+  "simulator_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/simulator_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sonar_image_codec_test_oculus_driver_tests.dir/src/sonar_image_codec_test.cpp.o"
+  "CMakeFiles/sonar_image_codec_test_oculus_driver_tests.dir/src/sonar_image_codec_test.cpp.o.d"
+  "sonar_image_codec_test_oculus_driver_tests"
+  "sonar_image_codec_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sonar_image_codec_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/status_display_oculus_driver_tests.dir/src/status_display.cpp.o"
+  "CMakeFiles/status_display_oculus_driver_tests.dir/src/status_display.cpp.o.d"
+  "status_display_oculus_driver_tests"
+  "status_display_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/status_display_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/statusraw_test_oculus_driver_tests.dir/src/statusraw_test.cpp.o"
+  "CMakeFiles/statusraw_test_oculus_driver_tests.dir/src/statusraw_test.cpp.o.d"
+  "statusraw_test_oculus_driver_tests"
+  "statusraw_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/statusraw_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
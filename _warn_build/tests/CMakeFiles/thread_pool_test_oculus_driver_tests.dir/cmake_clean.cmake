@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/thread_pool_test_oculus_driver_tests.dir/src/thread_pool_test.cpp.o"
+  "CMakeFiles/thread_pool_test_oculus_driver_tests.dir/src/thread_pool_test.cpp.o.d"
+  "thread_pool_test_oculus_driver_tests"
+  "thread_pool_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/thread_pool_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
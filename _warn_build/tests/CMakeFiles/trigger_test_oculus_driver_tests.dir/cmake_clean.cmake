@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/trigger_test_oculus_driver_tests.dir/src/trigger_test.cpp.o"
+  "CMakeFiles/trigger_test_oculus_driver_tests.dir/src/trigger_test.cpp.o.d"
+  "trigger_test_oculus_driver_tests"
+  "trigger_test_oculus_driver_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/trigger_test_oculus_driver_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/oculus_replay.dir/src/oculus_replay.cpp.o"
+  "CMakeFiles/oculus_replay.dir/src/oculus_replay.cpp.o.d"
+  "oculus_replay"
+  "oculus_replay.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/oculus_replay.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/oculus_simulator.dir/src/oculus_simulator.cpp.o"
+  "CMakeFiles/oculus_simulator.dir/src/oculus_simulator.cpp.o.d"
+  "oculus_simulator"
+  "oculus_simulator.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/oculus_simulator.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
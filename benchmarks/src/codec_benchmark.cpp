@@ -0,0 +1,289 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+// Compression ratio and speed of the .oculus item compressions on the pings
+// of recordings (or on synthetic pings if no file is given), decoding the
+// pings in sequence like FileReader does. Results are written as JSON.
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "oculus_driver/Compression.h"
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarImageCodec.h"
+
+using namespace oculus;
+using Clock = std::chrono::steady_clock;
+
+struct Codec
+{
+    std::string name;
+    Compression compression;
+    int         level;
+};
+
+struct Options
+{
+    unsigned int pingCount  = 200;  // synthetic pings
+    uint16_t     beamCount  = 512;
+    uint16_t     rangeCount = 512;
+    uint8_t      sampleSize = 1;
+    bool         gains      = false;
+    unsigned int keyframeInterval = SonarImageEncoder::DefaultKeyframeInterval;
+    unsigned int repeat     = 3;    // best time of repeat runs
+    std::string  output;            // stdout if empty
+};
+
+// Speckle (exponential intensity) over an attenuation profile, with a few
+// targets drifting from ping to ping.
+static std::vector<uint8_t> make_ping(unsigned int index, const Options& options, uint32_t& seed)
+{
+    uint16_t beamCount  = options.beamCount;
+    uint16_t rangeCount = options.rangeCount;
+    uint8_t  sampleSize = options.sampleSize;
+    uint32_t imageOffset = sizeof(OculusSimplePingResult2) + sizeof(int16_t) * beamCount;
+    uint32_t lineSize    = (options.gains ? 4 : 0) + sampleSize * beamCount;
+    std::vector<uint8_t> data(imageOffset + lineSize * rangeCount, 0);
+
+    OculusSimplePingResult2 ping;
+    std::memset(&ping, 0, sizeof(ping));
+    ping.fireMessage.head.oculusId    = OCULUS_CHECK_ID;
+    ping.fireMessage.head.msgId       = MsgSimplePingResult;
+    ping.fireMessage.head.msgVersion  = 2;
+    ping.fireMessage.head.payloadSize = data.size() - sizeof(OculusMessageHeader);
+    ping.fireMessage.masterMode = 2;
+    ping.fireMessage.range      = 20.0;
+    ping.pingId            = index;
+    ping.frequency         = 1.2e6;
+    ping.speeedOfSoundUsed = 1500.0;
+    ping.pingStartTime     = 0.025 * index;
+    ping.dataSize          = sampleSize == 2 ? ImageData16Bit : ImageData8Bit;
+    ping.rangeResolution   = 20.0 / rangeCount;
+    ping.nRanges           = rangeCount;
+    ping.nBeams            = beamCount;
+    ping.imageOffset       = imageOffset;
+    ping.imageSize         = lineSize * rangeCount;
+    ping.messageSize       = data.size();
+    std::memcpy(data.data(), &ping, sizeof(ping));
+
+    auto bearings = reinterpret_cast<int16_t*>(data.data() + sizeof(ping));
+    for (unsigned int b = 0; b < beamCount; b++) {
+        double s = std::sin(0.5 * 130.0 * M_PI / 180.0) * (2.0 * b / (beamCount - 1) - 1.0);
+        bearings[b] = std::lround(100.0 * std::asin(s) * 180.0 / M_PI);
+    }
+
+    // Beams overlap and ranges are oversampled on a real sonar : the speckle
+    // is averaged over 3 beams and 2 ranges.
+    std::vector<double> speckle((rangeCount + 1) * (beamCount + 2));
+    for (auto& v : speckle) {
+        seed = 1664525*seed + 1013904223;
+        v = -std::log(((seed >> 8) + 1) / 16777217.0);
+    }
+    auto at = [&](unsigned int r, unsigned int b) { return speckle[r*(beamCount + 2) + b]; };
+
+    uint8_t* line = data.data() + imageOffset;
+    for (unsigned int r = 0; r < rangeCount; r++, line += lineSize) {
+        uint8_t* samples = line;
+        if (options.gains) {
+            uint32_t gain = 100 + 2*r;
+            std::memcpy(line, &gain, sizeof(gain));
+            samples += 4;
+        }
+        double profile = 0.3 * std::exp(-3.0 * r / rangeCount);
+        for (unsigned int b = 0; b < beamCount; b++) {
+            double value = profile / 6.0 * (at(r, b) + at(r, b + 1) + at(r, b + 2)
+                                          + at(r + 1, b) + at(r + 1, b + 1) + at(r + 1, b + 2));
+            unsigned int target = (r + 2*index) % 128;
+            if (target < 3 && (b / 40) % 3 == 0)
+                value += 0.6;
+            value = std::min(value, 1.0);
+            if (sampleSize == 2) {
+                uint16_t v = value * 65535;
+                std::memcpy(samples + 2*b, &v, sizeof(v));
+            }
+            else {
+                samples[b] = value * 255;
+            }
+        }
+    }
+    return data;
+}
+
+static std::string run(const Codec& codec, const std::vector<std::vector<uint8_t>>& pings,
+                       const Options& options)
+{
+    std::size_t rawSize = 0;
+    for (const auto& ping : pings) rawSize += ping.size();
+
+    std::vector<std::vector<uint8_t>> encoded(pings.size());
+    double encodeTime = 1.0e9, decodeTime = 1.0e9;
+    for (unsigned int n = 0; n < options.repeat; n++) {
+        SonarImageEncoder encoder(options.keyframeInterval);
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < pings.size(); i++) {
+            if (codec.compression == SonarImage)
+                encoder.encode(pings[i].data(), pings[i].size(), encoded[i]);
+            else
+                compress(codec.compression, pings[i].data(), pings[i].size(),
+                         encoded[i], codec.level);
+        }
+        encodeTime = std::min(encodeTime,
+                              std::chrono::duration<double>(Clock::now() - t0).count());
+    }
+
+    std::vector<uint8_t> decoded;
+    bool match = true;
+    for (unsigned int n = 0; n < options.repeat; n++) {
+        SonarImageDecoder decoder;
+        double elapsed = 0.0;
+        for (std::size_t i = 0; i < pings.size(); i++) {
+            decoded.resize(pings[i].size());
+            auto t0 = Clock::now();
+            if (codec.compression == SonarImage)
+                decoder.decode(encoded[i].data(), encoded[i].size(),
+                               decoded.data(), decoded.size());
+            else
+                decompress(codec.compression, encoded[i].data(), encoded[i].size(),
+                           decoded.data(), decoded.size());
+            elapsed += std::chrono::duration<double>(Clock::now() - t0).count();
+            match = match && decoded == pings[i];
+        }
+        decodeTime = std::min(decodeTime, elapsed);
+    }
+
+    std::size_t codedSize = 0;
+    for (const auto& e : encoded) codedSize += e.size();
+
+    std::ostringstream oss;
+    oss << "    {\"codec\": \"" << codec.name << "\""
+        << ", \"pings\": " << pings.size()
+        << ", \"raw_bytes\": " << rawSize
+        << ", \"coded_bytes\": " << codedSize
+        << ", \"ratio\": " << (double)rawSize / codedSize
+        << ",\n     \"encode_mb_per_s\": " << 1.0e-6 * rawSize / encodeTime
+        << ", \"decode_mb_per_s\": " << 1.0e-6 * rawSize / decodeTime
+        << ", \"decode_pings_per_s\": " << pings.size() / decodeTime
+        << ", \"lossless\": " << (match ? "true" : "false") << "}";
+    return oss.str();
+}
+
+static void print_usage(const char* name)
+{
+    std::cout << "Usage : " << name << " [options] [file.oculus ...]\n"
+        << "Compares the item compressions on the pings of the given recordings, or\n"
+        << "on synthetic pings if no file is given.\n"
+        << "  --pings <n>            synthetic ping count (default : 200)\n"
+        << "  --beams <n>            synthetic beam count (default : 512)\n"
+        << "  --ranges <n>           synthetic range count (default : 512)\n"
+        << "  --16bit                synthetic 16 bits samples\n"
+        << "  --gains                synthetic gains sent with each row\n"
+        << "  --keyframes <n>        SonarImage keyframe interval (default : "
+        << SonarImageEncoder::DefaultKeyframeInterval << ")\n"
+        << "  --repeat <n>           best of n runs (default : 3)\n"
+        << "  --output <file>        JSON output (default : stdout)\n";
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+        if (arg == "--pings")          options.pingCount  = std::stoi(next());
+        else if (arg == "--beams")     options.beamCount  = std::stoi(next());
+        else if (arg == "--ranges")    options.rangeCount = std::stoi(next());
+        else if (arg == "--16bit")     options.sampleSize = 2;
+        else if (arg == "--gains")     options.gains      = true;
+        else if (arg == "--keyframes") options.keyframeInterval = std::stoi(next());
+        else if (arg == "--repeat")    options.repeat     = std::max(1, std::stoi(next()));
+        else if (arg == "--output")    options.output     = next();
+        else if (arg.size() > 0 && arg[0] != '-') files.push_back(arg);
+        else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : -1;
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> pings;
+    std::string source = "synthetic";
+    if (files.empty()) {
+        uint32_t seed = 1;
+        for (unsigned int i = 0; i < options.pingCount; i++) {
+            pings.push_back(make_ping(i, options, seed));
+        }
+    }
+    else {
+        source = "recordings";
+        for (const auto& filename : files) {
+            FileReader reader(filename);
+            while (auto msg = reader.read_next_message()) {
+                if (msg->is_ping_message())
+                    pings.emplace_back(msg->data().begin(), msg->data().end());
+            }
+        }
+    }
+    if (pings.empty()) {
+        std::cerr << "No ping to compress" << std::endl;
+        return -1;
+    }
+
+    std::vector<Codec> codecs = {
+        {"qcompress_1", QCompress, 1},
+        {"qcompress_6", QCompress, 6},
+    };
+    if (compression_supported(Zstd)) {
+        codecs.push_back({"zstd_1", Zstd, 1});
+        codecs.push_back({"zstd_3", Zstd, 3});
+    }
+    codecs.push_back({"sonar_image", SonarImage, -1});
+
+    std::vector<std::string> results;
+    for (const auto& codec : codecs) {
+        results.push_back(run(codec, pings, options));
+    }
+
+    std::ostringstream oss;
+    oss << "{\"benchmark\": \"codec\",\n"
+        << " \"version\": \"" << OCULUS_DRIVER_VERSION << "\",\n"
+        << " \"source\": \"" << source << "\",\n"
+        << " \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        oss << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    oss << "]}\n";
+
+    if (options.output.empty()) {
+        std::cout << oss.str();
+    }
+    else {
+        std::ofstream file(options.output);
+        file << oss.str();
+    }
+    return 0;
+}
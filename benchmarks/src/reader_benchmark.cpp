@@ -0,0 +1,189 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+// Read throughput of FileReader and MmapFileReader over .oculus files (or
+// over a synthetic recording if no file is given). Each ping is touched once
+// (sum of its image) like an analysis would. Results are written as JSON.
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "oculus_driver/MmapFileReader.h"
+#include "oculus_driver/Recorder.h"
+
+using namespace oculus;
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    unsigned int pingCount = 2000;  // synthetic recording
+    unsigned int repeat    = 3;     // best time of repeat runs
+    std::string  output;            // stdout if empty
+};
+
+static uint64_t image_sum(const uint8_t* data, std::size_t size)
+{
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < size; i++) sum += data[i];
+    return sum;
+}
+
+static std::string make_recording(const Options& options)
+{
+    std::string filename = "/tmp/reader_benchmark.oculus";
+    uint16_t beamCount = 512, rangeCount = 512;
+    uint32_t imageOffset = sizeof(OculusSimplePingResult2) + sizeof(int16_t) * beamCount;
+    std::vector<uint8_t> data(imageOffset + beamCount * rangeCount);
+
+    OculusSimplePingResult2 ping;
+    std::memset(&ping, 0, sizeof(ping));
+    ping.fireMessage.head.oculusId    = OCULUS_CHECK_ID;
+    ping.fireMessage.head.msgId       = MsgSimplePingResult;
+    ping.fireMessage.head.msgVersion  = 2;
+    ping.fireMessage.head.payloadSize = data.size() - sizeof(OculusMessageHeader);
+    ping.dataSize    = ImageData8Bit;
+    ping.nRanges     = rangeCount;
+    ping.nBeams      = beamCount;
+    ping.imageOffset = imageOffset;
+    ping.imageSize   = beamCount * rangeCount;
+    ping.messageSize = data.size();
+    std::memcpy(data.data(), &ping, sizeof(ping));
+    for (std::size_t i = imageOffset; i < data.size(); i++) data[i] = i & 0xff;
+
+    Recorder recorder;
+    recorder.open(filename, true);
+    for (unsigned int i = 0; i < options.pingCount; i++) {
+        auto msg = Message::Create(data.size(), data.data(),
+                                   Message::TimePoint(std::chrono::milliseconds(25*i)));
+        recorder.write(msg);
+    }
+    recorder.close();
+    return filename;
+}
+
+struct Result
+{
+    double      time  = 1.0e9;
+    std::size_t pings = 0;
+    std::size_t bytes = 0;
+    uint64_t    sum   = 0;
+};
+
+template <typename Read>
+static Result measure(const Options& options, Read&& read)
+{
+    Result best;
+    for (unsigned int n = 0; n < options.repeat; n++) {
+        Result result;
+        auto t0 = Clock::now();
+        read(result);
+        result.time = std::chrono::duration<double>(Clock::now() - t0).count();
+        if (result.time < best.time) best = result;
+    }
+    return best;
+}
+
+static std::string to_json(const std::string& reader, const Result& result)
+{
+    std::ostringstream oss;
+    oss << "    {\"reader\": \"" << reader << "\""
+        << ", \"pings\": " << result.pings
+        << ", \"bytes\": " << result.bytes
+        << ", \"mb_per_s\": " << 1.0e-6 * result.bytes / result.time
+        << ", \"pings_per_s\": " << result.pings / result.time
+        << ", \"checksum\": " << result.sum << "}";
+    return oss.str();
+}
+
+static void print_usage(const char* name)
+{
+    std::cout << "Usage : " << name << " [options] [file.oculus ...]\n"
+        << "Reads the given recordings (or a synthetic one) with FileReader and\n"
+        << "MmapFileReader. Run it twice to measure with the files in the page cache.\n"
+        << "  --pings <n>            synthetic ping count (default : 2000)\n"
+        << "  --repeat <n>           best of n runs (default : 3)\n"
+        << "  --output <file>        JSON output (default : stdout)\n";
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+        if (arg == "--pings")       options.pingCount = std::stoi(next());
+        else if (arg == "--repeat") options.repeat    = std::max(1, std::stoi(next()));
+        else if (arg == "--output") options.output    = next();
+        else if (arg.size() > 0 && arg[0] != '-') files.push_back(arg);
+        else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : -1;
+        }
+    }
+    if (files.empty())
+        files.push_back(make_recording(options));
+
+    auto fileReader = measure(options, [&](Result& result) {
+        for (const auto& filename : files) {
+            FileReader reader(filename);
+            while (auto msg = reader.read_next_ping()) {
+                result.pings++;
+                result.bytes += msg->data().size();
+                result.sum   += image_sum(msg->ping_data(), msg->ping_data_size());
+            }
+        }
+    });
+    auto mmapReader = measure(options, [&](Result& result) {
+        for (const auto& filename : files) {
+            MmapFileReader reader(filename);
+            while (auto msg = reader.read_next_ping()) {
+                auto ping = msg.ping();
+                result.pings++;
+                result.bytes += msg.data().size();
+                result.sum   += image_sum(ping.ping_data(), ping.ping_data_size());
+            }
+        }
+    });
+
+    std::ostringstream oss;
+    oss << "{\"benchmark\": \"reader\",\n"
+        << " \"version\": \"" << OCULUS_DRIVER_VERSION << "\",\n"
+        << " \"results\": [\n"
+        << to_json("FileReader", fileReader) << ",\n"
+        << to_json("MmapFileReader", mmapReader) << "\n"
+        << "]}\n";
+
+    if (options.output.empty()) {
+        std::cout << oss.str();
+    }
+    else {
+        std::ofstream file(options.output);
+        file << oss.str();
+    }
+    return fileReader.sum == mmapReader.sum ? 0 : -1;
+}
@@ -0,0 +1,324 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+// End-to-end throughput and latency of the receive path : a SonarDriver is
+// connected over loopback to an in-process SonarSimulator, and the driver
+// side is measured. Results are written as JSON.
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+
+using namespace oculus;
+
+struct BenchmarkCase
+{
+    uint16_t                 beamCount;
+    uint8_t                  sampleSize;
+    bool                     gains;
+    SonarClient::FramingMode framing;
+    SonarClient::ReceiveEngine engine;
+};
+
+struct Options
+{
+    double   duration   = 3.0;   // seconds
+    double   warmup     = 0.5;   // seconds
+    double   pingRate   = -1.0;  // Hz, < 0 : as fast as possible
+    uint16_t rangeCount = 512;
+    std::string output;          // stdout if empty
+};
+
+// Heap allocations of the calling thread, to get the number of allocations
+// per message in the driver io thread (like its CPU time).
+static thread_local std::size_t threadAllocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+    threadAllocationCount++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static double thread_cpu_time()
+{
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+static const char* framing_name(SonarClient::FramingMode mode)
+{
+    return mode == SonarClient::Batched ? "batched" : "per_message";
+}
+
+static const char* engine_name(SonarClient::ReceiveEngine engine)
+{
+    switch (engine) {
+        case SonarClient::Coroutine: return "coroutine";
+        case SonarClient::IoUring:   return "io_uring";
+        default:                     return "callbacks";
+    }
+}
+
+static std::string latency_json(const LatencyHistogram& histogram)
+{
+    auto us = [](const LatencyHistogram::Duration& d) { return 1.0e-3 * d.count(); };
+    std::ostringstream oss;
+    oss << "{\"count\": " << histogram.count()
+        << ", \"mean\": "  << us(histogram.mean())
+        << ", \"p50\": "   << us(histogram.percentile(50.0))
+        << ", \"p90\": "   << us(histogram.percentile(90.0))
+        << ", \"p99\": "   << us(histogram.percentile(99.0))
+        << ", \"p999\": "  << us(histogram.percentile(99.9))
+        << ", \"max\": "   << us(histogram.max()) << "}";
+    return oss.str();
+}
+
+std::string run(const BenchmarkCase& c, const Options& options)
+{
+    AsyncService simService(1, "sim_io");
+    SonarSimulator::Settings settings;
+    settings.pingRate   = options.pingRate;
+    settings.beamCount  = c.beamCount;
+    settings.rangeCount = options.rangeCount;
+    settings.sampleSize = c.sampleSize;
+    settings.sendGains  = c.gains ? 1 : 0;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    sonar.set_framing_mode(c.framing);
+    sonar.set_receive_engine(c.engine);
+
+    // Everything below is only accessed from the driver io thread until
+    // ioService.stop() returns.
+    std::atomic<bool> measuring(false);
+    bool              started = false;
+    std::size_t       pingCount = 0;
+    std::size_t       byteCount = 0;
+    double            cpuStart = 0.0, cpuLast = 0.0;
+    std::size_t       allocStart = 0, allocLast = 0;
+    SonarSimulator::Clock::time_point timeStart, timeLast;
+    LatencyHistogram  callbackLatency;
+
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr& ping) {
+        if (!measuring) return;
+        auto now = SonarSimulator::Clock::now();
+        if (!started) {
+            // First ping of the measurement : only a time reference.
+            started   = true;
+            cpuStart  = thread_cpu_time();
+            allocStart = threadAllocationCount;
+            timeStart = now;
+            sonar.reset_latency();
+            return;
+        }
+        auto sent = simulator.boot_time() + std::chrono::duration_cast<
+            SonarSimulator::Clock::duration>(std::chrono::duration<double>(ping->ping_start_time()));
+        callbackLatency.record(now - sent);
+        pingCount++;
+        byteCount += ping->message()->data().size();
+        cpuLast  = thread_cpu_time();
+        allocLast = threadAllocationCount;
+        timeLast = now;
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+    measuring = true;
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+    measuring = false;
+
+    ioService.stop();
+    simService.stop();
+
+    double elapsed = std::chrono::duration<double>(timeLast - timeStart).count();
+    if (pingCount == 0 || elapsed <= 0.0) {
+        std::cerr << "No ping received for " << c.beamCount << " beams, "
+                  << 8*c.sampleSize << " bits, gains " << c.gains << std::endl;
+        elapsed = 1.0;  // to get zeros in the report
+    }
+
+    std::ostringstream oss;
+    oss << "    {\"beams\": " << c.beamCount
+        << ", \"ranges\": " << options.rangeCount
+        << ", \"sample_size\": " << (int)c.sampleSize
+        << ", \"gains\": " << (c.gains ? "true" : "false")
+        << ", \"framing\": \"" << framing_name(c.framing) << "\""
+        << ", \"engine\": \"" << engine_name(c.engine) << "\""
+        << ", \"message_size\": " << simulator.ping_size()
+        << ",\n     \"duration_s\": " << elapsed
+        << ", \"messages\": " << pingCount
+        << ", \"messages_per_s\": " << pingCount / elapsed
+        << ", \"mb_per_s\": " << 1.0e-6 * byteCount / elapsed
+        << ", \"cpu_us_per_ping\": "
+        << (pingCount ? 1.0e6 * (cpuLast - cpuStart) / pingCount : 0.0)
+        << ", \"allocations_per_ping\": "
+        << (pingCount ? (double)(allocLast - allocStart) / pingCount : 0.0)
+        << ", \"skipped_bytes\": " << sonar.skipped_byte_count()
+        << ",\n     \"latency_us\": {\n"
+        << "      \"callback\": " << latency_json(callbackLatency);
+    for (unsigned int s = 0; s < ReceiveLatency::StageCount; s++) {
+        auto stage = static_cast<ReceiveLatency::Stage>(s);
+        oss << ",\n      \"" << ReceiveLatency::stage_name(stage) << "\": "
+            << latency_json(sonar.latency().histogram(stage));
+    }
+    oss << "}}";
+    return oss.str();
+}
+
+static void print_usage(const char* name)
+{
+    std::cout << "Usage : " << name << " [options]\n"
+        << "Runs all combinations of the selected parameters (all by default).\n"
+        << "  --beams <256|512>      beam count\n"
+        << "  --8bit / --16bit       sample size\n"
+        << "  --gains / --no-gains   gains sent with each row\n"
+        << "  --framing <per_message|batched>\n"
+        << "  --engine <callbacks|coroutine|io_uring>\n"
+        << "                         (io_uring only if built with OCULUS_DRIVER_IO_URING,\n"
+        << "                         it ignores the framing mode)\n"
+        << "  --ranges <n>           range count (default : 512, use a small value to\n"
+        << "                         compare the per message overhead of the engines)\n"
+        << "  --rate <Hz>            ping rate (default : as fast as possible, callback\n"
+        << "                         latency then includes queueing on the sender side)\n"
+        << "  --duration <s>         measurement duration per case (default : 3)\n"
+        << "  --warmup <s>           ignored time before measuring (default : 0.5)\n"
+        << "  --output <file>        JSON output (default : stdout)\n";
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    std::vector<uint16_t> beams;
+    std::vector<uint8_t>  sampleSizes;
+    std::vector<bool>     gains;
+    std::vector<SonarClient::FramingMode> framings;
+    std::vector<SonarClient::ReceiveEngine> engines;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+        if (arg == "--beams")         beams.push_back(std::stoi(next()));
+        else if (arg == "--8bit")     sampleSizes.push_back(1);
+        else if (arg == "--16bit")    sampleSizes.push_back(2);
+        else if (arg == "--gains")    gains.push_back(true);
+        else if (arg == "--no-gains") gains.push_back(false);
+        else if (arg == "--framing") {
+            auto value = next();
+            if (value == "batched")          framings.push_back(SonarClient::Batched);
+            else if (value == "per_message") framings.push_back(SonarClient::PerMessage);
+            else throw std::runtime_error("Unknown framing mode : " + value);
+        }
+        else if (arg == "--engine") {
+            auto value = next();
+            if (value == "callbacks")      engines.push_back(SonarClient::Callbacks);
+            else if (value == "coroutine") engines.push_back(SonarClient::Coroutine);
+            else if (value == "io_uring")  engines.push_back(SonarClient::IoUring);
+            else throw std::runtime_error("Unknown receive engine : " + value);
+        }
+        else if (arg == "--ranges")   options.rangeCount = std::stoi(next());
+        else if (arg == "--rate")     options.pingRate   = std::stod(next());
+        else if (arg == "--duration") options.duration   = std::stod(next());
+        else if (arg == "--warmup")   options.warmup     = std::stod(next());
+        else if (arg == "--output")   options.output     = next();
+        else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : -1;
+        }
+    }
+    if (beams.empty())       beams       = {256, 512};
+    if (sampleSizes.empty()) sampleSizes = {1, 2};
+    if (gains.empty())       gains       = {false, true};
+    if (framings.empty())    framings    = {SonarClient::PerMessage, SonarClient::Batched};
+    if (engines.empty()) {
+        engines = {SonarClient::Callbacks, SonarClient::Coroutine};
+        if (IoUringReceiver::is_supported())
+            engines.push_back(SonarClient::IoUring);
+    }
+
+    // Logs would be mixed with the JSON output.
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<std::string> results;
+    for (auto engine : engines) {
+        if (engine == SonarClient::IoUring && !IoUringReceiver::is_supported()) {
+            std::cerr << "io_uring receive is not available" << std::endl;
+            continue;
+        }
+        // (the io_uring engine always frames the messages in batches)
+        auto engineFramings = framings;
+        if (engine == SonarClient::IoUring)
+            engineFramings = {SonarClient::Batched};
+        for (auto framing : engineFramings) {
+            for (auto b : beams) {
+                for (auto s : sampleSizes) {
+                    for (bool g : gains) {
+                        results.push_back(run(BenchmarkCase{b, s, g, framing, engine}, options));
+                    }
+                }
+            }
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "{\"benchmark\": \"throughput\",\n"
+        << " \"version\": \"" << OCULUS_DRIVER_VERSION << "\",\n"
+        << " \"ping_rate\": " << options.pingRate << ",\n"
+        << " \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        oss << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    oss << "]}\n";
+
+    if (options.output.empty()) {
+        std::cout << oss.str();
+    }
+    else {
+        std::ofstream file(options.output);
+        file << oss.str();
+    }
+    return 0;
+}
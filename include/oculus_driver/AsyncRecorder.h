@@ -0,0 +1,172 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oculus_driver/BoundedQueue.h"
+#include "oculus_driver/Compression.h"
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/OculusMessage.h"
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarImageCodec.h"
+
+namespace oculus {
+
+/**
+ * Records messages in a .oculus file (same format as Recorder) from a
+ * dedicated writer thread, so a slow or stalling disk never blocks the
+ * thread receiving the messages.
+ *
+ * write() only queues a reference to the message (messages are never
+ * modified once received, see MessagePool). The writer thread takes all the
+ * queued messages, up to blockSize bytes, and writes them with a single
+ * pwritev() without copying them. What happens when the queue is full
+ * depends on the policy :
+ * - Block      : write() waits for room in the queue (nothing is lost, but
+ *                the receiving thread is slowed down by the disk).
+ * - DropOldest : the oldest queued message is dropped (default).
+ * - DropNewest : the incoming message is dropped.
+ *
+ * With compression enabled (set_compression()), each batch is compressed by
+ * a pool of worker threads (and the writer thread itself) before being
+ * written, the messages stay in the order they were received.
+ *
+ * On a write error, the recording stops (error() tells why) and the
+ * following messages are counted as dropped.
+ */
+class AsyncRecorder
+{
+    public:
+
+    enum Policy { Block, DropOldest, DropNewest };
+
+    struct Stats
+    {
+        std::size_t capacity   = 0;
+        std::size_t queued     = 0;  // messages waiting for the writer
+        std::size_t received   = 0;  // messages given to write()
+        std::size_t written    = 0;
+        std::size_t dropped    = 0;
+        std::size_t bytes      = 0;  // written to the file (with file header)
+        std::size_t rawBytes   = 0;  // size of the written messages before compression
+        std::size_t writeCalls = 0;
+        double      throughput = 0.0;  // bytes per second since open()
+    };
+
+    protected:
+
+    using Clock = std::chrono::steady_clock;
+
+    std::string filename_;
+    int         fd_;
+    off_t       offset_;
+    Policy      policy_;
+    std::size_t blockSize_;
+    std::string error_;
+    Clock::time_point openStamp_;
+
+    BoundedQueue<Message::ConstPtr> queue_;
+    std::thread                     thread_;
+    std::atomic<bool>               running_;
+    std::atomic<bool>               failed_;
+    std::atomic<uint32_t>           writers_;  // write() calls in progress
+    std::atomic<uint32_t>           pushCount_;
+    std::atomic<uint32_t>           popCount_;
+
+    std::atomic<std::size_t> receivedCount_;
+    std::atomic<std::size_t> writtenCount_;
+    std::atomic<std::size_t> droppedCount_;
+    std::atomic<std::size_t> byteCount_;
+    std::atomic<std::size_t> rawByteCount_;
+    std::atomic<std::size_t> writeCallCount_;
+    LatencyHistogram         writeLatency_;  // duration of the pwritev calls
+
+    // Writer thread only.
+    std::vector<Message::ConstPtr>  batch_;
+    std::vector<blueprint::LogItem> items_;
+    std::vector<Recorder::TimeStamp> stamps_;
+    std::vector<iovec>              iovecs_;
+
+    // Compression worker pool. A batch is split in one job per message.
+    Compression                       compression_;
+    int                               compressionLevel_;
+    unsigned int                      workerCount_;
+    std::vector<std::thread>          workers_;
+    std::mutex                        workMutex_;
+    std::condition_variable           workCondition_;
+    std::condition_variable           doneCondition_;
+    uint64_t                          workGeneration_;
+    bool                              stopWorkers_;
+    std::size_t                       jobCount_;
+    std::size_t                       pendingJobs_;
+    unsigned int                      activeWorkers_;
+    std::atomic<std::size_t>          nextJob_;
+    std::vector<std::vector<uint8_t>> compressed_;  // empty : not compressed
+    std::vector<Compression>          itemCompressions_;
+    SonarImageEncoder                 imageEncoder_;  // frames are prepared in order
+    std::vector<SonarImageEncoder::Frame> frames_;
+
+    bool push(const Message::ConstPtr& message);
+    void run();
+    void run_worker();
+    void compress_batch();
+    void run_jobs(std::size_t jobCount);
+    bool write_batch();
+    bool write_all(iovec* iov, int count, std::size_t size);
+
+    public:
+
+    AsyncRecorder(std::size_t capacity = 256, Policy policy = DropOldest,
+                  std::size_t blockSize = 4*1024*1024);
+    ~AsyncRecorder();
+
+    // Throws std::runtime_error if the file cannot be opened.
+    void open(const std::string& filename);
+    // Writes the queued messages and closes the file.
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Compression of the message items, with workerCount threads in addition
+    // to the writer thread. Must be called before open(). Throws
+    // std::runtime_error if the compression is not supported. With
+    // SonarImage, the messages which are not pings use QCompress.
+    void set_compression(Compression compression, int level = -1,
+                         unsigned int workerCount = 2);
+    Compression compression() const { return compression_; }
+
+    // Returns false if the message was dropped.
+    bool write(const Message::ConstPtr& message);
+
+    Policy policy() const { return policy_; }
+    Stats stats() const;
+    const LatencyHistogram& write_latency() const { return writeLatency_; }
+    // Empty if no write error happened (valid after close()).
+    const std::string& error() const { return error_; }
+};
+
+}  // namespace oculus
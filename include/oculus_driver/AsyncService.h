@@ -18,30 +18,115 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <memory>
+#include <vector>
 
 #include <boost/asio.hpp>
 
+#include "oculus_driver/LatencyHistogram.h"
+
 namespace oculus {
 
+/**
+ * Scheduling parameters applied to each AsyncService thread when it starts
+ * (before the ThreadInit callback).
+ *
+ * Real-time policies need the CAP_SYS_NICE capability or a large enough
+ * RLIMIT_RTPRIO ("rtprio" in /etc/security/limits.conf), locking memory needs
+ * CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK. Failures are not fatal : the
+ * thread keeps running with whatever could be applied, and the failure is
+ * printed and kept in the ThreadReport.
+ *
+ * The config is applied to every thread of the service, and handlers are run
+ * by whichever thread is free : with several threads, the receive path of a
+ * given client cannot be pinned to a specific CPU. Pinning a receive path
+ * needs one thread per client (a service with a single thread per client, as
+ * SonarManager::ThreadPerSonar does).
+ */
+struct ThreadSchedulingConfig
+{
+    enum Policy { Inherit, Fifo, RoundRobin };
+
+    Policy           policy     = Inherit;
+    int              priority   = 0;      // 1 to 99 for Fifo and RoundRobin
+    std::vector<int> cpus;                // CPU affinity, empty to leave as is
+    bool             lockMemory = false;  // mlockall(MCL_CURRENT | MCL_FUTURE)
+
+    // Period of a timer measuring how late the io threads wake up (see
+    // AsyncService::wakeup_jitter()). Zero disables the measurement.
+    std::chrono::microseconds jitterProbePeriod = std::chrono::microseconds(0);
+};
+
+/**
+ * Scheduling parameters actually in effect in an AsyncService thread, as read
+ * back from the system after applying a ThreadSchedulingConfig.
+ */
+struct ThreadReport
+{
+    unsigned int             index    = 0;
+    std::string              name;
+    std::string              policy;         // "other", "fifo", "rr", ...
+    int                      priority = 0;
+    std::vector<int>         cpus;
+    bool                     memoryLocked = false;
+    std::vector<std::string> errors;         // empty if all was applied
+};
+
+/**
+ * Runs an io_service in a pool of threads (one by default).
+ *
+ * Handlers of the library objects (SonarClient, StatusListener) are serialized
+ * with strands, so they can safely run on several threads.
+ *
+ * Threads are named "<name>_<index>" and the ThreadInit callback is called in
+ * each thread before it starts running handlers (to set CPU affinity with
+ * set_current_thread_affinity(), scheduling priority, ...).
+ */
 class AsyncService
 {
     public:
 
     using IoService    = boost::asio::io_service;
     using IoServicePtr = std::shared_ptr<IoService>;
+    using WorkGuard    = boost::asio::executor_work_guard<IoService::executor_type>;
+    using ThreadInit   = std::function<void(unsigned int threadIndex)>;
+    using SchedulingConfig = ThreadSchedulingConfig;
+    using Timer        = boost::asio::steady_timer;
 
     protected:
     
-    IoServicePtr service_;
-    std::thread  thread_;
-    bool         isRunning_;
+    IoServicePtr               service_;
+    std::vector<std::thread>   threads_;
+    std::unique_ptr<WorkGuard> work_;
+    bool                       isRunning_;
+    unsigned int               threadCount_;
+    std::string                name_;
+    ThreadInit                 threadInit_;
+    SchedulingConfig           scheduling_;
+
+    mutable std::mutex         reportMutex_;
+    std::condition_variable    reportCondition_;
+    std::vector<ThreadReport>  reports_;
+    unsigned int               reportCount_;
+
+    std::unique_ptr<Timer>     jitterTimer_;
+    uint64_t                   jitterGeneration_;  // bound to the timer handlers
+    LatencyHistogram           wakeupJitter_;
+
+    void run_thread(unsigned int threadIndex);
+    ThreadReport apply_scheduling(unsigned int threadIndex);
+    void jitter_probe_callback(const boost::system::error_code& err, uint64_t generation);
 
     public:
 
-    AsyncService();
+    AsyncService(unsigned int threadCount = 1, const std::string& name = "oculus_io");
     ~AsyncService();
 
     IoServicePtr io_service();
@@ -49,6 +134,29 @@ class AsyncService
     bool is_running() const;
     void start();
     void stop();
+
+    // Both are applied on the next start().
+    unsigned int thread_count() const { return threadCount_; }
+    void set_thread_count(unsigned int count);
+    void set_thread_init(const ThreadInit& init) { threadInit_ = init; }
+
+    // Applied on the next start(). start() returns once every thread has
+    // applied it, so thread_reports() is complete after start().
+    void set_scheduling(const SchedulingConfig& config) { scheduling_ = config; }
+    const SchedulingConfig& scheduling() const { return scheduling_; }
+    std::vector<ThreadReport> thread_reports() const;
+    std::string scheduling_report() const;
+
+    // Lateness of the jitter probe timer (empty if jitterProbePeriod is 0).
+    const LatencyHistogram& wakeup_jitter() const { return wakeupJitter_; }
+
+    const std::string& name() const { return name_; }
+    std::vector<std::thread::native_handle_type> native_handles();
+
+    // Helpers to be used in a ThreadInit callback (or any thread). They
+    // return false on failure (and are no-ops outside of Linux).
+    static bool set_current_thread_name(const std::string& name);
+    static bool set_current_thread_affinity(const std::vector<int>& cpus);
 };
 
 }  // namespace oculus
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace oculus {
+
+/**
+ * Lock-free bounded queue (Dmitry Vyukov's array based MPMC queue).
+ *
+ * Any number of threads can push and pop concurrently. try_push() fails when
+ * the queue is full and try_pop() fails when it is empty, neither ever
+ * blocks. Capacity is rounded up to a power of 2.
+ */
+template <typename T>
+class BoundedQueue
+{
+    protected:
+
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T                        data;
+    };
+
+    static constexpr std::size_t CacheLineSize = 64;
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t             mask_;
+
+    alignas(CacheLineSize) std::atomic<std::size_t> enqueuePos_;
+    alignas(CacheLineSize) std::atomic<std::size_t> dequeuePos_;
+
+    static std::size_t round_capacity(std::size_t capacity) {
+        std::size_t res = 2;
+        while (res < capacity) res <<= 1;
+        return res;
+    }
+
+    public:
+
+    BoundedQueue(std::size_t capacity) :
+        cells_(new Cell[round_capacity(capacity)]),
+        mask_(round_capacity(capacity) - 1),
+        enqueuePos_(0),
+        dequeuePos_(0)
+    {
+        for (std::size_t i = 0; i <= mask_; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&)            = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Approximate when other threads are pushing or popping.
+    std::size_t size() const {
+        auto enqueued = enqueuePos_.load(std::memory_order_relaxed);
+        auto dequeued = dequeuePos_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    template <typename U>
+    bool try_push(U&& value)
+    {
+        Cell* cell;
+        auto pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;  // full
+            }
+            else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        Cell* cell;
+        auto pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;  // empty
+            }
+            else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->data = T();  // releases shared pointers as soon as possible
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+}  // namespace oculus
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace oculus {
+
+/**
+ * Cancels asynchronous requests (see SonarDriver::async_request_ping_config).
+ *
+ * Copies share the same state : calling cancel() on any of them cancels all
+ * the requests started with the others.
+ */
+class CancellationToken
+{
+    public:
+
+    using Callback     = std::function<void()>;
+    using Registration = uint64_t;  // 0 : not registered
+
+    protected:
+
+    struct State
+    {
+        std::mutex                       mutex;
+        bool                             cancelled = false;
+        Registration                     lastRegistration = 0;
+        std::map<Registration, Callback> callbacks;
+    };
+
+    std::shared_ptr<State> state_;
+
+    public:
+
+    CancellationToken() : state_(std::make_shared<State>()) {}
+
+    void cancel() {
+        std::map<Registration, Callback> callbacks;
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            if (state_->cancelled) return;
+            state_->cancelled = true;
+            std::swap(callbacks, state_->callbacks);
+        }
+        for (auto& callback : callbacks) {
+            callback.second();
+        }
+    }
+
+    bool cancelled() const {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        return state_->cancelled;
+    }
+
+    // The callback is called once, in the thread calling cancel() (right away
+    // if the token is already cancelled, 0 is then returned). The
+    // registration must be removed once the request is over, so a token
+    // reused for many requests does not keep their callbacks.
+    Registration on_cancel(const Callback& callback) const {
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            if (!state_->cancelled) {
+                auto registration = ++state_->lastRegistration;
+                state_->callbacks.emplace(registration, callback);
+                return registration;
+            }
+        }
+        callback();
+        return 0;
+    }
+
+    void remove(Registration registration) const {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->callbacks.erase(registration);
+    }
+
+    std::size_t registration_count() const {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        return state_->callbacks.size();
+    }
+};
+
+}  // namespace oculus
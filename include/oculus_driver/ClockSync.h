@@ -0,0 +1,106 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "oculus_driver/OculusMessage.h"
+
+namespace oculus {
+
+/**
+ * Online estimation of the mapping between the sonar clock and the host clock.
+ *
+ * The sonar stamps each ping with pingStartTime, in seconds since power-up.
+ * The host receive time of the same ping is this date plus an unknown but
+ * always positive delay (processing, network, scheduling), which varies from
+ * ping to ping. The mapping host = offset + rate * sonar is estimated on a
+ * sliding window of (sonar, host) pairs :
+ *
+ * - the rate is the slope between the lowest-delay sample of the older half
+ *   of the window and the lowest-delay sample of the newer half (clamped to
+ *   maxSkew around 1),
+ * - the offset is chosen so the line passes through the lowest-delay sample of
+ *   the window (lower envelope of the samples).
+ *
+ * Only the samples with the least delay are used, so delay jitter is removed.
+ * The constant part of the delay (minimum processing and transmission time)
+ * can't be observed and can be given with set_fixed_delay().
+ *
+ * A sonar reboot (sonar time going backward) resets the estimation. Samples
+ * with a prediction error larger than resetThreshold are ignored (a host
+ * side stall would otherwise look like a reboot), the estimation is only
+ * reset after maxOutliers of them in a row.
+ */
+class ClockSync
+{
+    public:
+
+    using TimePoint = Message::TimePoint;
+    using Duration  = TimePoint::duration;
+
+    protected:
+
+    struct Sample {
+        double sonar;  // sonar time (s)
+        double host;   // host time relative to reference_ (s)
+    };
+
+    mutable std::mutex mutex_;
+    std::size_t        windowSize_;
+    double             maxSkew_;
+    double             resetThreshold_;
+    std::size_t        maxOutliers_;
+    double             fixedDelay_;
+
+    TimePoint          reference_;
+    std::deque<Sample> samples_;
+    double             rate_;
+    double             offset_;
+    std::size_t        resetCount_;
+    std::size_t        outlierCount_;  // consecutive
+
+    void reset_locked();
+    void fit();
+
+    public:
+
+    ClockSync(std::size_t windowSize = 256,
+              double maxSkew = 1.0e-3,
+              double resetThreshold = 1.0,
+              std::size_t maxOutliers = 8);
+
+    void reset();
+
+    // Returns false if the sample caused a reset (e.g. sonar reboot).
+    bool update(double sonarTime, const TimePoint& hostTime);
+
+    bool        is_valid() const;
+    std::size_t sample_count() const;
+    std::size_t reset_count() const;
+    double      skew() const;  // rate - 1
+
+    // Constant delay between the ping start and the host receive time.
+    void set_fixed_delay(double seconds);
+
+    TimePoint host_time(double sonarTime) const;
+};
+
+}  // namespace oculus
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace oculus {
+
+/**
+ * Values of the compression field of the .oculus LogItem.
+ *
+ * QCompress is the format of Qt qCompress(), the one written by Oculus
+ * ViewPoint : the uncompressed size as a 4 bytes big-endian integer followed
+ * by a zlib stream. Zstd is not understood by ViewPoint, it is only available
+ * when the library is configured with -DOCULUS_DRIVER_ZSTD=ON. SonarImage is
+ * the ping codec of SonarImageCodec.h (not understood by ViewPoint either).
+ *
+ * With compress() and decompress(), SonarImage pings are always keyframes
+ * (Recorder, AsyncRecorder and FileReader code the pings relative to the
+ * previous one). compress() throws if the data is not a supported ping.
+ */
+enum Compression : uint16_t
+{
+    NoCompression = 0,
+    QCompress     = 1,
+    Zstd          = 2,
+    SonarImage    = 3,
+};
+
+// True if items using this compression can be written and read by this build.
+bool compression_supported(uint16_t compression);
+
+// Compresses size bytes of data into dst (resized to the compressed size).
+// level < 0 selects the default level of the codec. Throws std::runtime_error
+// on failure or if the compression is not supported.
+void compress(Compression compression, const uint8_t* data, std::size_t size,
+              std::vector<uint8_t>& dst, int level = -1);
+
+// Decompresses size bytes of data into dst, which must have room for
+// originalSize bytes (the originalSize field of the LogItem). Throws
+// std::runtime_error if the data is corrupted or does not decompress to
+// exactly originalSize bytes.
+void decompress(uint16_t compression, const uint8_t* data, std::size_t size,
+                uint8_t* dst, std::size_t originalSize);
+
+}  // namespace oculus
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <eventpp/callbacklist.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/Oculus.h"
+
+namespace oculus {
+
+/**
+ * Tracks the configuration changes sent to a sonar, from the moment they are
+ * sent to the first ping whose fireMessage matches them.
+ *
+ * Some changes take a long time to appear in the ping feedback (up to several
+ * seconds for the sound speed). The settle time of each changed field is
+ * recorded in its own histogram, so the dead time after a range or frequency
+ * switch can be measured and planned for.
+ *
+ * Only one transaction is pending at a time : the sonar has a single
+ * configuration, a new request supersedes the pending one (sending the same
+ * request again continues the pending transaction). The pingRate and
+ * networkSpeed fields are not tracked, the sonar does not report them.
+ *
+ * A transaction also ends without being applied when abort() is called
+ * (SonarDriver does it when the connection is lost) or when no matching
+ * feedback came after timeout() (checked by check_timeout(), called by
+ * SonarDriver on each message) : a request rejected by the sonar does not
+ * leave its future pending forever.
+ */
+class ConfigTransactions
+{
+    public:
+
+    using Clock      = std::chrono::steady_clock;
+    using TimePoint  = Clock::time_point;
+    using PingConfig = OculusSimpleFireMessage2;
+
+    enum Field {
+        MasterMode,  // operating frequency
+        GammaCorrection,
+        Flags,
+        Range,
+        Gain,
+        SpeedOfSound,
+        Salinity,
+        FieldCount
+    };
+
+    enum Status {
+        Applied,
+        Superseded,  // by a newer request
+        Aborted,     // abort() called (connection lost)
+        TimedOut     // no matching feedback after timeout()
+    };
+
+    struct Result
+    {
+        uint64_t        id         = 0;
+        bool            applied    = false;  // status == Applied
+        Status          status     = Aborted;
+        uint32_t        fields     = 0;      // changed fields (bit 1 << Field)
+        PingConfig      feedback   = {};     // first matching fireMessage
+        Clock::duration settleTime = Clock::duration::zero();  // send to feedback
+    };
+    using Future               = std::shared_future<Result>;
+    using AppliedCallbacksType = eventpp::CallbackList<void(const Result&)>;
+
+    protected:
+
+    struct Transaction
+    {
+        uint64_t             id;
+        PingConfig           request;
+        uint32_t             fields;
+        uint32_t             pendingFields;
+        TimePoint            sent;
+        std::promise<Result> promise;
+        Future               future;
+    };
+
+    mutable std::mutex           mutex_;
+    std::unique_ptr<Transaction> pending_;
+    uint64_t                     nextId_;
+    std::size_t                  appliedCount_;
+    std::size_t                  supersededCount_;
+    std::size_t                  failedCount_;  // aborted or timed out
+    Clock::duration              timeout_;
+
+    static void resolve(Transaction& transaction, Status status);
+
+    std::array<LatencyHistogram, FieldCount> fieldHistograms_;
+    LatencyHistogram                         totalHistogram_;
+    AppliedCallbacksType                     appliedCallbacks_;
+
+    public:
+
+    ConfigTransactions();
+
+    static const char* field_name(Field field);
+    // Fields differing between two configurations (same tolerances as
+    // config_changed()).
+    static uint32_t changed_fields(const PingConfig& lhs, const PingConfig& rhs);
+
+    // To be called just before sending request, current being the last
+    // configuration reported by the sonar. The future is ready when the
+    // request is applied or superseded.
+    Future begin(const PingConfig& current, const PingConfig& request);
+    // To be called with each new configuration reported by the sonar.
+    void on_feedback(const PingConfig& feedback);
+    // Ends the pending transaction (if any) with the Aborted status.
+    void abort();
+    // Ends the pending transaction with the TimedOut status if it was sent
+    // more than timeout() ago.
+    void check_timeout(const TimePoint& now = Clock::now());
+    void set_timeout(const Clock::duration& timeout);
+    Clock::duration timeout() const;
+
+    bool        pending() const;
+    std::size_t applied_count() const;
+    std::size_t superseded_count() const;
+    std::size_t failed_count() const;
+
+    // Settle time of each field, and of whole transactions.
+    const LatencyHistogram& histogram(Field field) const { return fieldHistograms_[field]; }
+    const LatencyHistogram& total() const { return totalHistogram_; }
+    void reset();
+    std::string summary() const;
+
+    // Called (in the thread reporting the feedback) when a transaction is
+    // applied.
+    AppliedCallbacksType& applied_callbacks() { return appliedCallbacks_; }
+};
+
+}  // namespace oculus
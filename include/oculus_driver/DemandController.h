@@ -0,0 +1,163 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <eventpp/callbacklist.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio.hpp>
+
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/LivenessToken.h"
+#include "oculus_driver/SonarDriver.h"
+
+namespace oculus {
+
+/**
+ * Puts the sonar in standby, or lowers its ping rate, when nobody needs its
+ * pings.
+ *
+ * Consumers get their pings through subscribe(), with the minimum ping rate
+ * they need. The controller requests the slowest PingRateType satisfying all
+ * the subscribers (the full rate if one of them has no minimum), and standby
+ * when no subscriber is left for standby_delay(). A new subscriber is applied
+ * right away, the sonar resumes within one ping period.
+ *
+ * While enabled, the controller owns the ping rate of the sonar :
+ * set_full_rate() replaces SonarDriver::resume(). Subscriptions must not
+ * outlive the controller, which must not outlive the driver. The updates the
+ * controller left in the driver strand are dropped when it is destroyed.
+ */
+class DemandController
+{
+    public:
+
+    using Ptr          = std::shared_ptr<DemandController>;
+    using Clock        = std::chrono::steady_clock;
+    using TimePoint    = Clock::time_point;
+    using PingCallback = std::function<void(const PingMessage::ConstPtr&)>;
+
+    // Unsubscribes when destroyed.
+    class Subscription
+    {
+        public:
+
+        using Ptr = std::shared_ptr<Subscription>;
+
+        protected:
+
+        friend class DemandController;
+
+        DemandController&                          controller_;
+        uint64_t                                   id_;
+        double                                     minRate_;
+        SonarDriver::PingCallbacksType::Handle     handle_;
+
+        public:
+
+        Subscription(DemandController& controller, uint64_t id, double minRate);
+        ~Subscription();
+
+        double min_rate() const { return minRate_; }
+    };
+
+    struct Transition
+    {
+        TimePoint   stamp;
+        uint8_t     from;  // UnknownRate after a (re)connection
+        uint8_t     to;
+        std::size_t subscribers;
+    };
+    using TransitionCallbacksType = eventpp::CallbackList<void(const Transition&)>;
+
+    struct Stats
+    {
+        std::size_t     subscribers = 0;
+        uint8_t         rate        = 0;  // last requested PingRateType
+        std::size_t     transitions = 0;
+        std::size_t     standbys    = 0;
+        std::size_t     resumes     = 0;
+        Clock::duration standbyTime = Clock::duration::zero();  // in standby, total
+    };
+
+    static constexpr uint8_t UnknownRate = 0xff;
+
+    protected:
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    SonarDriver&                              driver_;
+    boost::asio::steady_timer                 standbyTimer_;
+    SonarDriver::PingCallbacksType::Handle    pingHandle_;
+    SonarClient::ConnectCallbacksType::Handle connectHandle_;
+
+    mutable std::mutex           mutex_;
+    std::map<uint64_t, double>   demands_;  // minimum rate of each subscriber
+    uint64_t                     nextId_;
+    uint8_t                      fullRate_;
+    Clock::duration              standbyDelay_;
+    bool                         enabled_;
+    Stats                        stats_;
+
+    // Strand only
+    uint8_t   currentRate_;
+    bool      standbyPending_;
+    uint64_t  standbyId_;
+    bool      resuming_;
+    TimePoint resumeStamp_;
+    TimePoint standbyStart_;
+
+    LatencyHistogram        resumeLatency_;  // resume request -> first ping
+    TransitionCallbacksType transitionCallbacks_;
+
+    LivenessToken alive_;  // guards the handlers capturing this
+
+    uint8_t target_rate() const;
+    void update();
+    void apply(uint8_t rate);
+    void remove(uint64_t id);
+    void on_ping();
+    void on_connect();
+
+    public:
+
+    DemandController(SonarDriver& driver, const std::shared_ptr<spdlog::logger>& logger);
+    ~DemandController();
+
+    // minRate in Hz, 0 : any rate (the full rate is used). The callback may
+    // be empty (the subscription then only keeps the sonar pinging).
+    Subscription::Ptr subscribe(const PingCallback& callback, double minRate = 0.0);
+
+    // Rate used when a subscriber has no minimum rate.
+    void set_full_rate(uint8_t rate);
+    void set_standby_delay(const Clock::duration& delay);
+    void set_enabled(bool enabled);
+
+    Stats stats() const;
+    const LatencyHistogram& resume_latency() const { return resumeLatency_; }
+    TransitionCallbacksType& transition_callbacks() { return transitionCallbacks_; }
+};
+
+}  // namespace oculus
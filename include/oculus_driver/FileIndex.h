@@ -0,0 +1,133 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "oculus_driver/OculusMessage.h"
+
+namespace oculus {
+
+/**
+ * Table of the messages of a .oculus file, to reach a ping by its index or by
+ * its timestamp without reading the file from the start (see
+ * FileReader::seek()).
+ *
+ * Building the index reads the item headers and only the start of the
+ * message payloads (the ping metadata), the images are skipped. QCompress
+ * and Zstd items have to be decompressed completely, SonarImage items only
+ * have their metadata decoded. The index can be saved next to the recording
+ * (sidecar file, recording.oculus.index) : it is reused as long as the size
+ * and the modification time of the recording do not change.
+ */
+class FileIndex
+{
+    public:
+
+    using Ptr      = std::shared_ptr<FileIndex>;
+    using ConstPtr = std::shared_ptr<const FileIndex>;
+
+    static constexpr uint32_t MagicNumber = 0x5844494f;  // "OIDX"
+    static constexpr uint16_t Version     = 1;
+
+    enum Flags : uint16_t
+    {
+        Ping     = 0x1,  // MsgSimplePingResult
+        Keyframe = 0x2,  // can be decompressed without the previous messages
+    };
+
+    // One per message item (rt_oculusSonar), in file order.
+    struct Entry
+    {
+        uint64_t offset;       // position of the item in the file
+        int64_t  stamp;        // message timestamp, in nanoseconds
+        uint32_t pingId;       // 0 if not a ping
+        uint32_t configHash;   // see config_hash(), 0 if not a ping
+        uint16_t messageId;    // OculusMessageType
+        uint16_t compression;
+        uint16_t flags;
+        uint16_t reserved;
+
+        bool is_ping()     const { return flags & Ping; }
+        bool is_keyframe() const { return flags & Keyframe; }
+        Message::TimePoint timestamp() const {
+            return Message::TimePoint(std::chrono::duration_cast<Message::TimePoint::duration>(
+                std::chrono::nanoseconds(stamp)));
+        }
+    };
+
+    protected:
+
+    std::vector<Entry>    entries_;
+    std::vector<uint32_t> pings_;        // entries of the pings
+    std::vector<uint32_t> decodeStarts_; // see decode_start()
+    bool                  timeOrdered_;  // ping stamps never go backward
+    uint64_t              fileSize_;     // of the indexed recording
+    int64_t               fileTime_;     // modification time of the recording (ns)
+
+    void update_lookups();
+
+    public:
+
+    FileIndex();
+
+    // Reads the whole recording. Throws std::runtime_error if it cannot be
+    // read (an incomplete item at the end of the file is ignored).
+    static Ptr build(const std::string& filename);
+    static Ptr load(const std::string& indexFilename);
+    // Loads the sidecar file of the recording if it is up to date, builds the
+    // index otherwise (and writes the sidecar file if save is true, a failure
+    // to write it is only reported).
+    static Ptr load_or_build(const std::string& filename, bool save = true);
+    static std::string sidecar_filename(const std::string& filename) {
+        return filename + ".index";
+    }
+    void save(const std::string& indexFilename) const;
+
+    // True if this index was built from filename as it is now.
+    bool is_up_to_date(const std::string& filename) const;
+
+    // Hash of what identifies the configuration of a ping : the fire message
+    // fields checked by config_changed() (except the ping rate) and the
+    // image layout. 0 if data is not a ping.
+    static uint32_t config_hash(const uint8_t* data, std::size_t size);
+
+    const std::vector<Entry>& entries() const { return entries_; }
+    std::size_t message_count() const { return entries_.size(); }
+    std::size_t ping_count()    const { return pings_.size(); }
+
+    // Entry index of a ping.
+    std::size_t ping_entry(std::size_t pingIndex) const { return pings_[pingIndex]; }
+    const Entry& ping(std::size_t pingIndex)      const { return entries_[pings_[pingIndex]]; }
+
+    // Index of the first ping stamped at or after stamp (ping_count() if
+    // there is none).
+    std::size_t find_ping(const Message::TimePoint& stamp) const;
+
+    // First entry a reader moved to entryIndex must decompress (SonarImage
+    // prefixes only) for the following entries to be readable : the last
+    // SonarImage keyframe before it, or entryIndex itself if nothing before
+    // it is needed.
+    std::size_t decode_start(std::size_t entryIndex) const;
+};
+
+}  // namespace oculus
@@ -0,0 +1,121 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "oculus_driver/LivenessToken.h"
+#include "oculus_driver/ReceiveBuffer.h"
+
+namespace oculus {
+
+/**
+ * Receives a TCP stream with a Linux io_uring multishot recv (kernel 6.0 or
+ * later), as an alternative to the epoll based asio reads of SonarClient.
+ *
+ * A single recv request stays armed for the whole connection. The kernel
+ * picks a buffer from a ring of provided buffers (allocated once, registered
+ * with IORING_REGISTER_PBUF_RING) for each chunk of data it receives. The
+ * completion queue is signalled through an eventfd read by the asio
+ * io_service, so all the completions available at once are handled in a
+ * single handler : they are appended to a ReceiveBuffer, the buffers are
+ * given back to the kernel and the data callback is called once.
+ *
+ * Only built when the library is configured with -DOCULUS_DRIVER_IO_URING=ON
+ * (is_supported() returns false otherwise). No liburing dependency, the
+ * system calls are used directly.
+ */
+class IoUringReceiver
+{
+    public:
+
+    using IoService     = boost::asio::io_service;
+    using Strand        = boost::asio::strand<IoService::executor_type>;
+    using DataCallback  = std::function<void()>;
+    using ErrorCallback = std::function<void(const boost::system::error_code&)>;
+
+    struct Stats
+    {
+        std::size_t wakeups     = 0;  // eventfd notifications handled
+        std::size_t completions = 0;  // recv completions
+        std::size_t bytes       = 0;
+        std::size_t submissions = 0;  // io_uring_enter calls
+        std::size_t noBuffers   = 0;  // recv stopped because all buffers were in use
+    };
+
+    protected:
+
+    struct Ring;  // kernel ring mappings (IoUringReceiver.cpp)
+
+    Strand                                strand_;
+    std::unique_ptr<Ring>                 ring_;
+    boost::asio::posix::stream_descriptor eventFd_;
+    uint64_t                              eventCount_;
+
+    unsigned int bufferCount_;
+    std::size_t  bufferSize_;
+
+    int            socketFd_;
+    uint64_t       generation_;  // user_data of the current recv request
+    unsigned int   armed_;       // recv requests without their last completion
+    bool           running_;
+    bool           waiting_;     // an eventfd read is pending
+    ReceiveBuffer* output_;
+    DataCallback   dataCallback_;
+    ErrorCallback  errorCallback_;
+    Stats          stats_;
+    LivenessToken  alive_;       // guards the eventfd handler
+
+    void setup();
+    void submit_recv();
+    void wait_completions();
+    void completions_callback(const boost::system::error_code& err);
+    void fail(const boost::system::error_code& err);
+    void drain();
+
+    public:
+
+    // bufferCount is rounded up to a power of 2.
+    IoUringReceiver(const Strand& strand,
+                    unsigned int bufferCount = 64,
+                    std::size_t bufferSize = 64*1024);
+    ~IoUringReceiver();
+
+    // True if io_uring was enabled at build time and the kernel accepts a
+    // multishot recv on a provided buffer ring (cached after the first call).
+    static bool is_supported();
+
+    // Starts receiving from socketFd (not owned) into output. Must be called
+    // in the strand. The error callback is called once when the stream ends
+    // (boost::asio::error::eof) or on failure, the reception is stopped.
+    void start(int socketFd, ReceiveBuffer& output,
+               const DataCallback& onData, const ErrorCallback& onError);
+    // Stops handling completions (the pending request is cancelled). Must be
+    // called in the strand.
+    void stop();
+    bool is_running() const { return running_; }
+
+    const Stats& stats() const { return stats_; }
+};
+
+}  // namespace oculus
@@ -0,0 +1,46 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include "oculus_driver/OculusMessage.h"
+
+namespace oculus {
+
+/**
+ * Kernel receive timestamps on a socket (Linux only).
+ *
+ * Once enabled, the kernel stamps every received packet when it reaches the
+ * network stack, before any user-space scheduling delay. The stamps are in the
+ * same time base as Message::TimeSource (CLOCK_REALTIME). The kernel turns
+ * stamping on asynchronously : packets received right after the first socket
+ * enables it may carry no stamp.
+ *
+ * On other systems these functions do nothing and return false.
+ */
+
+// Enables SO_TIMESTAMPING (software receive stamps), falling back to
+// SO_TIMESTAMPNS. Returns false if neither could be enabled.
+bool enable_kernel_timestamps(int socketFd);
+
+// Reads the kernel timestamp of the next byte to be read on a stream socket
+// without consuming it. Returns false if no data is available or if the data
+// carries no timestamp.
+bool peek_kernel_timestamp(int socketFd, Message::TimePoint& stamp);
+
+}  // namespace oculus
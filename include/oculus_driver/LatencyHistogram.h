@@ -0,0 +1,118 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace oculus {
+
+/**
+ * Lock-free histogram of durations, in the spirit of HdrHistogram.
+ *
+ * Values are stored in nanoseconds in log-linear buckets : each power of two
+ * is split in 32 linear sub-buckets, giving a relative precision of about 3%
+ * from 1ns to about 2.5 days. Recording is a single relaxed atomic increment
+ * and can be done from any thread while another one reads the statistics.
+ */
+class LatencyHistogram
+{
+    public:
+
+    using Duration = std::chrono::nanoseconds;
+
+    static constexpr unsigned int SubBucketBits  = 5;
+    static constexpr unsigned int SubBucketCount = 1u << SubBucketBits;
+    static constexpr unsigned int MaxValueBits   = 48;
+    static constexpr unsigned int BucketCount    =
+        (MaxValueBits - SubBucketBits) * SubBucketCount + 2 * SubBucketCount;
+
+    protected:
+
+    std::array<std::atomic<uint64_t>, BucketCount> counts_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+
+    static unsigned int bucket_index(uint64_t value);
+    static uint64_t     bucket_upper_bound(unsigned int index);
+
+    public:
+
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void record(const Duration& duration) { this->record(duration.count()); }
+    template <class Rep, class Period>
+    void record(const std::chrono::duration<Rep, Period>& duration) {
+        this->record(std::chrono::duration_cast<Duration>(duration));
+    }
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    Duration min() const;
+    Duration max() const;
+    Duration mean() const;
+    Duration percentile(double p) const;  // p in [0,100]
+
+    std::string summary() const;
+};
+
+/**
+ * Per-stage latency of the message receive path, from the arrival of a
+ * message header on the socket to the end of the user callbacks.
+ */
+class ReceiveLatency
+{
+    public:
+
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    enum Stage {
+        HeaderToPayload,   // header received -> payload complete
+        PayloadToHandler,  // payload complete -> handle_message entry
+        MessageCallbacks,  // duration of the message callbacks
+        PingCallbacks,     // duration of the ping callbacks
+        Total,             // header received -> all callbacks done
+        StageCount
+    };
+
+    protected:
+
+    std::array<LatencyHistogram, StageCount> histograms_;
+
+    public:
+
+    static const char* stage_name(Stage stage);
+
+    void record(Stage stage, const TimePoint& start, const TimePoint& end) {
+        histograms_[stage].record(end - start);
+    }
+    const LatencyHistogram& histogram(Stage stage) const { return histograms_[stage]; }
+
+    void reset();
+    std::string summary() const;
+};
+
+}  // namespace oculus
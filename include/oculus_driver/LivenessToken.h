@@ -0,0 +1,70 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace oculus {
+
+/**
+ * Lets the handlers an object posted to an io_service (or registered as
+ * callbacks) outlive it.
+ *
+ * The handlers are wrapped with guard() and do nothing once the owner called
+ * kill(), first thing in its destructor. kill() waits for a guarded handler
+ * running in another thread to return, so that the owner is not destroyed
+ * under it.
+ */
+class LivenessToken
+{
+    protected:
+
+    struct State
+    {
+        // Recursive : a guarded handler may call another one, or destroy the
+        // owner, in the same thread.
+        std::recursive_mutex mutex;
+        bool                 alive = true;
+    };
+
+    std::shared_ptr<State> state_;
+
+    public:
+
+    LivenessToken() : state_(std::make_shared<State>()) {}
+
+    void kill() {
+        std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+        state_->alive = false;
+    }
+
+    template <class F>
+    auto guard(F&& f) const {
+        return [state = state_, f = std::forward<F>(f)](auto&&... args) {
+            std::lock_guard<std::recursive_mutex> lock(state->mutex);
+            if (state->alive) {
+                f(std::forward<decltype(args)>(args)...);
+            }
+        };
+    }
+};
+
+}  // namespace oculus
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "oculus_driver/BoundedQueue.h"
+#include "oculus_driver/LivenessToken.h"
+#include "oculus_driver/OculusMessage.h"
+#include "oculus_driver/SonarDriver.h"
+
+namespace oculus {
+
+/**
+ * Hands received messages to subscribers running in their own threads, so a
+ * slow subscriber (image processing, recording...) never delays the socket
+ * reads of the io_service thread.
+ *
+ * Each subscriber has a bounded lock-free queue and a worker thread. What
+ * happens when the queue is full depends on the subscriber policy :
+ * - Block      : the receiving thread waits for room in the queue (nothing
+ *                is lost, but a slow subscriber slows the reception).
+ * - DropOldest : the oldest queued message is dropped.
+ * - DropNewest : the incoming message is dropped.
+ * - LatestOnly : only the most recent message is kept (queue of size 1).
+ *
+ * dispatch() only locks a mutex to copy the subscriber list pointer (the
+ * list is copied on write), and waits with the Block policy when the queue
+ * is full.
+ */
+class MessageDispatcher
+{
+    public:
+
+    enum Policy { Block, DropOldest, DropNewest, LatestOnly };
+
+    using MessageCallback = std::function<void(const Message::ConstPtr&)>;
+    using PingCallback    = std::function<void(const PingMessage::ConstPtr&)>;
+
+    struct Stats
+    {
+        std::string name;
+        Policy      policy;
+        std::size_t capacity;
+        std::size_t queued;     // messages waiting in the queue
+        std::size_t received;   // messages given to dispatch()
+        std::size_t delivered;  // messages given to the callback
+        std::size_t dropped;
+    };
+
+    class Subscriber : public std::enable_shared_from_this<Subscriber>
+    {
+        public:
+
+        using Ptr = std::shared_ptr<Subscriber>;
+
+        protected:
+
+        friend class MessageDispatcher;
+
+        std::string                     name_;
+        Policy                          policy_;
+        MessageCallback                 callback_;
+        BoundedQueue<Message::ConstPtr> queue_;
+        std::thread                     thread_;
+        std::atomic<bool>               running_;
+
+        // Incremented on each push / pop, and used to wait for one.
+        std::atomic<uint32_t> pushCount_;
+        std::atomic<uint32_t> popCount_;
+
+        std::atomic<std::size_t> receivedCount_;
+        std::atomic<std::size_t> deliveredCount_;
+        std::atomic<std::size_t> droppedCount_;
+
+        // The thread holds a reference on the subscriber until run() returns,
+        // so stop() can be called from the callback.
+        void start();
+        void run();
+        void push(const Message::ConstPtr& message);
+        void stop();
+
+        public:
+
+        Subscriber(const std::string& name, Policy policy,
+                   std::size_t capacity, const MessageCallback& callback);
+        ~Subscriber();
+
+        const std::string& name() const { return name_; }
+        Policy policy() const { return policy_; }
+        Stats stats() const;
+    };
+
+    using SubscriberList = std::vector<Subscriber::Ptr>;
+
+    protected:
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    // Copied on write : dispatch() only holds snapshotMutex_ to copy the
+    // pointer, mutex_ serializes the writers.
+    std::mutex                            mutex_;
+    mutable std::mutex                    snapshotMutex_;
+    std::shared_ptr<const SubscriberList> subscribers_;
+
+    // Drivers given to connect(), disconnected in the destructor.
+    std::vector<std::pair<SonarDriver*, SonarDriver::MessageCallbacksType::Handle>> connections_;
+    LivenessToken alive_;  // guards the driver callbacks
+
+    std::shared_ptr<const SubscriberList> snapshot() const;
+    void publish(std::shared_ptr<const SubscriberList> subscribers);
+
+    public:
+
+    MessageDispatcher(const std::shared_ptr<spdlog::logger>& logger);
+    ~MessageDispatcher();
+
+    Subscriber::Ptr subscribe(const MessageCallback& callback,
+                              Policy policy = DropOldest,
+                              std::size_t capacity = 16,
+                              const std::string& name = "");
+    // Only ping messages. The PingMessage is built in the subscriber thread.
+    Subscriber::Ptr subscribe_pings(const PingCallback& callback,
+                                    Policy policy = DropOldest,
+                                    std::size_t capacity = 16,
+                                    const std::string& name = "");
+    // Stops the subscriber thread (after the current callback returns).
+    void unsubscribe(const Subscriber::Ptr& subscriber);
+
+    void dispatch(const Message::ConstPtr& message);
+
+    // Dispatches all the messages received by this driver, until the
+    // dispatcher is destroyed. The driver must outlive the dispatcher.
+    SonarDriver::MessageCallbacksType::Handle connect(SonarDriver& driver);
+
+    std::vector<Stats> stats() const;
+};
+
+}  // namespace oculus
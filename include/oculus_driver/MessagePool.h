@@ -0,0 +1,79 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "oculus_driver/OculusMessage.h"
+
+namespace oculus {
+
+/**
+ * Fixed-capacity pool of recycled Message buffers.
+ *
+ * Each call to acquire() returns a Message which is exclusively owned by the
+ * caller (and by whoever it shares the pointer with). When the last reference
+ * to the Message is dropped, the Message goes back into the pool instead of
+ * being deallocated, so its data buffer (and the capacity it grew to) is
+ * reused for a later message.
+ *
+ * All buffers are reserved to the largest message size seen so far. In steady
+ * state (pings of constant size) this means no allocation and no zero-filling
+ * of the payload when a new message is received.
+ *
+ * The pool never blocks : if all the buffers are in use, a new Message is
+ * allocated. At most capacity() messages are kept for reuse once released.
+ * Messages may be released from any thread, and may outlive the pool.
+ */
+class MessagePool : public std::enable_shared_from_this<MessagePool>
+{
+    public:
+
+    using Ptr      = std::shared_ptr<MessagePool>;
+    using ConstPtr = std::shared_ptr<const MessagePool>;
+
+    protected:
+
+    mutable std::mutex                    mutex_;
+    std::vector<std::unique_ptr<Message>> free_;
+    std::size_t                           capacity_;
+    std::size_t                           maxMessageSize_;
+    std::size_t                           allocationCount_;
+
+    MessagePool(std::size_t capacity);
+
+    void release(Message* message);
+
+    public:
+
+    static Ptr Create(std::size_t capacity = 16);
+
+    Message::Ptr acquire(std::size_t messageSize = 0);
+
+    std::size_t capacity() const;
+    void        set_capacity(std::size_t capacity);
+
+    std::size_t available() const;
+    std::size_t max_message_size() const;
+    std::size_t allocation_count() const;
+};
+
+}  // namespace oculus
@@ -0,0 +1,211 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "oculus_driver/OculusMessage.h"
+
+namespace oculus {
+
+/**
+ * Read-only accessors of a ping inside a message buffer which is not owned
+ * (same accessors as PingMessage). Valid as long as the buffer is.
+ *
+ * The buffer may not be aligned (messages are packed one after the other in
+ * a .oculus file) : the metadata is read in place, which needs an
+ * architecture accepting unaligned loads (x86, ARMv8).
+ */
+class PingView
+{
+    protected:
+
+    const uint8_t* data_;
+    std::size_t    size_;
+
+    template <typename F>
+    auto visit(F&& f) const {
+        if (this->header().msgVersion == 2)
+            return f(*reinterpret_cast<const OculusSimplePingResult2*>(data_));
+        return f(*reinterpret_cast<const OculusSimplePingResult*>(data_));
+    }
+
+    template <typename PingResult>
+    static constexpr bool is_version2 = std::is_same_v<PingResult, OculusSimplePingResult2>;
+
+    template <typename PingResult>
+    static uint8_t sample_size(const PingResult& m) {
+        switch (m.dataSize) {
+            case ImageData8Bit:  return 1;
+            case ImageData16Bit: return 2;
+            case ImageData24Bit: return 3;
+            case ImageData32Bit: return 4;
+            default: {
+                // Invalid dataSize, deducing from the image size (rows may
+                // start with a 4 bytes gain).
+                if (m.nRanges == 0 || m.nBeams == 0) return 0;
+                auto lineStep = m.imageSize / m.nRanges;
+                if (lineStep * m.nRanges != m.imageSize) return 0;
+                if (lineStep % m.nBeams == 0) return lineStep / m.nBeams;
+                if (lineStep >= 4 && (lineStep - 4) % m.nBeams == 0)
+                    return (lineStep - 4) / m.nBeams;
+                return 0;
+            }
+        }
+    }
+
+    public:
+
+    // Throws std::runtime_error if data is not a ping message.
+    PingView(const uint8_t* data, std::size_t size) : data_(data), size_(size) {
+        if (!data_ || size_ < sizeof(OculusMessageHeader)
+            || this->header().msgId != MsgSimplePingResult)
+            throw std::runtime_error("Trying to make a PingView out of non-ping data.");
+        std::size_t metadataSize = this->header().msgVersion == 2 ?
+            sizeof(OculusSimplePingResult2) : sizeof(OculusSimplePingResult);
+        if (size_ < metadataSize)
+            throw std::runtime_error("Trying to make a PingView out of truncated data.");
+    }
+
+    const OculusMessageHeader& header() const {
+        return *reinterpret_cast<const OculusMessageHeader*>(data_);
+    }
+    std::span<const uint8_t> data() const { return {data_, size_}; }
+
+    uint16_t range_count()   const { return visit([](const auto& m) { return m.nRanges; }); }
+    uint16_t bearing_count() const { return visit([](const auto& m) { return m.nBeams; }); }
+    const int16_t* bearing_data() const {
+        return visit([&](const auto& m) {
+            return reinterpret_cast<const int16_t*>(data_ + sizeof(m));
+        });
+    }
+    const uint8_t* ping_data() const {
+        return visit([&](const auto& m) { return data_ + m.imageOffset; });
+    }
+    uint32_t ping_data_size() const { return visit([](const auto& m) { return m.imageSize; }); }
+    uint32_t step() const {
+        return (this->has_gains() ? 4 : 0) + this->bearing_count() * this->sample_size();
+    }
+
+    bool has_gains() const {
+        return visit([](const auto& m) -> bool {
+            if constexpr (is_version2<std::decay_t<decltype(m)>>)
+                return m.imageSize > PingView::sample_size(m) * m.nBeams * m.nRanges;
+            else
+                return m.fireMessage.flags & 0x4;
+        });
+    }
+    uint8_t sample_size() const {
+        return visit([](const auto& m) { return PingView::sample_size(m); });
+    }
+    uint8_t master_mode() const {
+        return visit([](const auto& m) { return m.fireMessage.masterMode; });
+    }
+
+    uint32_t ping_index() const { return visit([](const auto& m) { return m.pingId; }); }
+    uint32_t ping_firing_date() const {
+        return visit([](const auto& m) { return (uint32_t)m.pingStartTime; });
+    }
+    double ping_start_time() const {
+        return visit([](const auto& m) { return (double)m.pingStartTime; });
+    }
+    double range() const { return visit([](const auto& m) { return m.fireMessage.range; }); }
+    double gain_percent() const { return visit([](const auto& m) { return m.fireMessage.gain; }); }
+    double frequency() const { return visit([](const auto& m) { return m.frequency; }); }
+    double speed_of_sound_used() const {
+        return visit([](const auto& m) { return m.speeedOfSoundUsed; });
+    }
+    double range_resolution() const { return visit([](const auto& m) { return m.rangeResolution; }); }
+    double temperature() const { return visit([](const auto& m) { return m.temperature; }); }
+    double pressure() const { return visit([](const auto& m) { return m.pressure; }); }
+    double heading() const {
+        return visit([](const auto& m) {
+            if constexpr (is_version2<std::decay_t<decltype(m)>>) return m.heading;
+            else return 0.0;
+        });
+    }
+    double pitch() const {
+        return visit([](const auto& m) {
+            if constexpr (is_version2<std::decay_t<decltype(m)>>) return m.pitch;
+            else return 0.0;
+        });
+    }
+    double roll() const {
+        return visit([](const auto& m) {
+            if constexpr (is_version2<std::decay_t<decltype(m)>>) return m.roll;
+            else return 0.0;
+        });
+    }
+};
+
+/**
+ * A message which is not copied : a pointer to its header and a span of its
+ * data (header included) in a buffer shared with the reader which made it
+ * (see MmapFileReader). The buffer stays alive as long as a view on it
+ * exists, even after the reader is closed.
+ */
+class MessageView
+{
+    public:
+
+    using TimePoint = Message::TimePoint;
+
+    protected:
+
+    std::shared_ptr<const void> owner_;
+    const uint8_t*              data_;
+    std::size_t                 size_;
+    TimePoint                   timestamp_;
+
+    public:
+
+    MessageView() : data_(nullptr), size_(0) {}
+    MessageView(std::shared_ptr<const void> owner, const uint8_t* data, std::size_t size,
+                const TimePoint& timestamp) :
+        owner_(std::move(owner)), data_(data), size_(size), timestamp_(timestamp)
+    {}
+
+    // False for the empty view returned at the end of a file.
+    explicit operator bool() const { return data_ != nullptr; }
+
+    const OculusMessageHeader& header() const {
+        return *reinterpret_cast<const OculusMessageHeader*>(data_);
+    }
+    std::span<const uint8_t> data() const { return {data_, size_}; }
+    const TimePoint& timestamp() const { return timestamp_; }
+
+    uint16_t message_id()      const { return this->header().msgId; }
+    uint16_t message_version() const { return this->header().msgVersion; }
+    uint32_t payload_size()    const { return this->header().payloadSize; }
+    bool     is_ping_message() const { return this->message_id() == MsgSimplePingResult; }
+
+    // Throws std::runtime_error if this is not a ping message.
+    PingView ping() const { return PingView(data_, size_); }
+
+    // Copy, for the code using Message.
+    Message::Ptr to_message() const {
+        return Message::Create(size_, data_, timestamp_);
+    }
+};
+
+}  // namespace oculus
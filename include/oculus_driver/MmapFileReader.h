@@ -0,0 +1,95 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+
+#include "oculus_driver/FileIndex.h"
+#include "oculus_driver/MessageView.h"
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarImageCodec.h"
+
+namespace oculus {
+
+/**
+ * Reads a .oculus file through a read-only memory mapping. Same interface as
+ * FileReader, but the messages are returned as MessageView pointing into the
+ * mapping, so reading a message copies nothing (compressed items are the
+ * exception, they are decompressed in a buffer owned by the view).
+ *
+ * The mapping is shared with the views : they stay valid after reading the
+ * next message and after the reader is closed. The file must not be
+ * truncated while it is mapped.
+ */
+class MmapFileReader
+{
+    public:
+
+    using TimeStamp = Recorder::TimeStamp;
+
+    protected:
+
+    struct Mapping;
+
+    std::string                    filename_;
+    std::shared_ptr<const Mapping> mapping_;
+    const uint8_t*                 data_;
+    std::size_t                    size_;
+    std::size_t                    itemPosition_;  // of nextItem_, 0 at the end
+    blueprint::LogHeader           fileHeader_;
+    blueprint::LogItem             nextItem_;      // type 0 at the end
+    SonarImageDecoder              imageDecoder_;
+    mutable FileIndex::ConstPtr    index_;
+
+    void read_header_at(std::size_t position);
+
+    public:
+
+    MmapFileReader(const std::string& filename);
+    ~MmapFileReader();
+
+    void open(const std::string& filename);
+    void close();
+    bool is_open() const { return mapping_ != nullptr; }
+    void rewind();
+
+    const blueprint::LogHeader& file_header() const { return fileHeader_; }
+    std::size_t file_size() const { return size_; }
+
+    std::size_t current_item_position() const { return itemPosition_; }
+
+    const blueprint::LogItem& next_item_header() const { return nextItem_; }
+    // Raw payload of the next item (still compressed), in the mapping.
+    std::span<const uint8_t> next_item_data() const;
+    std::size_t jump_item();
+
+    // Empty view at the end of the file.
+    MessageView read_next_message();
+    MessageView read_next_ping();
+
+    // Same as FileReader.
+    const FileIndex::ConstPtr& index() const;
+    void set_index(const FileIndex::ConstPtr& index) { index_ = index; }
+    bool seek(std::size_t pingIndex);
+    std::size_t seek_time(const Message::TimePoint& stamp);
+};
+
+}  // namespace oculus
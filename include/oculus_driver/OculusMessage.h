@@ -23,27 +23,59 @@
 
 #include <chrono>
 #include <cstring>
+#include <memory>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace oculus
 {
 
+/**
+ * Allocator leaving the elements uninitialized on resize() (default
+ * initialization instead of value initialization). The message buffers are
+ * written right after being resized, zeroing them first is wasted.
+ */
+template <typename T>
+struct DefaultInitAllocator : public std::allocator<T>
+{
+    template <typename U>
+    struct rebind { using other = DefaultInitAllocator<U>; };
+
+    DefaultInitAllocator() noexcept = default;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args)
+    {
+        if constexpr (sizeof...(Args) == 0) {
+            ::new(static_cast<void*>(ptr)) U;
+        }
+        else {
+            ::new(static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+        }
+    }
+};
+
 // Forward declaration for friend class declarations
 class SonarClient;
 class FileReader;
+class MessagePool;
 
 class Message
 {
   public:
     // Only the SonarClient and FileReader classes are able to modify this
     // type. This is to ensure consistency between the header_ and data_
-    // fields.
+    // fields. (MessagePool only manages the data_ buffer capacity).
     friend class SonarClient;
     friend class FileReader;
+    friend class MessagePool;
 
     using Ptr = std::shared_ptr<Message>;
     using ConstPtr = std::shared_ptr<const Message>;
+    using Buffer = std::vector<uint8_t, DefaultInitAllocator<uint8_t>>;
 
     using TimeSource = std::chrono::system_clock;
     using TimePoint = typename std::invoke_result<decltype(&TimeSource::now)>::type;
@@ -51,11 +83,12 @@ class Message
   protected:
     TimePoint timestamp_;
     OculusMessageHeader header_;
-    std::vector<uint8_t> data_;
+    Buffer data_;
 
     void update_from_header()
     {
         timestamp_ = TimeSource::now();
+        // Not zeroed (the payload is read right after).
         data_.resize(header_.payloadSize + sizeof(header_));
         *reinterpret_cast<OculusMessageHeader*>(data_.data()) = header_;
     }
@@ -122,7 +155,7 @@ class Message
         return header_;
     }
 
-    const std::vector<uint8_t>& data() const
+    const Buffer& data() const
     {
         return data_;
     }
@@ -183,7 +216,7 @@ class PingWrapper
         return msg_->header();
     }
 
-    const std::vector<uint8_t>& data() const
+    const Message::Buffer& data() const
     {
         return msg_->data();
     }
@@ -212,6 +245,7 @@ class PingWrapper
 
     virtual uint32_t ping_index() const = 0;
     virtual uint32_t ping_firing_date() const = 0;
+    virtual double ping_start_time() const = 0;
     virtual double range() const = 0;
     virtual double gain_percent() const = 0;
     virtual double frequency() const = 0;
@@ -326,6 +360,12 @@ class PingWrapper1 : public PingWrapper
         return this->metadata().pingStartTime;
     }
 
+    virtual double ping_start_time() const
+    {
+        // Unit undocumented for version 1 pings.
+        return this->metadata().pingStartTime;
+    }
+
     virtual double range() const
     {
         return this->metadata().fireMessage.range;
@@ -480,6 +520,12 @@ class PingWrapper2 : public PingWrapper
         return (uint32_t)this->metadata().pingStartTime;
     }
 
+    // In seconds since sonar power-up
+    virtual double ping_start_time() const
+    {
+        return this->metadata().pingStartTime;
+    }
+
     virtual double range() const
     {
         return this->metadata().fireMessage.range;
@@ -580,7 +626,7 @@ class PingMessage
         return pingData_->header();
     }
 
-    const std::vector<uint8_t>& data() const
+    const Message::Buffer& data() const
     {
         return pingData_->data();
     }
@@ -655,6 +701,11 @@ class PingMessage
         return pingData_->ping_firing_date();
     }
 
+    double ping_start_time() const
+    {
+        return pingData_->ping_start_time();
+    }
+
     double range() const
     {
         return pingData_->range();
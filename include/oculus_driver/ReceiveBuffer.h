@@ -0,0 +1,63 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace oculus {
+
+/**
+ * Contiguous byte buffer used to receive a TCP stream in large chunks.
+ *
+ * Bytes are written at the end of the buffer (prepare() / commit()) and
+ * consumed from the beginning (data() / consume()). The unread bytes are
+ * always contiguous in memory, so a complete message can be parsed in place.
+ * When there is not enough room left at the end of the buffer, the unread
+ * bytes are moved back to the beginning (this only happens with a partially
+ * received message, so it is cheap). The buffer only grows if a single
+ * message is larger than its capacity.
+ */
+class ReceiveBuffer
+{
+    protected:
+
+    std::vector<uint8_t> buffer_;
+    std::size_t          begin_;
+    std::size_t          end_;
+
+    public:
+
+    ReceiveBuffer(std::size_t capacity = 2*1024*1024);
+
+    std::size_t capacity() const { return buffer_.size(); }
+    std::size_t size()     const { return end_ - begin_; }
+    bool        empty()    const { return begin_ == end_; }
+
+    const uint8_t* data() const { return buffer_.data() + begin_; }
+
+    boost::asio::mutable_buffer prepare(std::size_t minFreeSize);
+    void commit(std::size_t byteCount);
+    void consume(std::size_t byteCount);
+    void clear() { begin_ = 0; end_ = 0; }
+};
+
+}  // namespace oculus
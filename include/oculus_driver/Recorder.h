@@ -5,7 +5,10 @@
 #include <chrono>
 #include <sstream>
 
+#include "oculus_driver/Compression.h"
+#include "oculus_driver/FileIndex.h"
 #include "oculus_driver/OculusMessage.h"
+#include "oculus_driver/SonarImageCodec.h"
 
 namespace oculus {
 
@@ -135,15 +138,36 @@ class Recorder
     std::string           filename_;
     mutable std::ofstream file_;
 
+    Compression                  compression_;
+    int                          compressionLevel_;
+    mutable std::vector<uint8_t> compressed_;
+    mutable SonarImageEncoder    imageEncoder_;
+
     public:
 
     Recorder();
     ~Recorder();
 
+    // Each message is recorded as two items : the raw message
+    // (rt_oculusSonar) followed by its timestamp (rt_oculusSonarStamp).
+    static void make_items(const Message& message,
+                           blueprint::LogItem& messageItem,
+                           blueprint::LogItem& stampItem,
+                           TimeStamp& stamp);
+    static blueprint::LogHeader make_file_header();
+
     void open(const std::string& filename, bool force = false);
     void close();
     bool is_open() const { return file_.is_open(); }
 
+    // Compression of the message items written after this call (the
+    // timestamp items are never compressed). Compression happens in write(),
+    // on the calling thread : use AsyncRecorder to keep it off the io thread.
+    // With SonarImage, the messages which are not pings use QCompress.
+    // Throws std::runtime_error if the compression is not supported.
+    void set_compression(Compression compression, int level = -1);
+    Compression compression() const { return compression_; }
+
     std::size_t write(const blueprint::LogItem& header,
                       const uint8_t* data) const;
     std::size_t write(const Message& message) const;
@@ -171,9 +195,18 @@ class FileReader
     mutable std::size_t        itemPosition_;
     blueprint::LogHeader       fileHeader_;
 
-    Message::Ptr message_;
+    mutable std::vector<uint8_t> compressed_;
+    mutable SonarImageDecoder    imageDecoder_;
+
+    mutable Message::Ptr message_;  // reused when the previous one was released
+
+    mutable FileIndex::ConstPtr index_;
 
     void read_next_header() const;
+    template <class Buffer>
+    std::size_t read_next_item_into(Buffer& dst) const;
+    void seek_item(std::size_t position) const;
+    void seek_entry(std::size_t entryIndex);
 
     public:
 
@@ -192,13 +225,36 @@ class FileReader
     const blueprint::LogItem& next_item_header() const { return nextItem_; }
     std::size_t read_next_item(uint8_t* dst) const;  // data is assumed to have been reserved
                                                      // using size given in next_item_header
+                                                     // (raw payload, still compressed)
     std::size_t jump_item() const;
-
-    // These are for convenience
+    // Reads at most size bytes from the start of the payload of the next item
+    // (raw, still compressed) without moving to the next item. Returns the
+    // number of bytes read.
+    std::size_t peek_next_item(uint8_t* dst, std::size_t size) const;
+    // Same for a SonarImage item, reading at least its coded prefix (see
+    // SonarImageDecoder::decode_prefix()). dst is grown when needed.
+    std::size_t peek_image_prefix(std::vector<uint8_t>& dst) const;
+
+    // These are for convenience. Compressed items are decompressed (dst is
+    // resized to the originalSize of the item).
     std::size_t read_next_item(std::vector<uint8_t>& dst) const;
+    std::size_t read_next_item(Message::Buffer& dst) const;
 
     Message::ConstPtr     read_next_message() const;
     PingMessage::ConstPtr read_next_ping()    const;
+
+    // Index of the messages of the file, FileIndex::load_or_build() on the
+    // first call (the file is read once and the index is saved next to it).
+    const FileIndex::ConstPtr& index() const;
+    void set_index(const FileIndex::ConstPtr& index) { index_ = index; }
+
+    // Moves to a ping (counted from the start of the file, see index()) : the
+    // next read_next_ping() returns it. Returns false and moves to the end of
+    // the file if there is no such ping.
+    bool seek(std::size_t pingIndex);
+    // Moves to the first ping stamped at or after stamp and returns its index
+    // (ping count at the end of the file).
+    std::size_t seek_time(const Message::TimePoint& stamp);
 };
 
 }  // namespace oculus
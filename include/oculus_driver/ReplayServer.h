@@ -0,0 +1,100 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarServer.h"
+
+namespace oculus {
+
+struct ReplaySettings
+{
+    // Replay speed relative to the recording (2.0 : twice as fast).
+    // 0 : as fast as the client can read.
+    double      speed      = 1.0;
+    bool        loop       = false;
+    // Number of messages kept in flight when replaying as fast as possible.
+    std::size_t queueDepth = 8;
+};
+
+/**
+ * Serves the sonar messages (rt_oculusSonar) of a .oculus file as a live
+ * sonar would.
+ *
+ * The status messages advertise the device id and part number found in the
+ * file, so an unmodified SonarClient connects to it. Messages are sent with
+ * their recorded timing (scaled by ReplaySettings::speed), or as fast as the
+ * client reads them. Fire messages sent by the client are ignored.
+ *
+ * Replay starts (or resumes where it stopped) when a client connects.
+ */
+class ReplayServer : public SonarServer
+{
+    public:
+
+    using Settings = ReplaySettings;
+    using Clock    = std::chrono::steady_clock;
+
+    protected:
+
+    FileReader                reader_;
+    Settings                  settings_;
+    boost::asio::steady_timer timer_;
+
+    BufferPtr          next_;        // next message to be sent
+    Message::TimePoint nextStamp_;   // its recorded timestamp
+    Clock::time_point  replayStart_;
+    Message::TimePoint firstStamp_;
+    bool               rebase_;      // timing reference needs to be reset
+    bool               finished_;
+    std::size_t        replayedCount_;
+    std::size_t        loopCount_;
+    std::size_t        burstDropCount_;  // messages dropped since the queue was full
+
+    bool load_next();
+    Clock::time_point due_time(const Message::TimePoint& stamp) const;
+    void send_next();
+    void fill_queue();
+    void schedule_next();
+    void timer_callback(const boost::system::error_code& err);
+
+    virtual void on_client_connected();
+    virtual void on_client_disconnected();
+    virtual void on_message_sent();
+    virtual void on_message(const OculusMessageHeader& header, const Buffer& payload);
+
+    public:
+
+    ReplayServer(const IoServicePtr& service,
+                 const std::shared_ptr<spdlog::logger>& logger,
+                 const std::string& filename,
+                 const Settings& settings = Settings(),
+                 const Config& config = Config());
+    ~ReplayServer();
+
+    const Settings& settings() const { return settings_; }
+    bool finished() const { return finished_; }
+    std::size_t replayed_count() const { return replayedCount_; }
+    std::size_t loop_count() const { return loopCount_; }
+};
+
+}  // namespace oculus
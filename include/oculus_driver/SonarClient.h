@@ -22,20 +22,27 @@
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <boost/asio.hpp>
 #include <chrono>
 #include <cmath>
 #include <cstring>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "StatusListener.h"
+#include "oculus_driver/IoUringReceiver.h"
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/MessagePool.h"
 #include "oculus_driver/Oculus.h"
 #include "oculus_driver/OculusMessage.h"
+#include "oculus_driver/ReceiveBuffer.h"
 #include "print_utils.h"
 #include "utils.h"
 
@@ -54,6 +61,10 @@ namespace oculus {
  * protection is needed is concurrent write and creation/destruction on the
  * socket. Hence, the socket is only locked in the send(), close_connection()
  * and ???. 
+ *
+ * Fire messages are better sent with send_fire_message() : they are written
+ * asynchronously in the client strand, the caller is never blocked on the
+ * socket.
  */
 class SonarClient
 {
@@ -62,23 +73,53 @@ class SonarClient
     using IoService    = boost::asio::io_service;
     using IoServicePtr = std::shared_ptr<IoService>;
     using Socket       = boost::asio::ip::tcp::socket;
-    using SocketPtr    = std::unique_ptr<Socket>;
+    using SocketPtr    = std::shared_ptr<Socket>;
     using EndPoint     = boost::asio::ip::tcp::endpoint;
     using Duration     = boost::posix_time::time_duration;
+    using Strand       = boost::asio::strand<IoService::executor_type>;
 
     enum ConnectionState { Initializing, Attempt, Connected, Lost };
 
+    // PerMessage : one read for the header, one read for the payload.
+    // Batched    : large reads into a ReceiveBuffer, as many messages as
+    //              available are parsed after each read.
+    enum FramingMode { PerMessage, Batched };
+
+    // Callbacks : the receive loop is a chain of asio handlers (default).
+    // Coroutine : the connection and receive loop are C++20 coroutines (see
+    //             SonarClientCoroutine.cpp). A stalled connection is detected
+    //             with a receive timeout and reconnected by the coroutine.
+    // IoUring   : Linux io_uring multishot receive (see IoUringReceiver),
+    //             messages are framed as in Batched mode. Falls back to
+    //             Callbacks if io_uring is not available.
+    enum ReceiveEngine { Callbacks, Coroutine, IoUring };
+
     using TimeSource = Message::TimeSource;
     using TimePoint  = Message::TimePoint;
+
+    struct SendStats
+    {
+        std::size_t requested = 0;  // send_fire_message() calls
+        std::size_t sent      = 0;  // fire messages actually written
+        std::size_t coalesced = 0;  // replaced by a newer one before being written
+        std::size_t failed    = 0;
+    };
     
     using ErrorCallbacksType = eventpp::CallbackList<void(const boost::system::error_code&)>;
     using ConnectCallbacksType = eventpp::CallbackList<void()>;
+    using HeaderCallbacksType = eventpp::CallbackList<void(const OculusMessageHeader&)>;
 
     private:
     const std::shared_ptr<spdlog::logger> logger;
 
+    struct CoroutineEngine;
+    friend struct CoroutineEngine;
+
     protected:
     IoServicePtr       ioService_;
+    // All the handlers of this client run in this strand (the io_service
+    // may be run by several threads).
+    Strand             strand_;
 
 
     SocketPtr          socket_;
@@ -91,31 +132,119 @@ class SonarClient
     boost::asio::deadline_timer  checkerTimer_;
     Clock                        clock_;
     
-    StatusListener statusListener_;
+    // The status listener may be shared between several clients (see
+    // SonarManager). Only the status of deviceFilter_ (if not 0) are
+    // forwarded to statusCallbacks_.
+    using StatusCallbacksType = eventpp::CallbackList<void(const OculusStatusMsg&)>;
+    std::shared_ptr<StatusListener> statusListener_;
+    StatusCallbacksType::Handle     statusHandle_;
+    StatusCallbacksType             statusCallbacks_;
+    uint16_t                        deviceFilter_;
+    OculusStatusMsg                 lastStatus_;
+    Clock                           statusClock_;
     ErrorCallbacksType errorCallbacks;
     ConnectCallbacksType connectCallbacks;
+    HeaderCallbacksType headerCallbacks_;
     
 
-    Message::Ptr message_;
+    // Each received message gets its own buffer from the pool, so that a
+    // Message::ConstPtr given to handle_message() is never overwritten by
+    // the following messages.
+    OculusMessageHeader header_;
+    std::size_t         headerOffset_;
+    MessagePool::Ptr    messagePool_;
+    Message::Ptr        message_;
+
+    FramingMode   framingMode_;
+    ReceiveBuffer receiveBuffer_;
+    bool          partialMessage_;
+    TimePoint     messageStamp_;
+
+    // Minimum amount of free space given to the socket for one batched read.
+    // Larger reads mean less system calls when the sonar is streaming fast.
+    static constexpr std::size_t BatchReadSize = 64*1024;
+
+    ReceiveEngine         receiveEngine_;
+    Duration              receiveTimeout_;
+    Duration              reconnectDelay_;
+    // Incremented on each close_connection(). A coroutine session stops as
+    // soon as it sees a different value than the one it was started with.
+    std::atomic<uint64_t> session_;
+    bool                  coroutineSession_;
+
+    std::unique_ptr<IoUringReceiver> uring_;
+
+    // Fire message send queue. Only two preallocated messages : the one being
+    // written and the latest pending one. A pending message is overwritten by
+    // a newer one, its callers then get false.
+    mutable std::mutex              sendMutex_;
+    OculusSimpleFireMessage2        pendingFire_;
+    OculusSimpleFireMessage2        writingFire_;
+    bool                            firePending_;
+    bool                            sendActive_;  // a send_next() is posted or a write is pending
+    std::vector<std::promise<bool>> pendingPromises_;
+    std::vector<std::promise<bool>> writingPromises_;
+    SendStats                       sendStats_;
+
+    // Kernel receive timestamps (see KernelTimestamp.h)
+    bool      kernelTimestamps_;
+    bool      kernelStampsActive_;
+    bool      stampPeeked_;
+    bool      kernelStampValid_;
+    TimePoint kernelStamp_;
+
+    // Stream resynchronization
+    bool                     resyncing_;
+    std::size_t              resyncByteCount_;
+    std::atomic<std::size_t> skippedByteCount_;
+
+    // Monotonic timestamps of the message being received (see ReceiveLatency)
+    ReceiveLatency            latency_;
+    ReceiveLatency::TimePoint headerStamp_;
+    ReceiveLatency::TimePoint payloadStamp_;
 
     // helper stubs
     void checker_callback(const boost::system::error_code& err);
     void check_reception(const boost::system::error_code& err);
+    void resync(std::size_t byteCount);
+    void reset_receive_state();
+    std::size_t parse_batch(bool kernelStamped);
+    void start_coroutine_session();  // (in SonarClientCoroutine.cpp)
+    bool start_uring_receive();
+    void send_next();
+    void send_callback(const boost::system::error_code& err, std::size_t byteCount);
 
     public:
 
     SonarClient(const IoServicePtr& ioService,
                 const std::shared_ptr<spdlog::logger>& logger,
                 const Duration& checkerPeriod = boost::posix_time::seconds(1));
+    // Uses an existing status listener, and connects only to the sonar with
+    // this deviceId (any sonar if 0).
+    SonarClient(const IoServicePtr& ioService,
+                const std::shared_ptr<spdlog::logger>& logger,
+                const std::shared_ptr<StatusListener>& statusListener,
+                uint16_t deviceId = 0,
+                const Duration& checkerPeriod = boost::posix_time::seconds(1));
+    virtual ~SonarClient();
 
     bool is_valid(const OculusMessageHeader& header);
     bool connected() const;
 
+    // Blocking write on the socket, in the caller thread.
     size_t send(const boost::asio::streambuf& buffer) const;
+    // Queues a fire message for sending in the client strand and returns
+    // immediately. The future is set to true once the message is written, to
+    // false if it was not (no connection, write error, or replaced by a newer
+    // message : if several messages are queued while a write is in progress,
+    // only the latest one is sent).
+    std::future<bool> send_fire_message(const OculusSimpleFireMessage2& message);
+    SendStats send_stats() const;
 
     // initialization states
     void reset_connection();
     void close_connection();
+    void on_status(const OculusStatusMsg& msg);
     void on_first_status(const OculusStatusMsg& msg);
     void connect_callback(const boost::system::error_code& err);
     virtual void on_connect() = 0;
@@ -126,6 +255,37 @@ class SonarClient
                                   std::size_t receivedByteCount);
     void data_received_callback(const boost::system::error_code err,
                                 std::size_t receivedByteCount);
+
+    void stamp_received_callback(const boost::system::error_code err,
+                                 bool batched, std::size_t minReadSize);
+
+    // batched main loop (see FramingMode)
+    void initiate_batch_receive(std::size_t minReadSize = 0);
+    void batch_received_callback(const boost::system::error_code err,
+                                 std::size_t receivedByteCount);
+
+    // The framing mode is applied on the next connection.
+    FramingMode framing_mode() const { return framingMode_; }
+    void set_framing_mode(FramingMode mode) { framingMode_ = mode; }
+
+    // The receive engine is applied on the next reset_connection().
+    ReceiveEngine receive_engine() const { return receiveEngine_; }
+    void set_receive_engine(ReceiveEngine engine) { receiveEngine_ = engine; }
+    // Coroutine engine only : the connection is reset when nothing was
+    // received for this long, and reconnected after reconnectDelay.
+    void set_receive_timeout(const Duration& timeout) { receiveTimeout_ = timeout; }
+    void set_reconnect_delay(const Duration& delay) { reconnectDelay_ = delay; }
+
+    // io_uring statistics (nullptr if the IoUring engine was never used).
+    const IoUringReceiver* io_uring_receiver() const { return uring_.get(); }
+
+    // When enabled (on the next connection, Linux only), messages are stamped
+    // with the kernel receive time of their first byte instead of the time at
+    // which the header was processed. Falls back to user-space stamps if the
+    // socket does not support it.
+    bool kernel_timestamps() const { return kernelTimestamps_; }
+    bool kernel_timestamps_active() const { return kernelStampsActive_; }
+    void set_kernel_timestamps(bool enable) { kernelTimestamps_ = enable; }
     
     // This is called regardless of the content of the message.
     // To be reimplemented in a subclass (does nothing by default).
@@ -136,9 +296,31 @@ class SonarClient
 
     TimePoint last_header_stamp() const { return message_->timestamp(); }
 
+    inline const MessagePool::Ptr& message_pool() const { return messagePool_; }
+
+    // Strand in which the callbacks of this client are called.
+    const Strand& strand() const { return strand_; }
+
+    // Total number of bytes dropped from the stream while looking for a
+    // valid message header.
+    std::size_t skipped_byte_count() const { return skippedByteCount_; }
+
+    // Latency statistics of the receive path.
+    const ReceiveLatency& latency() const { return latency_; }
+    void reset_latency() { latency_.reset(); }
+
     inline auto& connect_callbacks() {return connectCallbacks; }
-    inline auto& status_callbacks() { return statusListener_.callbacks(); }
+    inline auto& status_callbacks() { return statusCallbacks_; }
+    uint16_t device_filter() const { return deviceFilter_; }
+    const std::shared_ptr<StatusListener>& status_listener() const { return statusListener_; }
+    // No more status handled from the listener (done by the destructor). A
+    // callback may still be running in the listener strand, see
+    // StatusListener::flush().
+    void remove_status_callback();
     inline auto& error_callbacks() { return errorCallbacks; }
+    // Called as soon as a valid message header is received, before the
+    // payload (see TriggerScheduler).
+    inline auto& header_callbacks() { return headerCallbacks_; }
 };
 
 }  // namespace oculus
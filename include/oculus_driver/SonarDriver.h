@@ -21,7 +21,12 @@
 #include <eventpp/utilities/counterremover.h>
 
 #include <memory>
+#include <mutex>
 
+#include "oculus_driver/CancellationToken.h"
+#include "oculus_driver/ClockSync.h"
+#include "oculus_driver/ConfigTransactions.h"
+#include "oculus_driver/LivenessToken.h"
 #include "oculus_driver/Oculus.h"
 #include "oculus_driver/SonarClient.h"
 #include "oculus_driver/print_utils.h"
@@ -52,9 +57,17 @@ class SonarDriver : public SonarClient
     private:
     std::shared_ptr<spdlog::logger> logger;
 
+    // State of an async_request_ping_config (SonarDriver.cpp)
+    struct ConfigRequest;
+    using ConfigRequestPtr = std::shared_ptr<ConfigRequest>;
+
     protected:
+    // Written in the strand (sonar feedback) and by the callers sending
+    // configs (requested pingRate).
+    mutable std::mutex configMutex_;
     PingConfig lastConfig_;
     uint8_t    lastPingRate_;
+    uint8_t    networkSpeed_;  // written in every fire message
 
     // message callbacks will be called on every received message.
     // config callbacks will be called on (detectable) configuration changes.
@@ -63,15 +76,60 @@ class SonarDriver : public SonarClient
     DummyCallbacksType dummyCallbacks_;
     ConfigCallbacksType configCallbacks_;
 
+    // Maps the sonar clock (pingStartTime) to the host clock.
+    ClockSync clockSync_;
+
+    // A requested config is sent again if the sonar feedback does not match
+    // after this long.
+    Duration configRetryPeriod_;
+
+    // Settle time of the config changes (fed by the config callbacks).
+    ConfigTransactions configTransactions_;
+
+    LivenessToken alive_;  // guards the cancellation callbacks
+
+    void init();  // common to the constructors
+    PingConfig prepare_fire_message(PingConfig config);
+    void start_config_request(const ConfigRequestPtr& request, const Duration& timeout);
+    void send_config_request(const ConfigRequestPtr& request);
+    bool end_config_request(ConfigRequest& request);
+
     public:
 
     SonarDriver(const IoServicePtr& service,
                 const std::shared_ptr<spdlog::logger>& logger,
                 const Duration& checkerPeriod = boost::posix_time::seconds(1));
+    SonarDriver(const IoServicePtr& service,
+                const std::shared_ptr<spdlog::logger>& logger,
+                const std::shared_ptr<StatusListener>& statusListener,
+                uint16_t deviceId = 0,
+                const Duration& checkerPeriod = boost::posix_time::seconds(1));
+    ~SonarDriver();
 
+    // Queues the config for sending and returns immediately (false if not
+    // connected). Configs sent in a burst are coalesced, only the latest is
+    // sent (see SonarClient::send_fire_message).
     bool send_ping_config(PingConfig config);
+    // Same, the future tells if the config was actually written (false if
+    // it was coalesced with a newer one).
+    std::future<bool> async_send_ping_config(PingConfig config);
+    // Sends the config once, the future is ready when the sonar reports it,
+    // when it is superseded by another config, when the connection is lost
+    // or after config_transactions().timeout() (see Result::status).
+    ConfigTransactions::Future apply_ping_config(PingConfig config);
     PingConfig current_ping_config();
-    PingConfig request_ping_config(PingConfig request);
+    // Sends the config and waits for a ping (or a dummy message in standby)
+    // matching it, sending it again every config_retry_period(). The future
+    // holds the sonar feedback, or a TimeoutReached or RequestCancelled
+    // exception. Never wait on the future from a callback of this driver.
+    std::future<PingConfig> async_request_ping_config(PingConfig request,
+        const Duration& timeout = boost::posix_time::seconds(10),
+        const CancellationToken& cancel = CancellationToken());
+    // Blocking version. On timeout, returns the request with an invalid
+    // head.msgId (0). Throws a std::runtime_error if called from a callback
+    // of this driver (it would never return).
+    PingConfig request_ping_config(PingConfig request,
+        const Duration& timeout = boost::posix_time::seconds(10));
     PingConfig last_ping_config() const;
 
     // Stanby mode (saves current ping rate and set it to 0 on the sonar
@@ -81,6 +139,24 @@ class SonarDriver : public SonarClient
     virtual void on_connect();
     virtual void handle_message(const Message::ConstPtr& message);
 
+    // Host time at which the ping was acquired, estimated from the ping
+    // pingStartTime and the clock synchronization. Falls back to the message
+    // timestamp when the synchronization is not established yet.
+    TimePoint ping_acquisition_time(const PingMessage& ping) const;
+
+    // Link speed limit requested to the sonar in the fire messages (0xff :
+    // no limit, default).
+    uint8_t network_speed() const { return networkSpeed_; }
+    void set_network_speed(uint8_t speed) { networkSpeed_ = speed; }
+
+    const ConfigTransactions& config_transactions() const { return configTransactions_; }
+    ConfigTransactions& config_transactions() { return configTransactions_; }
+
+    const Duration& config_retry_period() const { return configRetryPeriod_; }
+    void set_config_retry_period(const Duration& period) { configRetryPeriod_ = period; }
+    const ClockSync& clock_sync() const { return clockSync_; }
+    ClockSync& clock_sync() { return clockSync_; }
+
     /////////////////////////////////////////////
     // All remaining member function are related to callbacks and are merely
     // helpers to add callbacks.
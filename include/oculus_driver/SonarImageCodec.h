@@ -0,0 +1,124 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace oculus {
+
+/**
+ * Lossless codec for ping messages (OculusSimplePingResult version 1 and 2,
+ * 8 or 16 bits samples, with or without gains). Compression id SonarImage of
+ * the .oculus LogItem.
+ *
+ * A ping is made of :
+ * - the bytes before the image (message header, ping metadata, bearings).
+ *   They are xored with the ones of the previous ping, which leaves mostly
+ *   zeros while the configuration does not change, and run length coded.
+ * - the image, one row per range. Each sample is predicted from its
+ *   neighbours with the median edge detector of LOCO-I (previous beam,
+ *   previous range) and the residuals are coded with an adaptive Rice code.
+ *   The gain words at the start of the rows are coded as deltas.
+ *
+ * Pings depending on the previous one cannot be decoded alone : a keyframe
+ * (no reference) is encoded every keyframeInterval pings, and each encoded
+ * ping has a sequence number so that a decoder detects a missing reference.
+ * Messages which are not supported pings are rejected (encode() returns
+ * false), they must be stored with another compression.
+ */
+class SonarImageEncoder
+{
+    public:
+
+    static constexpr unsigned int DefaultKeyframeInterval = 64;
+
+    // What a ping needs to be encoded independently of the other ones.
+    struct Frame
+    {
+        uint32_t             sequence = 0;
+        bool                 keyframe = true;
+        std::vector<uint8_t> reference;  // bytes before the image of the previous ping
+    };
+
+    protected:
+
+    unsigned int         keyframeInterval_;
+    unsigned int         sinceKeyframe_;
+    uint32_t             sequence_;
+    std::vector<uint8_t> reference_;
+
+    public:
+
+    SonarImageEncoder(unsigned int keyframeInterval = DefaultKeyframeInterval);
+
+    // True if data is a ping the codec can encode.
+    static bool is_supported(const uint8_t* data, std::size_t size);
+
+    // Encodes the next ping of the sequence into dst. Returns false (and
+    // leaves the sequence untouched) if the message is not supported.
+    bool encode(const uint8_t* data, std::size_t size, std::vector<uint8_t>& dst);
+
+    // Same as encode() in two steps, so that pings can be encoded in
+    // parallel : next_frame() must be called in sequence order, the static
+    // encode() can then be called from any thread.
+    bool next_frame(const uint8_t* data, std::size_t size, Frame& frame);
+    static void encode(const uint8_t* data, std::size_t size, const Frame& frame,
+                       std::vector<uint8_t>& dst);
+
+    // Next ping will be a keyframe.
+    void reset();
+};
+
+class SonarImageDecoder
+{
+    protected:
+
+    bool                 hasReference_;
+    uint32_t             sequence_;
+    std::vector<uint8_t> reference_;
+
+    void check_reference(bool keyframe, uint32_t sequence, std::size_t prefixSize) const;
+
+    public:
+
+    SonarImageDecoder();
+
+    static bool is_keyframe(const uint8_t* data, std::size_t size);
+    // Number of bytes at the start of an encoded ping needed by
+    // decode_prefix() (0 if size is too small to tell).
+    static std::size_t prefix_coded_size(const uint8_t* data, std::size_t size);
+
+    // Decodes a ping into dst, which must have room for originalSize bytes.
+    // Throws std::runtime_error if the data is corrupted or if the ping
+    // needs a reference this decoder did not decode just before (after a
+    // seek, decoding must start on a keyframe).
+    void decode(const uint8_t* data, std::size_t size,
+                uint8_t* dst, std::size_t originalSize);
+    // Decodes only the bytes before the image (message header, ping metadata
+    // and bearings) and moves to the next ping of the sequence as decode()
+    // does : this is how a reader catches up from a keyframe to a seek target
+    // without decoding the images in between. The returned prefix is valid
+    // until the next call.
+    const std::vector<uint8_t>& decode_prefix(const uint8_t* data, std::size_t size);
+
+    void reset();
+};
+
+}  // namespace oculus
@@ -0,0 +1,142 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <eventpp/callbacklist.h>
+#include <spdlog/spdlog.h>
+
+#include <boost/asio.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/StatusListener.h"
+
+namespace oculus {
+
+/**
+ * A sonar seen on the network (from its status messages).
+ */
+struct SonarDevice
+{
+    uint16_t           deviceId;
+    uint16_t           partNumber;
+    std::string        address;
+    OculusStatusMsg    lastStatus;
+    std::size_t        statusCount;
+    Message::TimePoint lastSeen;
+};
+
+/**
+ * Handles several sonars in the same process.
+ *
+ * A single StatusListener (there can be only one bound to the status port)
+ * keeps a table of the sonars found on the network, and a SonarDriver is
+ * attached to each sonar of interest. Each driver only connects to its own
+ * sonar.
+ *
+ * Drivers either run on a shared pool of threads (SharedPool, which also runs
+ * the status listener), or each on its own thread (ThreadPerSonar).
+ */
+class SonarManager
+{
+    public:
+
+    using IoService    = boost::asio::io_service;
+    using IoServicePtr = std::shared_ptr<IoService>;
+    using DriverPtr    = std::shared_ptr<SonarDriver>;
+
+    enum ThreadingMode { SharedPool, ThreadPerSonar };
+
+    using DiscoveryCallbacksType = eventpp::CallbackList<void(const SonarDevice&)>;
+
+    protected:
+
+    struct Attached
+    {
+        std::unique_ptr<AsyncService> own;  // ThreadPerSonar only
+        DriverPtr                     driver;
+    };
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    ThreadingMode  mode_;
+    unsigned int   poolSize_;
+    AsyncService   shared_;
+    bool           running_;
+    bool           autoAttach_;
+    AsyncService::ThreadInit threadInit_;
+
+    std::shared_ptr<StatusListener> statusListener_;
+
+    mutable std::mutex                    mutex_;
+    std::map<uint16_t, SonarDevice>       devices_;
+    std::map<uint16_t, Attached>          drivers_;
+    std::vector<Attached>                 detached_;
+    DiscoveryCallbacksType                discoveryCallbacks_;
+
+    void on_status(const OculusStatusMsg& msg);
+
+    public:
+
+    SonarManager(const std::shared_ptr<spdlog::logger>& logger,
+                 ThreadingMode mode = SharedPool,
+                 unsigned int poolSize = 1,
+                 uint16_t statusPort = 52102);
+    ~SonarManager();
+
+    void start();
+    void stop();
+    bool is_running() const { return running_; }
+
+    ThreadingMode threading_mode() const { return mode_; }
+
+    // Called in every thread started by the manager (shared pool and per
+    // sonar threads), see AsyncService::set_thread_init.
+    void set_thread_init(const AsyncService::ThreadInit& init);
+
+    // Discovered sonars.
+    std::vector<SonarDevice> devices() const;
+    bool has_device(uint16_t deviceId) const;
+
+    // Creates a driver for this sonar (it does not have to be discovered
+    // yet). Returns the existing driver if already attached.
+    DriverPtr attach(uint16_t deviceId);
+    DriverPtr driver(uint16_t deviceId) const;
+    std::vector<uint16_t> attached_devices() const;
+    // The driver is disconnected. In SharedPool mode it is only destroyed in
+    // stop(), as handlers may still be pending in the shared threads. In
+    // ThreadPerSonar mode its thread is stopped once the status listener no
+    // longer calls it.
+    void detach(uint16_t deviceId);
+
+    // Attach a driver to every new sonar found on the network.
+    void set_auto_attach(bool enable) { autoAttach_ = enable; }
+    bool auto_attach() const { return autoAttach_; }
+
+    // Called (in the status listener thread) when a new sonar is found.
+    auto& discovery_callbacks() { return discoveryCallbacks_; }
+};
+
+}  // namespace oculus
@@ -0,0 +1,150 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <boost/asio.hpp>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "oculus_driver/LivenessToken.h"
+#include "oculus_driver/Oculus.h"
+
+namespace oculus {
+
+// Outside of SonarServer to be usable as a default constructor argument.
+struct SonarServerConfig
+{
+    uint16_t    deviceId      = 1;
+    uint16_t    partNumber    = M1200d;
+    // Address advertised in the status messages (SonarClient connects to
+    // it on port 52100, which is not configurable client side).
+    std::string address       = "127.0.0.1";
+    uint16_t    tcpPort       = 52100;
+    // Destination of the status messages. Use 255.255.255.255 to
+    // broadcast on a real network.
+    std::string statusAddress = "127.0.0.1";
+    uint16_t    statusPort    = 52102;
+    double      statusPeriod  = 0.5;  // seconds
+    // Messages are dropped if the client does not read fast enough.
+    std::size_t maxQueueSize  = 64;
+};
+
+/**
+ * Network side of a sonar : this is the counterpart of SonarClient, to be
+ * used to stand in for a real sonar (tests, benchmarks, replay of recorded
+ * data...).
+ *
+ * It periodically sends OculusStatusMsg on UDP (so a SonarClient can discover
+ * it), accepts a single TCP client (a new connection replaces the previous
+ * one), and calls on_message() for each message received from the client.
+ * Subclasses generate the data sent to the client with send().
+ *
+ * Everything runs in the io_service thread. send() can be called from any
+ * thread. Handlers still pending when the server is destroyed do nothing :
+ * they are guarded by alive_ (subclasses guard theirs too, and kill it first
+ * in their destructor).
+ */
+class SonarServer
+{
+    public:
+
+    using IoService    = boost::asio::io_service;
+    using IoServicePtr = std::shared_ptr<IoService>;
+    using TcpSocket    = boost::asio::ip::tcp::socket;
+    using Acceptor     = boost::asio::ip::tcp::acceptor;
+    using UdpSocket    = boost::asio::ip::udp::socket;
+    using Buffer       = std::vector<uint8_t>;
+    using BufferPtr    = std::shared_ptr<const Buffer>;
+    using Config       = SonarServerConfig;
+
+    protected:
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    IoServicePtr ioService_;
+    Config       config_;
+
+    Acceptor                   acceptor_;
+    std::unique_ptr<TcpSocket> pendingClient_;
+    std::unique_ptr<TcpSocket> client_;
+    uint64_t                   clientGeneration_;  // bound to the client handlers
+    UdpSocket                  statusSocket_;
+    boost::asio::steady_timer  statusTimer_;
+    OculusStatusMsg            status_;
+
+    // reception from the client
+    OculusMessageHeader rxHeader_;
+    Buffer              rxPayload_;
+
+    // sending to the client
+    std::deque<BufferPtr> txQueue_;
+    bool                  sending_;
+    std::size_t           sentCount_;
+    std::size_t           droppedCount_;
+
+    LivenessToken alive_;  // guards the handlers bound to this
+
+    void accept_next();
+    void accept_callback(const boost::system::error_code& err);
+    void status_callback(const boost::system::error_code& err);
+    void disconnect_client();
+    void set_device(uint16_t deviceId, uint16_t partNumber);
+
+    void receive_header();
+    void header_callback(const boost::system::error_code& err, uint64_t generation);
+    void payload_callback(const boost::system::error_code& err, uint64_t generation);
+
+    void enqueue(const BufferPtr& message);
+    void write_next();
+    void write_callback(const boost::system::error_code& err, uint64_t generation,
+                        const BufferPtr& message);
+
+    // To be reimplemented in subclasses
+    virtual void on_client_connected() {}
+    virtual void on_client_disconnected() {}
+    virtual void on_message_sent() {}
+    virtual void on_message(const OculusMessageHeader&, const Buffer&) {}
+
+    public:
+
+    SonarServer(const IoServicePtr& service,
+                const std::shared_ptr<spdlog::logger>& logger,
+                const Config& config = Config());
+    virtual ~SonarServer();
+
+    void start();
+    void stop();
+
+    const Config& config() const { return config_; }
+    const OculusStatusMsg& status_message() const { return status_; }
+    bool client_connected() const { return client_ != nullptr; }
+
+    void send(const BufferPtr& message);
+    void send(const void* data, std::size_t size);
+
+    std::size_t sent_count() const { return sentCount_; }
+    std::size_t dropped_count() const { return droppedCount_; }
+    std::size_t queue_size() const { return txQueue_.size(); }
+};
+
+}  // namespace oculus
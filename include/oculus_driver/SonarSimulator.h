@@ -0,0 +1,102 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+
+#include "oculus_driver/SonarServer.h"
+
+namespace oculus {
+
+struct SonarSimulatorSettings
+{
+    double   pingRate   = 0.0;   // Hz. 0 : rate requested in the fire message,
+                                 // < 0 : as fast as the client reads.
+    uint16_t beamCount  = 0;     // 0 : 256 or 512 depending on fire message flags.
+    uint16_t rangeCount = 512;
+    uint8_t  sampleSize = 0;     // 1 or 2 bytes. 0 : depending on fire message flags.
+    int      sendGains  = -1;    // 0 or 1. -1 : depending on fire message flags.
+};
+
+/**
+ * Simulated Oculus sonar.
+ *
+ * Answers OculusSimpleFireMessage2 with synthetic OculusSimplePingResult2
+ * (version 2) pings, echoing the requested configuration in the ping
+ * fireMessage like a real sonar does. Pings are sent at the rate requested in
+ * the fire message (or at Settings::pingRate, which can be higher than what a
+ * real sonar does), dummy messages are sent when in standby, and a single
+ * ping is sent per fire message when the NetworkTrigger flag is set.
+ *
+ * The image content is a fixed synthetic pattern, generated once per
+ * configuration, so that generating pings costs as little as possible.
+ */
+class SonarSimulator : public SonarServer
+{
+    public:
+
+    using PingConfig = OculusSimpleFireMessage2;
+    using PingResult = OculusSimplePingResult2;
+    using Clock      = std::chrono::steady_clock;
+    using Settings   = SonarSimulatorSettings;
+
+    protected:
+
+    Settings                  settings_;
+    PingConfig                pingConfig_;
+    boost::asio::steady_timer pingTimer_;
+    Clock::time_point         nextPing_;
+    Clock::time_point         bootTime_;
+    uint32_t                  pingId_;
+    std::size_t               pingCount_;
+    Buffer                    pingTemplate_;
+
+    void build_ping_template();
+    BufferPtr make_ping();
+    void send_ping();
+    void send_dummy();
+    void schedule_next();
+    void ping_callback(const boost::system::error_code& err);
+    void fill_queue();
+
+    virtual void on_client_connected();
+    virtual void on_client_disconnected();
+    virtual void on_message_sent();
+    virtual void on_message(const OculusMessageHeader& header, const Buffer& payload);
+
+    public:
+
+    SonarSimulator(const IoServicePtr& service,
+                   const std::shared_ptr<spdlog::logger>& logger,
+                   const Settings& settings = Settings(),
+                   const Config& config = Config());
+    ~SonarSimulator();
+
+    const Settings&   settings() const { return settings_; }
+    const PingConfig& ping_config() const { return pingConfig_; }
+    std::size_t       ping_count() const { return pingCount_; }
+    // pingStartTime of the pings is relative to this.
+    Clock::time_point boot_time() const { return bootTime_; }
+
+    double ping_period() const;  // seconds, 0 if not pinging on a timer.
+    bool free_running() const;
+    std::size_t ping_size() const { return pingTemplate_.size(); }
+};
+
+}  // namespace oculus
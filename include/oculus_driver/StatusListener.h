@@ -24,6 +24,7 @@
 #include <spdlog/spdlog.h>
 
 #include <boost/asio.hpp>
+#include <future>
 #include <iostream>
 #include <memory>
 
@@ -40,6 +41,7 @@ class StatusListener
     using IoServicePtr = std::shared_ptr<IoService>;
     using Socket       = boost::asio::ip::udp::socket;
     using EndPoint     = boost::asio::ip::udp::endpoint;
+    using Strand       = boost::asio::strand<IoService::executor_type>;
 
     private:
     OculusStatusMsg prev_;
@@ -47,6 +49,7 @@ class StatusListener
     protected:
     const std::shared_ptr<spdlog::logger> logger;
 
+    Strand          strand_;
     Socket          socket_;
     EndPoint        remote_;
     OculusStatusMsg msg_;
@@ -61,6 +64,9 @@ class StatusListener
                    uint16_t listeningPort = 52102);
     
     inline auto& callbacks() { return callbacks_; }
+    // Ready once the callbacks running in the listener strand when called
+    // have returned (right away if called from the strand).
+    std::future<void> flush();
 
     template <typename T = float>
     T time_since_last_status() const { return clock_.now<T>(); }
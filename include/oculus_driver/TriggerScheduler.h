@@ -0,0 +1,148 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "oculus_driver/LatencyHistogram.h"
+#include "oculus_driver/LivenessToken.h"
+#include "oculus_driver/SonarDriver.h"
+
+namespace oculus {
+
+/**
+ * Fires the pings of a SonarDriver on demand. With the NetworkTrigger flag
+ * (bit 7 of OculusSimpleFireMessage2::flags) the sonar sends a single ping
+ * per fire message, the fire messages are the triggers.
+ *
+ * - Pipelined : the next trigger is sent as soon as the header of the
+ *               previous ping arrives (highest achievable rate).
+ * - Periodic  : triggers at start + k*period on the host steady clock. A
+ *               slot is skipped if the previous ping is still in flight.
+ * - Manual    : triggers are only sent by trigger() and trigger_at(), for
+ *               example on the events of an external clock.
+ *
+ * Only one trigger is in flight at a time : a trigger requested while a ping
+ * is expected is sent when its header arrives. A trigger without a ping
+ * header after ping_timeout() is counted as lost.
+ *
+ * Everything runs in the driver strand. The scheduler can be destroyed at
+ * any time before the driver : the handlers it left in the strand are then
+ * dropped.
+ */
+class TriggerScheduler
+{
+    public:
+
+    using Ptr        = std::shared_ptr<TriggerScheduler>;
+    using Clock      = std::chrono::steady_clock;
+    using TimePoint  = Clock::time_point;
+    using PingConfig = SonarDriver::PingConfig;
+
+    static constexpr uint8_t NetworkTriggerFlag = 0x80;
+
+    enum Mode { Manual, Pipelined, Periodic };
+
+    struct Stats
+    {
+        std::size_t triggers = 0;  // fire messages sent
+        std::size_t pings    = 0;  // ping headers received for a trigger
+        std::size_t lost     = 0;  // triggers without a ping
+        std::size_t skipped  = 0;  // periodic slots skipped (ping in flight)
+    };
+
+    protected:
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    SonarDriver&                             driver_;
+    boost::asio::steady_timer                triggerTimer_;  // periodic and trigger_at()
+    boost::asio::steady_timer                timeoutTimer_;
+    SonarClient::HeaderCallbacksType::Handle  headerHandle_;
+    SonarClient::ConnectCallbacksType::Handle connectHandle_;
+
+    Mode            mode_;
+    PingConfig      config_;
+    Clock::duration period_;
+    Clock::duration pingTimeout_;
+    TimePoint       nextTrigger_;
+    bool            running_;
+    bool            inFlight_;
+    bool            triggerPending_;
+    uint64_t        triggerId_;  // discards stale timeout handlers
+    uint64_t        scheduleId_; // discards stale trigger timer handlers
+    TimePoint       triggerStamp_;
+
+    std::atomic<std::size_t> triggerCount_;
+    std::atomic<std::size_t> pingCount_;
+    std::atomic<std::size_t> lostCount_;
+    std::atomic<std::size_t> skippedCount_;
+
+    LatencyHistogram triggerToPing_;  // trigger sent -> ping header received
+    LatencyHistogram lateness_;       // scheduled time -> trigger sent
+
+    LivenessToken alive_;  // guards the handlers capturing this
+
+    void start_scheduled(const PingConfig& config, Mode mode,
+                         const Clock::duration& period, const TimePoint& start);
+    void send_trigger();
+    void schedule_at(const TimePoint& when);
+    void scheduled_callback(const boost::system::error_code& err, uint64_t scheduleId);
+    void timeout_callback(const boost::system::error_code& err, uint64_t triggerId);
+    void on_header(const OculusMessageHeader& header);
+    void on_connect();
+    void trigger_done();
+
+    public:
+
+    TriggerScheduler(SonarDriver& driver, const std::shared_ptr<spdlog::logger>& logger);
+    ~TriggerScheduler();
+
+    // The NetworkTrigger flag is added to config. start() replaces the
+    // current mode and configuration.
+    void start_manual(const PingConfig& config);
+    void start_pipelined(const PingConfig& config);
+    void start_periodic(const PingConfig& config, const Clock::duration& period,
+                        const TimePoint& start = Clock::now());
+    // No more triggers. The sonar stays in network trigger mode (send a
+    // config without the flag to make it ping on its own again).
+    void stop();
+
+    // Fires as soon as possible (after the ping in flight, if any).
+    void trigger();
+    // Fires at a host time. Replaces a previous trigger_at() not fired yet.
+    void trigger_at(const TimePoint& when);
+
+    // The configuration of the next triggers.
+    void set_config(const PingConfig& config);
+    void set_ping_timeout(const Clock::duration& timeout);
+
+    Stats stats() const;
+    const LatencyHistogram& trigger_to_ping() const { return triggerToPing_; }
+    const LatencyHistogram& lateness() const { return lateness_; }
+    void reset_statistics();
+};
+
+}  // namespace oculus
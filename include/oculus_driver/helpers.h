@@ -116,10 +116,10 @@ inline double get_range(const OculusSimplePingResult2& msg)
  * OculusPingResultType is either a OculusSimplePingResult or an
  * OculusSimplePingResult2.
  */
-template <typename T, class OculusPingResultType>
+template <typename T, class OculusPingResultType, class Alloc>
 inline void ping_data_to_array(T* dst,
                                const OculusPingResultType& metadata,
-                               const std::vector<uint8_t>& pingData)
+                               const std::vector<uint8_t, Alloc>& pingData)
 {
     if (has_16bits_data(metadata)) {
         auto data = (const uint16_t*)(pingData.data() + metadata.imageOffset);
@@ -162,7 +162,8 @@ inline void ping_data_to_array(T* dst,
         }
     }
 }
-inline std::vector<float> get_ping_acoustic_data(const std::vector<uint8_t>& pingData)
+template <class Alloc>
+inline std::vector<float> get_ping_acoustic_data(const std::vector<uint8_t, Alloc>& pingData)
 {
     auto header = *reinterpret_cast<const OculusMessageHeader*>(pingData.data());
     if (header.msgId != MsgSimplePingResult) {
@@ -185,10 +186,10 @@ inline std::vector<float> get_ping_acoustic_data(const std::vector<uint8_t>& pin
 /**
  * Returns a ping bearing information in radians
  */
-template <typename T, class OculusPingResultType>
+template <typename T, class OculusPingResultType, class Alloc>
 inline void get_ping_bearings(T* dst,
                               const OculusPingResultType& metadata,
-                              const std::vector<uint8_t>& pingData)
+                              const std::vector<uint8_t, Alloc>& pingData)
 {
     // copying bearing angles (
     auto bearingData = (const int16_t*)(pingData.data() + sizeof(OculusPingResultType));
@@ -196,7 +197,8 @@ inline void get_ping_bearings(T* dst,
         dst[i] = (0.01 * M_PI / 180.0) * bearingData[i];
     }
 }
-inline std::vector<float> get_ping_bearings(const std::vector<uint8_t>& pingData)
+template <class Alloc>
+inline std::vector<float> get_ping_bearings(const std::vector<uint8_t, Alloc>& pingData)
 {
     auto header = *reinterpret_cast<const OculusMessageHeader*>(pingData.data());
     if (header.msgId != MsgSimplePingResult) {
@@ -226,10 +228,10 @@ inline std::vector<float> get_ping_bearings(const std::vector<uint8_t>& pingData
  *
  * This function return the image size as a std::pair(width,height).
  */
-template <class OculusPingResultType>
+template <class OculusPingResultType, class Alloc>
 inline std::pair<unsigned int, unsigned int> image_from_ping_data(
     const OculusPingResultType& metadata,
-    const std::vector<uint8_t>& msgData,
+    const std::vector<uint8_t, Alloc>& msgData,
     std::vector<float>& imageData,
     unsigned int imageWidth = 1024)
 {
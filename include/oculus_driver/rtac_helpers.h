@@ -13,10 +13,10 @@
 namespace rtac { 
 namespace types {
 
-template <typename T, template<typename> class VectorT>
+template <typename T, template<typename> class VectorT, class Alloc>
 inline void oculus_to_rtac(SonarPing2D<T,VectorT>& dst, 
                            const OculusSimplePingResult& metadata,
-                           const std::vector<uint8_t>& data)
+                           const std::vector<uint8_t, Alloc>& data)
 {
     dst.resize({metadata.nBeams, metadata.nRanges});
     
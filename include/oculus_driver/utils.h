@@ -23,7 +23,12 @@
 
 #include <atomic>
 #include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 #include "oculus_driver/Oculus.h"
 #include "print_utils.h"
@@ -37,6 +42,12 @@ struct TimeoutReached : public std::exception {
   }
 };
 
+struct RequestCancelled : public std::exception {
+  const char* what() const throw() {
+    return "Request cancelled.";
+  }
+};
+
 template <typename EndPointT> inline EndPointT remote_from_status(const OculusStatusMsg& status)
 {
     // going through string conversion allows to not care about
@@ -49,6 +60,85 @@ inline bool header_valid(const OculusMessageHeader& header)
     return header.oculusId == 0x4f53;  // Fixed for Oculus Sonar
 }
 
+// Largest payload we expect from a sonar (a 512 beams 16-bit ping with gains
+// is in the order of a few MB). Anything bigger is a corrupted header.
+constexpr uint32_t MaxPayloadSize = 32*1024*1024;
+
+/**
+ * Stricter than header_valid. Used to find a message start in a stream of
+ * bytes which may be corrupted or misaligned. A srcDeviceId of 0 matches any
+ * device.
+ */
+inline bool header_plausible(const OculusMessageHeader& header, uint16_t srcDeviceId = 0)
+{
+    return header_valid(header)
+        && (srcDeviceId == 0 || header.srcDeviceId == srcDeviceId)
+        && header.payloadSize <= MaxPayloadSize;
+}
+
+/**
+ * Scans size bytes for the first position at which a plausible
+ * OculusMessageHeader starts.
+ *
+ * If less than sizeof(OculusMessageHeader) bytes are available after a
+ * candidate position, the candidate is only checked on the available bytes
+ * (it will be checked again when more data is received). Returns size if no
+ * candidate was found : all the scanned bytes can be dropped.
+ */
+inline std::size_t find_header(const uint8_t* data, std::size_t size, uint16_t srcDeviceId = 0)
+{
+    // OCULUS_CHECK_ID as it appears on the wire (little endian).
+    constexpr uint8_t magic0 = OCULUS_CHECK_ID & 0xff;
+    constexpr uint8_t magic1 = OCULUS_CHECK_ID >> 8;
+
+    std::size_t offset = 0;
+    while (offset < size)
+    {
+        auto candidate = static_cast<const uint8_t*>(std::memchr(data + offset, magic0, size - offset));
+        if (!candidate) return size;
+        offset = candidate - data;
+
+        std::size_t remaining = size - offset;
+        if (remaining < 2) return offset;  // can't tell yet
+        if (candidate[1] == magic1)
+        {
+            if (remaining < sizeof(OculusMessageHeader))
+            {
+                // Checking the device id if we have it.
+                if (remaining < 4 || srcDeviceId == 0) return offset;
+                uint16_t deviceId;
+                std::memcpy(&deviceId, candidate + 2, sizeof(deviceId));
+                if (deviceId == srcDeviceId) return offset;
+            }
+            else
+            {
+                OculusMessageHeader header;
+                std::memcpy(&header, candidate, sizeof(header));
+                if (header_plausible(header, srcDeviceId)) return offset;
+            }
+        }
+        offset++;
+    }
+    return size;
+}
+
+/**
+ * Maximum ping frequency (Hz) of a PingRateType, 0 in standby.
+ */
+inline double ping_rate_frequency(uint8_t pingRate)
+{
+    switch (pingRate)
+    {
+    case PingRateHigh:    return 15.0;
+    case PingRateHighest: return 40.0;
+    case PingRateLow:     return 5.0;
+    case PingRateLowest:  return 2.0;
+    case PingRateStandby: return 0.0;
+    case PingRateNormal:
+    default:              return 10.0;
+    }
+}
+
 inline bool is_ping_message(const OculusMessageHeader& header)
 {
     return header_valid(header) && header.msgId == OculusMessageType::MsgSimplePingResult;
@@ -140,26 +230,38 @@ inline bool config_changed(const OculusSimpleFireMessage2& previous, const Oculu
     return false;
 }
 
+/**
+ * Calls callback on the next call of callbacks, waiting at most timeout_ms.
+ * Returns false if the timeout was reached first.
+ */
 template <typename Prototype, typename Policies>
 bool timedCallback(eventpp::CallbackList<Prototype, Policies>& callbacks,
                    auto& callback, int timeout_ms = 5000) {
-    std::atomic_flag called;
-    auto start = std::chrono::steady_clock::now();
+    struct State {
+        std::mutex              mutex;
+        std::condition_variable condition;
+        bool                    called  = false;
+        bool                    expired = false;  // callback must not be used anymore
+    };
+    auto state = std::make_shared<State>();
     auto handle = eventpp::counterRemover(callbacks).append(
-        [start, timeout_ms, &callback, &called](auto... args) {
-        if (std::chrono::steady_clock::now() - start <
-            std::chrono::milliseconds(timeout_ms)) {
-            callback(args...);
-            called.test_and_set();
-        }
+        [state, &callback](auto... args) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->expired || state->called) return;
+        callback(args...);
+        state->called = true;
+        state->condition.notify_all();
     });
 
-    while (!called.test() || std::chrono::steady_clock::now() - start <
-                                std::chrono::milliseconds(timeout_ms)) {
-        std::this_thread::sleep_for (std::chrono::milliseconds(100));
-    }
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                              [&]() { return state->called; });
+    state->expired = true;
+    bool called = state->called;
+    lock.unlock();
+
     callbacks.remove(handle);
-    return called.test();
+    return called;
 }
 
 }  // namespace oculus
@@ -26,8 +26,8 @@ inline py::memoryview make_memory_view(std::size_t width, std::size_t height, co
     return py::memoryview::from_buffer(const_cast<T*>(data), {height, width}, {sizeof(T)*width, sizeof(T)});
 }
 
-template <typename T>
-inline py::memoryview make_memory_view(const std::vector<T>& data)
+template <typename T, class Alloc>
+inline py::memoryview make_memory_view(const std::vector<T, Alloc>& data)
 {
     return make_memory_view(data.size(), data.data());
 }
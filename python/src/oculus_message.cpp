@@ -75,6 +75,7 @@ void init_oculus_message(py::module& m_)
         .def("ping_index",          &oculus::PingMessage::ping_index)
         // ping_firing_date broken on hardware side ?
         // .def("ping_firing_date",    &oculus::PingMessage::ping_firing_date)
+        .def("ping_start_time",     &oculus::PingMessage::ping_start_time)
         .def("range",               &oculus::PingMessage::range)
         .def("gain_percent",        &oculus::PingMessage::gain_percent)
         .def("frequency",           &oculus::PingMessage::frequency)
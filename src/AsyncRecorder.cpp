@@ -0,0 +1,440 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/AsyncRecorder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace oculus {
+
+AsyncRecorder::AsyncRecorder(std::size_t capacity, Policy policy, std::size_t blockSize) :
+    fd_(-1),
+    offset_(0),
+    policy_(policy),
+    blockSize_(blockSize),
+    queue_(std::max<std::size_t>(capacity, 2)),
+    running_(false),
+    failed_(false),
+    writers_(0),
+    pushCount_(0),
+    popCount_(0),
+    receivedCount_(0),
+    writtenCount_(0),
+    droppedCount_(0),
+    byteCount_(0),
+    rawByteCount_(0),
+    writeCallCount_(0),
+    compression_(NoCompression),
+    compressionLevel_(-1),
+    workerCount_(0),
+    workGeneration_(0),
+    stopWorkers_(false),
+    jobCount_(0),
+    pendingJobs_(0),
+    activeWorkers_(0),
+    nextJob_(0)
+{
+    // 4 buffers per message : item header, message, stamp item header, stamp.
+    std::size_t maxBatch = IOV_MAX / 4;
+    batch_.reserve(maxBatch);
+    items_.resize(2*maxBatch);
+    stamps_.resize(maxBatch);
+    iovecs_.resize(4*maxBatch);
+    compressed_.resize(maxBatch);
+    itemCompressions_.resize(maxBatch);
+    frames_.resize(maxBatch);
+}
+
+AsyncRecorder::~AsyncRecorder()
+{
+    this->close();
+}
+
+void AsyncRecorder::open(const std::string& filename)
+{
+    this->close();
+
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::ostringstream oss;
+        oss << "Could not open file for writing : " << filename
+            << " (" << std::strerror(errno) << ")";
+        throw std::runtime_error(oss.str());
+    }
+    // Left by a previous recording.
+    Message::ConstPtr message;
+    while (queue_.try_pop(message)) {}
+
+    filename_ = filename;
+    offset_   = 0;
+    error_.clear();
+    failed_ = false;
+    receivedCount_  = 0;
+    writtenCount_   = 0;
+    droppedCount_   = 0;
+    byteCount_      = 0;
+    rawByteCount_   = 0;
+    writeCallCount_ = 0;
+    writeLatency_.reset();
+    imageEncoder_.reset();
+    openStamp_ = Clock::now();
+
+    auto header = Recorder::make_file_header();
+    iovec iov{&header, sizeof(header)};
+    if (!this->write_all(&iov, 1, sizeof(header))) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Could not write file header : " + error_);
+    }
+
+    running_ = true;
+    if (compression_ != NoCompression) {
+        stopWorkers_ = false;
+        for (unsigned int i = 0; i < workerCount_; i++) {
+            workers_.emplace_back(&AsyncRecorder::run_worker, this);
+        }
+    }
+    thread_ = std::thread(&AsyncRecorder::run, this);
+}
+
+void AsyncRecorder::set_compression(Compression compression, int level,
+                                    unsigned int workerCount)
+{
+    if (this->is_open()) {
+        throw std::runtime_error(
+            "oculus::AsyncRecorder : compression must be set before open()");
+    }
+    if (!compression_supported(compression)) {
+        std::ostringstream oss;
+        oss << "oculus::AsyncRecorder : compression " << compression
+            << " not supported by this build";
+        throw std::runtime_error(oss.str());
+    }
+    compression_      = compression;
+    compressionLevel_ = level;
+    workerCount_      = workerCount;
+}
+
+void AsyncRecorder::close()
+{
+    if (fd_ < 0) return;
+
+    running_ = false;
+    pushCount_.fetch_add(1);
+    pushCount_.notify_all();
+    popCount_.fetch_add(1);
+    popCount_.notify_all();  // a Block producer may be waiting
+
+    // A write() which saw running_ before it was cleared may still be
+    // pushing. Waiting for it so nothing is queued after the drain below.
+    for (auto count = writers_.load(); count > 0; count = writers_.load()) {
+        writers_.wait(count);
+    }
+
+    if (thread_.joinable())
+        thread_.join();
+
+    {
+        std::unique_lock<std::mutex> lock(workMutex_);
+        stopWorkers_ = true;
+    }
+    workCondition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    // Left after a write error.
+    Message::ConstPtr message;
+    while (queue_.try_pop(message)) {
+        droppedCount_++;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool AsyncRecorder::write(const Message::ConstPtr& message)
+{
+    // Counted before checking running_ so close() either sees this writer or
+    // this writer sees close().
+    writers_.fetch_add(1);
+    bool res = this->push(message);
+    writers_.fetch_sub(1);
+    writers_.notify_all();
+    return res;
+}
+
+bool AsyncRecorder::push(const Message::ConstPtr& message)
+{
+    if (!running_ || failed_) {
+        droppedCount_++;
+        return false;
+    }
+    receivedCount_++;
+
+    switch (policy_)
+    {
+    case Block:
+        while (!queue_.try_push(message)) {
+            auto count = popCount_.load(std::memory_order_acquire);
+            if (queue_.try_push(message)) break;
+            if (!running_) {
+                droppedCount_++;
+                return false;
+            }
+            popCount_.wait(count, std::memory_order_acquire);
+        }
+        break;
+    case DropOldest:
+        while (!queue_.try_push(message)) {
+            Message::ConstPtr oldest;
+            if (queue_.try_pop(oldest)) {
+                droppedCount_++;
+            }
+        }
+        break;
+    case DropNewest:
+        if (!queue_.try_push(message)) {
+            droppedCount_++;
+            return false;
+        }
+        break;
+    }
+
+    pushCount_.fetch_add(1, std::memory_order_release);
+    pushCount_.notify_one();
+    return true;
+}
+
+void AsyncRecorder::run()
+{
+    for (;;) {
+        auto count = pushCount_.load(std::memory_order_acquire);
+        if (queue_.size() == 0) {
+            if (!running_) break;  // everything was written
+            pushCount_.wait(count, std::memory_order_acquire);
+            continue;
+        }
+        if (!this->write_batch()) {
+            failed_ = true;
+            // Dropping everything left, producers are not blocked anymore.
+            Message::ConstPtr message;
+            while (queue_.try_pop(message)) {
+                droppedCount_++;
+            }
+            popCount_.fetch_add(1, std::memory_order_release);
+            popCount_.notify_all();
+            if (!running_) break;
+            pushCount_.wait(pushCount_.load(std::memory_order_acquire),
+                            std::memory_order_acquire);
+        }
+    }
+}
+
+void AsyncRecorder::run_worker()
+{
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(workMutex_);
+    for (;;) {
+        workCondition_.wait(lock, [&]() {
+            return stopWorkers_ || workGeneration_ != generation;
+        });
+        if (stopWorkers_) return;
+        generation = workGeneration_;
+        auto jobCount = jobCount_;
+        activeWorkers_++;
+        lock.unlock();
+        this->run_jobs(jobCount);
+        lock.lock();
+        if (--activeWorkers_ == 0)
+            doneCondition_.notify_all();
+    }
+}
+
+/**
+ * Compresses the messages of batch_ into compressed_, the writer thread
+ * taking jobs like the workers.
+ */
+void AsyncRecorder::compress_batch()
+{
+    for (std::size_t i = 0; i < batch_.size(); i++) {
+        const auto& data = batch_[i]->data();
+        itemCompressions_[i] = compression_;
+        if (compression_ == SonarImage
+            && !imageEncoder_.next_frame(data.data(), data.size(), frames_[i]))
+        {
+            itemCompressions_[i] = QCompress;  // not a ping
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(workMutex_);
+        jobCount_    = batch_.size();
+        pendingJobs_ = batch_.size();
+        nextJob_     = 0;
+        workGeneration_++;
+    }
+    workCondition_.notify_all();
+
+    this->run_jobs(batch_.size());
+
+    std::unique_lock<std::mutex> lock(workMutex_);
+    // Waiting for the workers to leave run_jobs() too, before the next batch
+    // reuses the job counter.
+    doneCondition_.wait(lock, [&]() {
+        return pendingJobs_ == 0 && activeWorkers_ == 0;
+    });
+}
+
+void AsyncRecorder::run_jobs(std::size_t jobCount)
+{
+    for (;;) {
+        auto i = nextJob_.fetch_add(1);
+        if (i >= jobCount) return;
+
+        const auto& data = batch_[i]->data();
+        try {
+            if (itemCompressions_[i] == SonarImage) {
+                SonarImageEncoder::encode(data.data(), data.size(), frames_[i],
+                                          compressed_[i]);
+            }
+            else {
+                compress(itemCompressions_[i], data.data(), data.size(),
+                         compressed_[i], compressionLevel_);
+            }
+        }
+        catch (const std::runtime_error&) {
+            compressed_[i].clear();  // written uncompressed
+        }
+
+        std::unique_lock<std::mutex> lock(workMutex_);
+        if (--pendingJobs_ == 0)
+            doneCondition_.notify_all();
+    }
+}
+
+/**
+ * Writes as many queued messages as fit in a block with a single pwritev().
+ */
+bool AsyncRecorder::write_batch()
+{
+    std::size_t rawSize = 0;
+    Message::ConstPtr message;
+    while (batch_.size() < stamps_.size() && rawSize < blockSize_ && queue_.try_pop(message)) {
+        batch_.push_back(std::move(message));
+        rawSize += batch_.back()->data().size();
+    }
+    popCount_.fetch_add(1, std::memory_order_release);
+    if (policy_ == Block)
+        popCount_.notify_one();
+    if (batch_.empty()) return true;
+
+    if (compression_ != NoCompression)
+        this->compress_batch();
+
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < batch_.size(); i++) {
+        const auto& msg = *batch_[i];
+        Recorder::make_items(msg, items_[2*i], items_[2*i + 1], stamps_[i]);
+        iovecs_[4*i] = iovec{&items_[2*i], sizeof(blueprint::LogItem)};
+        if (compression_ != NoCompression && !compressed_[i].empty()) {
+            items_[2*i].compression = itemCompressions_[i];
+            items_[2*i].payloadSize = compressed_[i].size();
+            iovecs_[4*i + 1] = iovec{compressed_[i].data(), compressed_[i].size()};
+        }
+        else {
+            iovecs_[4*i + 1] = iovec{const_cast<uint8_t*>(msg.data().data()), msg.data().size()};
+        }
+        iovecs_[4*i + 2] = iovec{&items_[2*i + 1], sizeof(blueprint::LogItem)};
+        iovecs_[4*i + 3] = iovec{&stamps_[i], sizeof(Recorder::TimeStamp)};
+        size += iovecs_[4*i].iov_len + iovecs_[4*i + 1].iov_len
+              + iovecs_[4*i + 2].iov_len + iovecs_[4*i + 3].iov_len;
+    }
+
+    bool success = this->write_all(iovecs_.data(), 4*batch_.size(), size);
+    if (success) {
+        writtenCount_ += batch_.size();
+        rawByteCount_ += rawSize;
+    }
+    else {
+        droppedCount_ += batch_.size();
+    }
+    batch_.clear();  // releasing the messages (back to their pool)
+    return success;
+}
+
+/**
+ * pwritev() at the end of the file, until all the data is written.
+ */
+bool AsyncRecorder::write_all(iovec* iov, int count, std::size_t size)
+{
+    while (size > 0) {
+        auto t0 = Clock::now();
+        auto res = ::pwritev(fd_, iov, count, offset_);
+        writeLatency_.record(Clock::now() - t0);
+        writeCallCount_++;
+        if (res < 0) {
+            if (errno == EINTR) continue;
+            error_ = std::strerror(errno);
+            return false;
+        }
+        offset_    += res;
+        byteCount_ += res;
+        size       -= res;
+
+        // Partial write : skipping what was written.
+        std::size_t written = res;
+        while (count > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+AsyncRecorder::Stats AsyncRecorder::stats() const
+{
+    Stats res;
+    res.capacity   = queue_.capacity();
+    res.queued     = queue_.size();
+    res.received   = receivedCount_;
+    res.written    = writtenCount_;
+    res.dropped    = droppedCount_;
+    res.bytes      = byteCount_;
+    res.rawBytes   = rawByteCount_;
+    res.writeCalls = writeCallCount_;
+    double elapsed = std::chrono::duration<double>(Clock::now() - openStamp_).count();
+    res.throughput = elapsed > 0.0 ? res.bytes / elapsed : 0.0;
+    return res;
+}
+
+}  // namespace oculus
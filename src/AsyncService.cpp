@@ -18,13 +18,25 @@
 
 #include <oculus_driver/AsyncService.h>
 
-#include <boost/bind.hpp>
+#include <cstring>
+#include <system_error>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
 
 namespace oculus {
 
-AsyncService::AsyncService() :
+AsyncService::AsyncService(unsigned int threadCount, const std::string& name) :
     service_(std::make_unique<IoService>()),
-    isRunning_(false)
+    isRunning_(false),
+    threadCount_(std::max(threadCount, 1u)),
+    name_(name),
+    reportCount_(0),
+    jitterGeneration_(0)
 {}
 
 AsyncService::~AsyncService()
@@ -42,35 +54,264 @@ bool AsyncService::is_running() const
     return isRunning_;
 }
 
+void AsyncService::set_thread_count(unsigned int count)
+{
+    threadCount_ = std::max(count, 1u);
+}
+
 void AsyncService::start()
 {
     if (this->is_running()) return;
-    std::cout << "starting" << std::endl;
 
     if (service_->stopped())
         service_->reset();
 
-    thread_ = std::thread(boost::bind(&boost::asio::io_service::run, service_));
-    if (!thread_.joinable())
-        throw std::runtime_error("Failed to start AsyncService");
+    {
+        std::unique_lock<std::mutex> lock(reportMutex_);
+        reports_.assign(threadCount_, ThreadReport());
+        reportCount_ = 0;
+    }
+
+    // Threads keep running even when there is no pending handler.
+    work_ = std::make_unique<WorkGuard>(boost::asio::make_work_guard(*service_));
+    try {
+        for (unsigned int i = 0; i < threadCount_; i++) {
+            threads_.emplace_back(&AsyncService::run_thread, this, i);
+        }
+    }
+    catch (const std::system_error& e) {
+        // Joinable threads must not be destroyed, stopping the ones started.
+        work_.reset();
+        service_->stop();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+        throw std::runtime_error(std::string("Failed to start AsyncService : ") + e.what());
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(reportMutex_);
+        reportCondition_.wait(lock, [&]() { return reportCount_ == threadCount_; });
+    }
+
+    if (scheduling_.jitterProbePeriod.count() > 0) {
+        wakeupJitter_.reset();
+        jitterTimer_ = std::make_unique<Timer>(*service_);
+        jitterTimer_->expires_after(scheduling_.jitterProbePeriod);
+        jitterTimer_->async_wait(std::bind(&AsyncService::jitter_probe_callback,
+                                           this, std::placeholders::_1, ++jitterGeneration_));
+    }
 
     isRunning_ = true;
 }
 
+void AsyncService::run_thread(unsigned int threadIndex)
+{
+    set_current_thread_name(name_ + "_" + std::to_string(threadIndex));
+    auto report = this->apply_scheduling(threadIndex);
+    {
+        std::unique_lock<std::mutex> lock(reportMutex_);
+        reports_[threadIndex] = report;
+        reportCount_++;
+    }
+    reportCondition_.notify_all();
+
+    if (threadInit_)
+        threadInit_(threadIndex);
+    service_->run();
+}
+
 void AsyncService::stop()
 {
     if (!this->is_running()) return;
 
-    std::cout << "stopping" << std::endl;
-
+    // The jitter timer is re-armed by its handler in the io threads : it is
+    // only released once they are joined (asio timers are not thread safe).
+    work_.reset();
     service_->stop();
-    thread_.join();
-    if (thread_.joinable())
-        throw std::runtime_error("Failed to stop AsyncService");
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    jitterTimer_.reset();
+    jitterGeneration_++;
 
     isRunning_ = false;
+}
+
+void AsyncService::jitter_probe_callback(const boost::system::error_code& err,
+                                         uint64_t generation)
+{
+    // A handler left in the queue by stop() may run after a restart.
+    if (err == boost::asio::error::operation_aborted || generation != jitterGeneration_)
+        return;
+
+    auto now = Timer::clock_type::now();
+    wakeupJitter_.record(now - jitterTimer_->expiry());
+
+    // Not trying to catch up after a long stall, it would only measure the
+    // backlog of timer expirations.
+    auto next = jitterTimer_->expiry() + scheduling_.jitterProbePeriod;
+    if (next < now)
+        next = now + scheduling_.jitterProbePeriod;
+    jitterTimer_->expires_at(next);
+    jitterTimer_->async_wait(std::bind(&AsyncService::jitter_probe_callback,
+                                       this, std::placeholders::_1, generation));
+}
 
-    std::cout << "stopped" << std::endl;
+#ifdef __linux__
+static const char* policy_name(int policy)
+{
+    switch (policy) {
+        case SCHED_OTHER: return "other";
+        case SCHED_FIFO:  return "fifo";
+        case SCHED_RR:    return "rr";
+        case SCHED_BATCH: return "batch";
+        case SCHED_IDLE:  return "idle";
+        default:          return "unknown";
+    }
+}
+
+// Returns the pthread error code (0 on success).
+static int set_affinity(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+            return EINVAL;
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+#endif
+
+ThreadReport AsyncService::apply_scheduling(unsigned int threadIndex)
+{
+    ThreadReport report;
+    report.index = threadIndex;
+    report.name  = name_ + "_" + std::to_string(threadIndex);
+
+#ifdef __linux__
+    // pthread functions return the error code instead of setting errno.
+    auto fail = [&](const std::string& what, int err, const char* hint) {
+        std::ostringstream oss;
+        oss << what << " : " << std::strerror(err);
+        if ((err == EPERM || err == ENOMEM) && hint)
+            oss << " (" << hint << ")";
+        report.errors.push_back(oss.str());
+    };
+
+    if (scheduling_.lockMemory && threadIndex == 0) {
+        // Process wide, only done once.
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+            report.memoryLocked = true;
+        }
+        else {
+            // ENOMEM is returned when RLIMIT_MEMLOCK is too low.
+            int err = errno;
+            fail("mlockall failed", err,
+                 "needs CAP_IPC_LOCK or a larger memlock limit in limits.conf");
+        }
+    }
+
+    if (!scheduling_.cpus.empty()) {
+        int err = set_affinity(scheduling_.cpus);
+        if (err != 0)
+            fail("could not set CPU affinity", err, nullptr);
+    }
+
+    if (scheduling_.policy != SchedulingConfig::Inherit) {
+        int policy = scheduling_.policy == SchedulingConfig::Fifo ? SCHED_FIFO : SCHED_RR;
+        sched_param param;
+        param.sched_priority = scheduling_.priority;
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != 0) {
+            fail(std::string("could not set ") + policy_name(policy) + " priority "
+                 + std::to_string(scheduling_.priority), err,
+                 "needs CAP_SYS_NICE or an rtprio limit above the priority in limits.conf");
+        }
+    }
+
+    // Reading back what is actually in effect.
+    int policy;
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        report.policy   = policy_name(policy);
+        report.priority = param.sched_priority;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set))
+                report.cpus.push_back(cpu);
+        }
+    }
+#else
+    if (scheduling_.policy != SchedulingConfig::Inherit || !scheduling_.cpus.empty()
+        || scheduling_.lockMemory)
+    {
+        report.errors.push_back("thread scheduling is only supported on Linux");
+    }
+#endif
+    return report;
+}
+
+std::vector<ThreadReport> AsyncService::thread_reports() const
+{
+    std::unique_lock<std::mutex> lock(reportMutex_);
+    return reports_;
+}
+
+std::string AsyncService::scheduling_report() const
+{
+    std::ostringstream oss;
+    for (const auto& report : this->thread_reports()) {
+        oss << "- " << report.name << " : policy " << report.policy
+            << ", priority " << report.priority << ", cpus";
+        for (auto cpu : report.cpus) {
+            oss << ' ' << cpu;
+        }
+        if (report.memoryLocked)
+            oss << ", memory locked (process wide)";
+        for (const auto& error : report.errors) {
+            oss << "\n    error : " << error;
+        }
+        oss << '\n';
+    }
+    if (wakeupJitter_.count() > 0)
+        oss << "- wake-up jitter : " << wakeupJitter_.summary() << '\n';
+    return oss.str();
+}
+
+std::vector<std::thread::native_handle_type> AsyncService::native_handles()
+{
+    std::vector<std::thread::native_handle_type> res;
+    for (auto& thread : threads_) {
+        res.push_back(thread.native_handle());
+    }
+    return res;
+}
+
+bool AsyncService::set_current_thread_name(const std::string& name)
+{
+#ifdef __linux__
+    // Linux thread names are limited to 15 characters.
+    return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+#else
+    return false;
+#endif
+}
+
+bool AsyncService::set_current_thread_affinity(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+    return set_affinity(cpus) == 0;
+#else
+    return false;
+#endif
 }
 
 }  // namespace oculus
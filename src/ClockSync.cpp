@@ -0,0 +1,169 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/ClockSync.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace oculus {
+
+ClockSync::ClockSync(std::size_t windowSize, double maxSkew, double resetThreshold,
+                     std::size_t maxOutliers) :
+    windowSize_(std::max<std::size_t>(windowSize, 2)),
+    maxSkew_(maxSkew),
+    resetThreshold_(resetThreshold),
+    maxOutliers_(std::max<std::size_t>(maxOutliers, 1)),
+    fixedDelay_(0.0)
+{
+    this->reset_locked();
+}
+
+void ClockSync::reset()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    this->reset_locked();
+}
+
+void ClockSync::reset_locked()
+{
+    samples_.clear();
+    rate_         = 1.0;
+    offset_       = 0.0;
+    resetCount_   = 0;
+    outlierCount_ = 0;
+}
+
+bool ClockSync::update(double sonarTime, const TimePoint& hostTime)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (samples_.empty()) {
+        reference_ = hostTime;
+    }
+    Sample sample{sonarTime,
+                  std::chrono::duration<double>(hostTime - reference_).count()};
+
+    bool reset = false;
+    if (!samples_.empty())
+    {
+        double predicted = offset_ + rate_ * sample.sonar;
+        bool outlier = std::abs(sample.host - predicted) > resetThreshold_;
+        if (outlier && sample.sonar >= samples_.back().sonar
+            && ++outlierCount_ < maxOutliers_)
+        {
+            // Host side stall (reconnection, loaded system...) : the sample
+            // is not used.
+            return true;
+        }
+        if (!outlier) {
+            outlierCount_ = 0;
+        }
+        if (outlier || sample.sonar < samples_.back().sonar)
+        {
+            // Sonar rebooted (or the mapping changed for good).
+            auto count = resetCount_;
+            this->reset_locked();
+            resetCount_ = count + 1;
+            reference_  = hostTime;
+            sample.host = 0.0;
+            reset = true;
+        }
+    }
+
+    samples_.push_back(sample);
+    if (samples_.size() > windowSize_) {
+        samples_.pop_front();
+    }
+    this->fit();
+    return !reset;
+}
+
+void ClockSync::fit()
+{
+    // delay of a sample relative to a unit rate mapping
+    auto delay = [](const Sample& s) { return s.host - s.sonar; };
+    auto lowest = [&](auto begin, auto end) {
+        return *std::min_element(begin, end, [&](const Sample& a, const Sample& b) {
+            return delay(a) < delay(b);
+        });
+    };
+
+    rate_ = 1.0;
+    if (samples_.size() >= 8)
+    {
+        auto middle = samples_.begin() + samples_.size() / 2;
+        Sample first  = lowest(samples_.begin(), middle);
+        Sample second = lowest(middle, samples_.end());
+        if (second.sonar - first.sonar > 0.0) {
+            rate_ = (second.host - first.host) / (second.sonar - first.sonar);
+            rate_ = std::clamp(rate_, 1.0 - maxSkew_, 1.0 + maxSkew_);
+        }
+    }
+
+    double minOffset = samples_.front().host - rate_ * samples_.front().sonar;
+    for (const auto& s : samples_) {
+        minOffset = std::min(minOffset, s.host - rate_ * s.sonar);
+    }
+    offset_ = minOffset;
+}
+
+bool ClockSync::is_valid() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return samples_.size() >= 8;
+}
+
+std::size_t ClockSync::sample_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return samples_.size();
+}
+
+std::size_t ClockSync::reset_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return resetCount_;
+}
+
+double ClockSync::skew() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return rate_ - 1.0;
+}
+
+void ClockSync::set_fixed_delay(double seconds)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    fixedDelay_ = seconds;
+}
+
+/**
+ * Host time at which the sonar clock read sonarTime. Returns a default
+ * constructed TimePoint if no sample was received yet.
+ */
+ClockSync::TimePoint ClockSync::host_time(double sonarTime) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (samples_.empty())
+        return TimePoint();
+    double host = offset_ + rate_ * sonarTime - fixedDelay_;
+    return reference_ + std::chrono::duration_cast<Duration>(std::chrono::duration<double>(host));
+}
+
+}  // namespace oculus
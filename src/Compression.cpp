@@ -0,0 +1,162 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/Compression.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef OCULUS_DRIVER_ZSTD
+#include <zstd.h>
+#endif
+
+#include "oculus_driver/SonarImageCodec.h"
+
+namespace oculus {
+
+namespace {
+
+constexpr std::size_t QCompressPrefixSize = 4;
+
+std::runtime_error compression_error(uint16_t compression, const std::string& what)
+{
+    std::ostringstream oss;
+    oss << "oculus : " << what << " (compression " << compression << ")";
+    return std::runtime_error(oss.str());
+}
+
+void qcompress(const uint8_t* data, std::size_t size, std::vector<uint8_t>& dst, int level)
+{
+    uLongf compressedSize = compressBound(size);
+    dst.resize(QCompressPrefixSize + compressedSize);
+    dst[0] = (size >> 24) & 0xff;
+    dst[1] = (size >> 16) & 0xff;
+    dst[2] = (size >>  8) & 0xff;
+    dst[3] =  size        & 0xff;
+    if (level < 0) level = Z_DEFAULT_COMPRESSION;
+    if (compress2(dst.data() + QCompressPrefixSize, &compressedSize,
+                  data, size, level) != Z_OK)
+    {
+        throw compression_error(QCompress, "zlib compression failed");
+    }
+    dst.resize(QCompressPrefixSize + compressedSize);
+}
+
+void quncompress(const uint8_t* data, std::size_t size, uint8_t* dst, std::size_t originalSize)
+{
+    if (size < QCompressPrefixSize) {
+        throw compression_error(QCompress, "truncated compressed data");
+    }
+    std::size_t expected = (std::size_t(data[0]) << 24) | (std::size_t(data[1]) << 16)
+                         | (std::size_t(data[2]) <<  8) |  std::size_t(data[3]);
+    uLongf uncompressedSize = originalSize;
+    if (expected != originalSize
+        || uncompress(dst, &uncompressedSize, data + QCompressPrefixSize,
+                      size - QCompressPrefixSize) != Z_OK
+        || uncompressedSize != originalSize)
+    {
+        throw compression_error(QCompress, "corrupted compressed data");
+    }
+}
+
+}  // namespace
+
+bool compression_supported(uint16_t compression)
+{
+    switch (compression) {
+        case NoCompression:
+        case QCompress:
+        case SonarImage:
+            return true;
+#ifdef OCULUS_DRIVER_ZSTD
+        case Zstd:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+void compress(Compression compression, const uint8_t* data, std::size_t size,
+              std::vector<uint8_t>& dst, int level)
+{
+    switch (compression) {
+        case NoCompression:
+            dst.assign(data, data + size);
+            return;
+        case QCompress:
+            qcompress(data, size, dst, level);
+            return;
+        case SonarImage:
+            if (!SonarImageEncoder::is_supported(data, size)) {
+                throw compression_error(SonarImage, "not a supported ping message");
+            }
+            SonarImageEncoder::encode(data, size, SonarImageEncoder::Frame(), dst);
+            return;
+#ifdef OCULUS_DRIVER_ZSTD
+        case Zstd: {
+            dst.resize(ZSTD_compressBound(size));
+            auto res = ZSTD_compress(dst.data(), dst.size(), data, size,
+                                     level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+            if (ZSTD_isError(res)) {
+                throw compression_error(Zstd, ZSTD_getErrorName(res));
+            }
+            dst.resize(res);
+            return;
+        }
+#endif
+        default:
+            throw compression_error(compression, "unsupported compression");
+    }
+}
+
+void decompress(uint16_t compression, const uint8_t* data, std::size_t size,
+                uint8_t* dst, std::size_t originalSize)
+{
+    switch (compression) {
+        case NoCompression:
+            if (size != originalSize) {
+                throw compression_error(compression, "size mismatch");
+            }
+            std::memcpy(dst, data, size);
+            return;
+        case QCompress:
+            quncompress(data, size, dst, originalSize);
+            return;
+        case SonarImage: {
+            SonarImageDecoder decoder;
+            decoder.decode(data, size, dst, originalSize);
+            return;
+        }
+#ifdef OCULUS_DRIVER_ZSTD
+        case Zstd: {
+            auto res = ZSTD_decompress(dst, originalSize, data, size);
+            if (ZSTD_isError(res) || res != originalSize) {
+                throw compression_error(Zstd, "corrupted compressed data");
+            }
+            return;
+        }
+#endif
+        default:
+            throw compression_error(compression, "unsupported compression");
+    }
+}
+
+}  // namespace oculus
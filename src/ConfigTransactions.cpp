@@ -0,0 +1,242 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/ConfigTransactions.h"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace oculus {
+
+ConfigTransactions::ConfigTransactions() :
+    nextId_(1),
+    appliedCount_(0),
+    supersededCount_(0),
+    failedCount_(0),
+    // Sound speed changes were seen taking up to 6 seconds.
+    timeout_(std::chrono::seconds(15))
+{}
+
+const char* ConfigTransactions::field_name(Field field)
+{
+    switch (field) {
+        case MasterMode:      return "master_mode";
+        case GammaCorrection: return "gamma_correction";
+        case Flags:           return "flags";
+        case Range:           return "range";
+        case Gain:            return "gain";
+        case SpeedOfSound:    return "speed_of_sound";
+        case Salinity:        return "salinity";
+        default:              return "invalid";
+    }
+}
+
+uint32_t ConfigTransactions::changed_fields(const PingConfig& lhs, const PingConfig& rhs)
+{
+    uint32_t fields = 0;
+    if (lhs.masterMode      != rhs.masterMode)      fields |= 1u << MasterMode;
+    if (lhs.gammaCorrection != rhs.gammaCorrection) fields |= 1u << GammaCorrection;
+    if (lhs.flags           != rhs.flags)           fields |= 1u << Flags;
+
+    if (std::abs(lhs.range        - rhs.range)        > 0.001) fields |= 1u << Range;
+    if (std::abs(lhs.gain         - rhs.gain)         > 0.1)   fields |= 1u << Gain;
+    if (std::abs(lhs.speedOfSound - rhs.speedOfSound) > 0.1)   fields |= 1u << SpeedOfSound;
+    if (std::abs(lhs.salinity     - rhs.salinity)     > 0.1)   fields |= 1u << Salinity;
+    return fields;
+}
+
+ConfigTransactions::Future ConfigTransactions::begin(const PingConfig& current,
+                                                     const PingConfig& request)
+{
+    std::unique_ptr<Transaction> superseded;
+    std::unique_ptr<Transaction> immediate;  // nothing to wait for
+    Future future;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (pending_ && changed_fields(pending_->request, request) == 0) {
+            // Same request sent again (retry), the transaction goes on.
+            return pending_->future;
+        }
+        superseded = std::move(pending_);
+
+        auto transaction = std::make_unique<Transaction>();
+        transaction->id            = nextId_++;
+        transaction->request       = request;
+        transaction->fields        = changed_fields(current, request);
+        transaction->pendingFields = transaction->fields;
+        transaction->sent          = Clock::now();
+        transaction->future        = transaction->promise.get_future().share();
+        future = transaction->future;
+
+        if (transaction->fields == 0) {
+            appliedCount_++;
+            immediate = std::move(transaction);
+        }
+        else {
+            pending_ = std::move(transaction);
+        }
+        if (superseded) {
+            supersededCount_++;
+        }
+    }
+
+    if (superseded) {
+        resolve(*superseded, Superseded);
+    }
+    if (immediate) {
+        Result result;
+        result.id       = immediate->id;
+        result.applied  = true;
+        result.status   = Applied;
+        result.feedback = current;
+        appliedCallbacks_(result);
+        immediate->promise.set_value(result);
+    }
+    return future;
+}
+
+void ConfigTransactions::on_feedback(const PingConfig& feedback)
+{
+    auto now = Clock::now();
+    std::unique_ptr<Transaction> applied;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!pending_) return;
+
+        uint32_t settled = pending_->pendingFields & ~changed_fields(pending_->request, feedback);
+        for (unsigned int i = 0; i < FieldCount; i++) {
+            if (settled & (1u << i)) {
+                fieldHistograms_[i].record(now - pending_->sent);
+            }
+        }
+        pending_->pendingFields &= ~settled;
+        if (pending_->pendingFields != 0) return;
+
+        totalHistogram_.record(now - pending_->sent);
+        appliedCount_++;
+        applied = std::move(pending_);
+    }
+
+    Result result;
+    result.id         = applied->id;
+    result.applied    = true;
+    result.status     = Applied;
+    result.fields     = applied->fields;
+    result.feedback   = feedback;
+    result.settleTime = now - applied->sent;
+    // Callbacks first, so they are done when the waiters wake up.
+    appliedCallbacks_(result);
+    applied->promise.set_value(result);
+}
+
+/**
+ * Ends a transaction which was not applied. To be called without holding the
+ * mutex (the waiters may start a new transaction right away).
+ */
+void ConfigTransactions::resolve(Transaction& transaction, Status status)
+{
+    Result result;
+    result.id      = transaction.id;
+    result.applied = false;
+    result.status  = status;
+    result.fields  = transaction.fields;
+    transaction.promise.set_value(result);
+}
+
+void ConfigTransactions::abort()
+{
+    std::unique_ptr<Transaction> aborted;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!pending_) return;
+        failedCount_++;
+        aborted = std::move(pending_);
+    }
+    resolve(*aborted, Aborted);
+}
+
+void ConfigTransactions::check_timeout(const TimePoint& now)
+{
+    std::unique_ptr<Transaction> expired;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!pending_ || now - pending_->sent < timeout_) return;
+        failedCount_++;
+        expired = std::move(pending_);
+    }
+    resolve(*expired, TimedOut);
+}
+
+void ConfigTransactions::set_timeout(const Clock::duration& timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    timeout_ = timeout;
+}
+
+ConfigTransactions::Clock::duration ConfigTransactions::timeout() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return timeout_;
+}
+
+bool ConfigTransactions::pending() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return pending_ != nullptr;
+}
+
+std::size_t ConfigTransactions::applied_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return appliedCount_;
+}
+
+std::size_t ConfigTransactions::superseded_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return supersededCount_;
+}
+
+std::size_t ConfigTransactions::failed_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return failedCount_;
+}
+
+void ConfigTransactions::reset()
+{
+    for (auto& h : fieldHistograms_) {
+        h.reset();
+    }
+    totalHistogram_.reset();
+}
+
+std::string ConfigTransactions::summary() const
+{
+    std::ostringstream oss;
+    for (unsigned int i = 0; i < FieldCount; i++) {
+        if (fieldHistograms_[i].count() == 0) continue;
+        oss << "- " << field_name(static_cast<Field>(i)) << " : "
+            << fieldHistograms_[i].summary() << '\n';
+    }
+    oss << "- total : " << totalHistogram_.summary() << '\n';
+    return oss.str();
+}
+
+}  // namespace oculus
@@ -0,0 +1,257 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/DemandController.h"
+
+#include "oculus_driver/print_utils.h"
+
+namespace oculus {
+
+DemandController::Subscription::Subscription(DemandController& controller,
+                                             uint64_t id, double minRate) :
+    controller_(controller),
+    id_(id),
+    minRate_(minRate)
+{}
+
+DemandController::Subscription::~Subscription()
+{
+    controller_.driver_.ping_callbacks().remove(handle_);
+    controller_.remove(id_);
+}
+
+DemandController::DemandController(SonarDriver& driver,
+                                   const std::shared_ptr<spdlog::logger>& logger) :
+    logger(logger->clone("oculus::DemandController")),
+    driver_(driver),
+    standbyTimer_(driver.strand()),
+    nextId_(1),
+    fullRate_(PingRateNormal),
+    standbyDelay_(std::chrono::seconds(2)),
+    enabled_(true),
+    currentRate_(UnknownRate),
+    standbyPending_(false),
+    standbyId_(0),
+    resuming_(false)
+{
+    stats_.rate = UnknownRate;
+    pingHandle_ = driver_.ping_callbacks().append(alive_.guard(
+        [this](const PingMessage::ConstPtr&) { this->on_ping(); }));
+    connectHandle_ = driver_.connect_callbacks().append(alive_.guard(
+        std::bind(&DemandController::on_connect, this)));
+    boost::asio::post(driver_.strand(),
+                      alive_.guard(std::bind(&DemandController::update, this)));
+}
+
+DemandController::~DemandController()
+{
+    // The updates still pending in the strand do nothing after this.
+    alive_.kill();
+    driver_.ping_callbacks().remove(pingHandle_);
+    driver_.connect_callbacks().remove(connectHandle_);
+}
+
+DemandController::Subscription::Ptr DemandController::subscribe(const PingCallback& callback,
+                                                                double minRate)
+{
+    Subscription::Ptr subscription;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        subscription = std::make_shared<Subscription>(*this, nextId_++, minRate);
+        demands_[subscription->id_] = minRate;
+        stats_.subscribers = demands_.size();
+    }
+    if (callback) {
+        subscription->handle_ = driver_.ping_callbacks().append(callback);
+    }
+    boost::asio::post(driver_.strand(),
+                      alive_.guard(std::bind(&DemandController::update, this)));
+    return subscription;
+}
+
+void DemandController::remove(uint64_t id)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        demands_.erase(id);
+        stats_.subscribers = demands_.size();
+    }
+    boost::asio::post(driver_.strand(),
+                      alive_.guard(std::bind(&DemandController::update, this)));
+}
+
+void DemandController::set_full_rate(uint8_t rate)
+{
+    if (rate == PingRateStandby || ping_rate_frequency(rate) <= 0.0) {
+        throw std::runtime_error("DemandController : invalid full ping rate");
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        fullRate_ = rate;
+    }
+    boost::asio::post(driver_.strand(),
+                      alive_.guard(std::bind(&DemandController::update, this)));
+}
+
+void DemandController::set_standby_delay(const Clock::duration& delay)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    standbyDelay_ = delay;
+}
+
+void DemandController::set_enabled(bool enabled)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        enabled_ = enabled;
+    }
+    boost::asio::post(driver_.strand(), alive_.guard([this]() {
+        // The sonar may have been reconfigured while disabled.
+        currentRate_ = UnknownRate;
+        this->update();
+    }));
+}
+
+DemandController::Stats DemandController::stats() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+/**
+ * Slowest rate satisfying all the subscribers (mutex_ locked).
+ */
+uint8_t DemandController::target_rate() const
+{
+    if (demands_.empty()) return PingRateStandby;
+
+    double minRate = 0.0;
+    for (const auto& demand : demands_) {
+        if (demand.second <= 0.0) return fullRate_;
+        minRate = std::max(minRate, demand.second);
+    }
+    // From the slowest to the fastest.
+    for (uint8_t rate : {PingRateLowest, PingRateLow, PingRateNormal,
+                         PingRateHigh, PingRateHighest}) {
+        if (ping_rate_frequency(rate) >= minRate) return rate;
+    }
+    return PingRateHighest;
+}
+
+void DemandController::update()
+{
+    uint8_t target;
+    Clock::duration standbyDelay;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!enabled_) return;
+        target       = this->target_rate();
+        standbyDelay = standbyDelay_;
+    }
+    if (!driver_.connected()) return;  // applied on connection
+
+    if (target == PingRateStandby) {
+        if (currentRate_ == PingRateStandby || standbyPending_) return;
+        // Waiting a bit before the standby, a subscriber may come back.
+        standbyPending_ = true;
+        auto id = ++standbyId_;
+        standbyTimer_.expires_after(standbyDelay);
+        standbyTimer_.async_wait(alive_.guard([this, id](const boost::system::error_code& err) {
+            if (err || id != standbyId_) return;
+            standbyPending_ = false;
+            bool standby;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                standby = enabled_ && this->target_rate() == PingRateStandby;
+            }
+            if (standby && driver_.connected()) {
+                this->apply(PingRateStandby);
+            }
+        }));
+        return;
+    }
+
+    if (standbyPending_) {
+        standbyPending_ = false;
+        standbyId_++;
+        standbyTimer_.cancel();
+    }
+    if (target != currentRate_) {
+        this->apply(target);
+    }
+}
+
+void DemandController::apply(uint8_t rate)
+{
+    auto config = driver_.last_ping_config();
+    config.pingRate = rate;
+    driver_.send_ping_config(config);
+
+    auto now = Clock::now();
+    Transition transition;
+    transition.stamp = now;
+    transition.from  = currentRate_;
+    transition.to    = rate;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        transition.subscribers = demands_.size();
+        stats_.transitions++;
+        stats_.rate = rate;
+        if (rate == PingRateStandby) {
+            stats_.standbys++;
+        }
+        else if (currentRate_ == PingRateStandby) {
+            stats_.resumes++;
+            stats_.standbyTime += now - standbyStart_;
+        }
+    }
+    if (rate == PingRateStandby) {
+        standbyStart_ = now;
+        resuming_     = false;
+    }
+    else if (currentRate_ == PingRateStandby || currentRate_ == UnknownRate) {
+        resuming_    = true;
+        resumeStamp_ = now;
+    }
+
+    logger->info("Ping rate {} -> {} ({} subscribers)",
+                 transition.from == UnknownRate ? std::string("unknown")
+                     : to_string(static_cast<PingRateType>(transition.from)),
+                 to_string(static_cast<PingRateType>(rate)), transition.subscribers);
+    currentRate_ = rate;
+    transitionCallbacks_(transition);
+}
+
+void DemandController::on_ping()
+{
+    // In the strand (driver ping callbacks)
+    if (!resuming_) return;
+    resuming_ = false;
+    resumeLatency_.record(Clock::now() - resumeStamp_);
+}
+
+void DemandController::on_connect()
+{
+    // The rate of the sonar is not known on a new connection. Applying the
+    // demand after the other connect callbacks, so it is the last config sent.
+    currentRate_ = UnknownRate;
+    boost::asio::post(driver_.strand(),
+                      alive_.guard(std::bind(&DemandController::update, this)));
+}
+
+}  // namespace oculus
@@ -0,0 +1,389 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/FileIndex.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarImageCodec.h"
+
+namespace oculus {
+
+namespace {
+
+struct IndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint64_t entryCount;
+    uint64_t fileSize;
+    int64_t  fileTime;
+};
+
+bool file_info(const std::string& filename, uint64_t& size, int64_t& time)
+{
+    struct stat info;
+    if (::stat(filename.c_str(), &info) != 0)
+        return false;
+    size = info.st_size;
+    time = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+// FNV-1a
+struct Hash
+{
+    uint32_t value = 2166136261u;
+
+    template <typename T>
+    void add(const T& field) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&field);
+        for (std::size_t i = 0; i < sizeof(T); i++) {
+            value = (value ^ bytes[i]) * 16777619u;
+        }
+    }
+};
+
+template <typename PingResult>
+uint32_t ping_config_hash(const uint8_t* data)
+{
+    PingResult ping;
+    std::memcpy(&ping, data, sizeof(ping));
+    Hash hash;
+    hash.add(ping.fireMessage.masterMode);
+    hash.add(ping.fireMessage.networkSpeed);
+    hash.add(ping.fireMessage.gammaCorrection);
+    hash.add(ping.fireMessage.flags);
+    hash.add(ping.fireMessage.range);
+    hash.add(ping.fireMessage.gain);
+    hash.add(ping.fireMessage.speedOfSound);
+    hash.add(ping.fireMessage.salinity);
+    hash.add(ping.dataSize);
+    hash.add(ping.nRanges);
+    hash.add(ping.nBeams);
+    hash.add(ping.imageSize);
+    return hash.value ? hash.value : 1;
+}
+
+template <typename PingResult>
+uint32_t ping_id(const uint8_t* data)
+{
+    PingResult ping;
+    std::memcpy(&ping, data, sizeof(ping));
+    return ping.pingId;
+}
+
+void fill_entry(FileIndex::Entry& entry, const uint8_t* data, std::size_t size)
+{
+    if (size < sizeof(OculusMessageHeader))
+        return;
+    OculusMessageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    entry.messageId  = header.msgId;
+    entry.configHash = FileIndex::config_hash(data, size);
+    if (entry.configHash == 0)
+        return;
+    entry.flags |= FileIndex::Ping;
+    entry.pingId = header.msgVersion == 2 ? ping_id<OculusSimplePingResult2>(data)
+                                          : ping_id<OculusSimplePingResult>(data);
+}
+
+}  // namespace
+
+FileIndex::FileIndex() :
+    timeOrdered_(true),
+    fileSize_(0),
+    fileTime_(0)
+{}
+
+uint32_t FileIndex::config_hash(const uint8_t* data, std::size_t size)
+{
+    if (size < sizeof(OculusMessageHeader))
+        return 0;
+    OculusMessageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.msgId != MsgSimplePingResult)
+        return 0;
+    if (header.msgVersion == 2) {
+        if (size < sizeof(OculusSimplePingResult2)) return 0;
+        return ping_config_hash<OculusSimplePingResult2>(data);
+    }
+    if (size < sizeof(OculusSimplePingResult)) return 0;
+    return ping_config_hash<OculusSimplePingResult>(data);
+}
+
+/**
+ * A SonarImage item needs the prefix of the previous SonarImage item (which
+ * needs the one before, up to a keyframe). The other compressions do not
+ * depend on anything, but a reader moved to them must still follow the
+ * SonarImage items before them to read the SonarImage items after them.
+ */
+void FileIndex::update_lookups()
+{
+    pings_.clear();
+    decodeStarts_.resize(entries_.size());
+    timeOrdered_ = true;
+
+    std::size_t keyframe   = 0;
+    bool        referenced = false;  // a SonarImage item was seen
+    for (std::size_t i = 0; i < entries_.size(); i++) {
+        const auto& entry = entries_[i];
+        if (entry.compression == SonarImage && entry.is_keyframe()) {
+            keyframe = i;
+            decodeStarts_[i] = i;
+        }
+        else {
+            decodeStarts_[i] = referenced ? keyframe : i;
+        }
+        referenced |= entry.compression == SonarImage;
+
+        if (!entry.is_ping())
+            continue;
+        if (!pings_.empty() && entry.stamp < entries_[pings_.back()].stamp)
+            timeOrdered_ = false;
+        pings_.push_back(i);
+    }
+}
+
+/**
+ * Only the start of the payloads is read (peek_next_item()), enough for the
+ * ping metadata. The SonarImage items have their prefix decoded in sequence
+ * to follow the xor reference of the codec.
+ */
+FileIndex::Ptr FileIndex::build(const std::string& filename)
+{
+    auto index = std::make_shared<FileIndex>();
+    if (!file_info(filename, index->fileSize_, index->fileTime_)) {
+        std::ostringstream oss;
+        oss << "Could not open file for reading : " << filename;
+        throw std::runtime_error(oss.str());
+    }
+
+    FileReader reader(filename);
+    SonarImageDecoder    decoder;
+    std::vector<uint8_t> buffer;
+    while (reader.next_item_header().type != 0) {
+        auto item = reader.next_item_header();
+        if (item.type != blueprint::rt_oculusSonar) {
+            reader.jump_item();
+            continue;
+        }
+        std::size_t position = reader.current_item_position();
+        if (position + sizeof(item) + item.payloadSize > index->fileSize_)
+            break;  // recording interrupted
+
+        Entry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.offset      = position;
+        entry.compression = item.compression;
+        entry.flags       = Keyframe;
+
+        const uint8_t* data = buffer.data();
+        std::size_t    size = 0;
+        try {
+            if (item.compression == NoCompression) {
+                buffer.resize(sizeof(OculusSimplePingResult2));
+                size = reader.peek_next_item(buffer.data(), buffer.size());
+                data = buffer.data();
+                reader.jump_item();
+            }
+            else if (item.compression == SonarImage) {
+                std::size_t count = reader.peek_image_prefix(buffer);
+                if (!SonarImageDecoder::is_keyframe(buffer.data(), count))
+                    entry.flags &= ~Keyframe;
+                const auto& prefix = decoder.decode_prefix(buffer.data(), count);
+                data = prefix.data();
+                size = prefix.size();
+                reader.jump_item();
+            }
+            else {
+                reader.read_next_item(buffer);
+                data = buffer.data();
+                size = buffer.size();
+            }
+        }
+        catch (const std::runtime_error& e) {
+            std::ostringstream oss;
+            oss << "oculus::FileIndex : could not read item at " << position
+                << " : " << e.what() << "\n";
+            oss << "    file : '" << filename << "'";
+            throw std::runtime_error(oss.str());
+        }
+        fill_entry(entry, data, size);
+
+        // Same timestamp as FileReader::read_next_message()
+        if (reader.next_item_header().type == blueprint::rt_oculusSonarStamp
+            && reader.next_item_header().payloadSize == sizeof(FileReader::TimeStamp))
+        {
+            FileReader::TimeStamp stamp;
+            reader.read_next_item(reinterpret_cast<uint8_t*>(&stamp));
+            entry.stamp = 1000000000*stamp.seconds + stamp.nanoseconds;
+        }
+        else {
+            entry.stamp = 1000000000*item.time;
+        }
+        index->entries_.push_back(entry);
+    }
+    index->update_lookups();
+    return index;
+}
+
+FileIndex::Ptr FileIndex::load(const std::string& indexFilename)
+{
+    std::ifstream file(indexFilename, std::ifstream::binary);
+    if (!file.is_open()) {
+        std::ostringstream oss;
+        oss << "Could not open file for reading : " << indexFilename;
+        throw std::runtime_error(oss.str());
+    }
+
+    IndexHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != MagicNumber || header.version != Version
+        || header.entrySize != sizeof(Entry))
+    {
+        std::ostringstream oss;
+        oss << "oculus::FileIndex : invalid index file header.\n";
+        oss << "    file : '" << indexFilename << "'";
+        throw std::runtime_error(oss.str());
+    }
+
+    // entryCount is checked before allocating, a corrupted one must not
+    // escape load_or_build() as a bad_alloc.
+    file.seekg(0, std::ios::end);
+    std::size_t entriesSize = (std::size_t)file.tellg() - sizeof(header);
+    file.seekg(sizeof(header));
+    if (header.entryCount > entriesSize / sizeof(Entry)) {
+        std::ostringstream oss;
+        oss << "oculus::FileIndex : truncated index file.\n";
+        oss << "    file : '" << indexFilename << "'";
+        throw std::runtime_error(oss.str());
+    }
+
+    auto index = std::make_shared<FileIndex>();
+    index->fileSize_ = header.fileSize;
+    index->fileTime_ = header.fileTime;
+    index->entries_.resize(header.entryCount);
+    if (!file.read(reinterpret_cast<char*>(index->entries_.data()),
+                   sizeof(Entry) * index->entries_.size()))
+    {
+        std::ostringstream oss;
+        oss << "oculus::FileIndex : truncated index file.\n";
+        oss << "    file : '" << indexFilename << "'";
+        throw std::runtime_error(oss.str());
+    }
+    index->update_lookups();
+    return index;
+}
+
+/**
+ * Written to a temporary file first, a reader never sees a partial index.
+ */
+void FileIndex::save(const std::string& indexFilename) const
+{
+    IndexHeader header;
+    header.magic      = MagicNumber;
+    header.version    = Version;
+    header.entrySize  = sizeof(Entry);
+    header.entryCount = entries_.size();
+    header.fileSize   = fileSize_;
+    header.fileTime   = fileTime_;
+
+    std::string tmpFilename = indexFilename + ".tmp";
+    {
+        std::ofstream file(tmpFilename, std::ofstream::binary | std::ofstream::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries_.data()),
+                   sizeof(Entry) * entries_.size());
+        file.close();
+        if (!file) {
+            std::remove(tmpFilename.c_str());
+            std::ostringstream oss;
+            oss << "Could not write index file : " << indexFilename;
+            throw std::runtime_error(oss.str());
+        }
+    }
+    if (std::rename(tmpFilename.c_str(), indexFilename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        std::ostringstream oss;
+        oss << "Could not write index file : " << indexFilename;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+FileIndex::Ptr FileIndex::load_or_build(const std::string& filename, bool save)
+{
+    std::string indexFilename = FileIndex::sidecar_filename(filename);
+    try {
+        auto index = FileIndex::load(indexFilename);
+        if (index->is_up_to_date(filename))
+            return index;
+    }
+    catch (const std::runtime_error&) {
+        // No sidecar file or invalid one, rebuilding.
+    }
+
+    auto index = FileIndex::build(filename);
+    if (save) {
+        try {
+            index->save(indexFilename);
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << "oculus::FileIndex : " << e.what() << std::endl;
+        }
+    }
+    return index;
+}
+
+bool FileIndex::is_up_to_date(const std::string& filename) const
+{
+    uint64_t size;
+    int64_t  time;
+    return file_info(filename, size, time) && size == fileSize_ && time == fileTime_;
+}
+
+std::size_t FileIndex::find_ping(const Message::TimePoint& stamp) const
+{
+    int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stamp.time_since_epoch()).count();
+    auto before = [&](uint32_t entry) { return entries_[entry].stamp < nanos; };
+    if (timeOrdered_) {
+        return std::partition_point(pings_.begin(), pings_.end(), before) - pings_.begin();
+    }
+    // The clock of the recording went backward at some point.
+    return std::find_if_not(pings_.begin(), pings_.end(), before) - pings_.begin();
+}
+
+std::size_t FileIndex::decode_start(std::size_t entryIndex) const
+{
+    if (entryIndex >= decodeStarts_.size())
+        return entries_.size();  // nothing to read after the end
+    return decodeStarts_[entryIndex];
+}
+
+}  // namespace oculus
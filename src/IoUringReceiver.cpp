@@ -0,0 +1,504 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/IoUringReceiver.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef OCULUS_DRIVER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace oculus {
+
+using namespace std::placeholders;
+
+#ifdef OCULUS_DRIVER_IO_URING
+
+static int io_uring_setup(unsigned int entries, io_uring_params* params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned int toSubmit, unsigned int minComplete = 0)
+{
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                   minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned int opcode, void* arg, unsigned int argCount)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, argCount);
+}
+
+// Last completion of a recv request (user_data 0 is a cancellation).
+static bool ends_recv(const io_uring_cqe& cqe)
+{
+    return cqe.user_data != 0 && !(cqe.flags & IORING_CQE_F_MORE);
+}
+
+static std::runtime_error system_error(const std::string& what)
+{
+    return std::runtime_error("oculus::IoUringReceiver : " + what + " : "
+                              + std::strerror(errno));
+}
+
+/**
+ * Memory shared with the kernel : submission and completion rings, and the
+ * ring of provided buffers.
+ */
+struct IoUringReceiver::Ring
+{
+    int    fd = -1;
+    void*  sqPtr  = MAP_FAILED;
+    size_t sqSize = 0;
+    void*  cqPtr  = MAP_FAILED;
+    size_t cqSize = 0;
+    void*  sqesPtr  = MAP_FAILED;
+    size_t sqesSize = 0;
+
+    unsigned*     sqTail;
+    unsigned*     sqMask;
+    unsigned*     sqArray;
+    io_uring_sqe* sqes;
+    unsigned*     cqHead;
+    unsigned*     cqTail;
+    unsigned*     cqMask;
+    io_uring_cqe* cqes;
+
+    // (io_uring_buf_ring is not used : in C++ its flexible array member is
+    // not at offset 0 as in the kernel)
+    io_uring_buf*        bufRing     = nullptr;
+    uint16_t*            bufRingTail = nullptr;  // overlays bufRing[0].resv
+    size_t               bufRingSize = 0;
+    uint16_t             bufTail     = 0;
+    unsigned int         bufMask     = 0;
+    std::size_t          bufSize     = 0;
+    std::vector<uint8_t> buffers;
+
+    Ring(unsigned int bufferCount, std::size_t bufferSize);
+    ~Ring();
+
+    io_uring_sqe* next_sqe();
+    void add_buffer(unsigned int bid);
+    void publish_buffers() { __atomic_store_n(bufRingTail, bufTail, __ATOMIC_RELEASE); }
+};
+
+IoUringReceiver::Ring::Ring(unsigned int bufferCount, std::size_t bufferSize) :
+    bufMask(bufferCount - 1),
+    bufSize(bufferSize)
+{
+    // The completion queue is large enough for one completion per buffer
+    // (plus cancellations and end of stream).
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags      = IORING_SETUP_CQSIZE;
+    params.cq_entries = std::max(2*bufferCount, 32u);
+    fd = io_uring_setup(8, &params);
+    if (fd < 0)
+        throw system_error("io_uring_setup failed");
+
+    sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sqSize = cqSize = std::max(sqSize, cqSize);
+    sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 fd, IORING_OFF_SQ_RING);
+    if (sqPtr == MAP_FAILED)
+        throw system_error("could not map the submission queue");
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqPtr = sqPtr;
+    }
+    else {
+        cqPtr = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_CQ_RING);
+        if (cqPtr == MAP_FAILED)
+            throw system_error("could not map the completion queue");
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqesPtr  = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQES);
+    if (sqesPtr == MAP_FAILED)
+        throw system_error("could not map the submission entries");
+
+    auto sq = static_cast<uint8_t*>(sqPtr);
+    auto cq = static_cast<uint8_t*>(cqPtr);
+    sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqes    = static_cast<io_uring_sqe*>(sqesPtr);
+    cqHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Provided buffers (group 0). The ring must be page aligned.
+    bufRingSize = bufferCount * sizeof(io_uring_buf);
+    void* ptr = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+        throw system_error("could not allocate the buffer ring");
+    bufRing     = static_cast<io_uring_buf*>(ptr);
+    bufRingTail = &bufRing[0].resv;
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr    = reinterpret_cast<uint64_t>(bufRing);
+    reg.ring_entries = bufferCount;
+    reg.bgid         = 0;
+    if (io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        throw system_error("could not register the buffer ring (needs Linux 5.19)");
+
+    buffers.resize(bufferCount * bufferSize);
+    for (unsigned int bid = 0; bid < bufferCount; bid++) {
+        this->add_buffer(bid);
+    }
+    this->publish_buffers();
+}
+
+IoUringReceiver::Ring::~Ring()
+{
+    // Closing the ring cancels the pending requests.
+    if (fd >= 0)                             close(fd);
+    if (bufRing)                             munmap(bufRing, bufRingSize);
+    if (sqesPtr != MAP_FAILED)               munmap(sqesPtr, sqesSize);
+    if (cqPtr != MAP_FAILED && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+    if (sqPtr != MAP_FAILED)                 munmap(sqPtr, sqSize);
+}
+
+/**
+ * Only one thread at a time submits (the receiver strand), the submission
+ * queue is never full (at most 2 requests in flight).
+ */
+io_uring_sqe* IoUringReceiver::Ring::next_sqe()
+{
+    unsigned tail  = *sqTail;
+    unsigned index = tail & *sqMask;
+    auto sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+void IoUringReceiver::Ring::add_buffer(unsigned int bid)
+{
+    // (the tail overlays the reserved field of bufs[0], it must not be
+    // written here)
+    auto& buf = bufRing[bufTail & bufMask];
+    buf.addr = reinterpret_cast<uint64_t>(buffers.data() + bid * bufSize);
+    buf.len  = bufSize;
+    buf.bid  = bid;
+    bufTail++;
+}
+
+IoUringReceiver::IoUringReceiver(const Strand& strand,
+                                 unsigned int bufferCount,
+                                 std::size_t bufferSize) :
+    strand_(strand),
+    eventFd_(strand.get_inner_executor()),
+    eventCount_(0),
+    bufferCount_(2),
+    bufferSize_(bufferSize),
+    socketFd_(-1),
+    generation_(0),
+    armed_(0),
+    running_(false),
+    waiting_(false),
+    output_(nullptr)
+{
+    while (bufferCount_ < bufferCount && bufferCount_ < 32768)
+        bufferCount_ <<= 1;
+}
+
+IoUringReceiver::~IoUringReceiver()
+{
+    alive_.kill();
+    this->drain();
+    boost::system::error_code err;
+    eventFd_.close(err);
+}
+
+/**
+ * The kernel tears the ring down asynchronously : a recv still armed when the
+ * ring is closed could write into the provided buffers after they are freed.
+ * The recv requests are cancelled and their last completion (without
+ * IORING_CQE_F_MORE) is waited for.
+ */
+void IoUringReceiver::drain()
+{
+    running_ = false;
+    if (!ring_ || armed_ == 0) return;
+
+    auto sqe = ring_->next_sqe();
+    sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+    sqe->fd           = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data    = 0;
+    if (io_uring_enter(ring_->fd, 1) < 0)
+        return;
+
+    while (armed_ > 0) {
+        unsigned head = *ring_->cqHead;
+        unsigned tail = __atomic_load_n(ring_->cqTail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (io_uring_enter(ring_->fd, 0, 1) < 0 && errno != EINTR)
+                return;
+            continue;
+        }
+        for (; head != tail; head++) {
+            if (ends_recv(ring_->cqes[head & *ring_->cqMask]) && armed_ > 0)
+                armed_--;
+        }
+        __atomic_store_n(ring_->cqHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * The provided buffer ring needs Linux 5.19 but the multishot recv needs 6.0
+ * (older kernels fail the recv with EINVAL). A multishot recv is submitted on
+ * a socket pair holding one byte : it must complete with data and with more
+ * completions to come.
+ */
+bool IoUringReceiver::is_supported()
+{
+    static const bool supported = []() {
+        try {
+            Ring ring(2, 4096);
+
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+                return false;
+            uint8_t byte = 0;
+            bool multishot = false;
+            if (write(fds[1], &byte, 1) == 1) {
+                auto sqe = ring.next_sqe();
+                sqe->opcode    = IORING_OP_RECV;
+                sqe->fd        = fds[0];
+                sqe->flags     = IOSQE_BUFFER_SELECT;
+                sqe->buf_group = 0;
+                sqe->ioprio    = IORING_RECV_MULTISHOT;
+                sqe->user_data = 1;
+                if (io_uring_enter(ring.fd, 1, 1) >= 0) {
+                    unsigned head = *ring.cqHead;
+                    if (head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+                        const auto& cqe = ring.cqes[head & *ring.cqMask];
+                        multishot = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+                    }
+                }
+            }
+            // (closing the ring cancels the recv still armed)
+            close(fds[0]);
+            close(fds[1]);
+            return multishot;
+        }
+        catch(const std::exception&) {
+            return false;
+        }
+    }();
+    return supported;
+}
+
+void IoUringReceiver::setup()
+{
+    ring_ = std::make_unique<Ring>(bufferCount_, bufferSize_);
+
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0)
+        throw system_error("could not create eventfd");
+    eventFd_.assign(fd);
+    if (io_uring_register(ring_->fd, IORING_REGISTER_EVENTFD, &fd, 1) < 0)
+        throw system_error("could not register eventfd");
+}
+
+void IoUringReceiver::start(int socketFd, ReceiveBuffer& output,
+                            const DataCallback& onData, const ErrorCallback& onError)
+{
+    if (!ring_)
+        this->setup();
+    if (running_)
+        this->stop();
+
+    socketFd_      = socketFd;
+    output_        = &output;
+    dataCallback_  = onData;
+    errorCallback_ = onError;
+    running_       = true;
+    generation_++;  // completions of a previous connection are ignored
+
+    this->submit_recv();
+    if (!waiting_)
+        this->wait_completions();
+}
+
+void IoUringReceiver::stop()
+{
+    if (!running_) return;
+    running_ = false;
+
+    auto sqe = ring_->next_sqe();
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = generation_;
+    sqe->user_data = 0;  // (generations start at 1)
+    io_uring_enter(ring_->fd, 1);
+    stats_.submissions++;
+    generation_++;
+}
+
+void IoUringReceiver::submit_recv()
+{
+    auto sqe = ring_->next_sqe();
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = socketFd_;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->user_data = generation_;
+    if (io_uring_enter(ring_->fd, 1) < 0) {
+        this->fail(boost::system::error_code(errno, boost::system::system_category()));
+        return;
+    }
+    armed_++;
+    stats_.submissions++;
+}
+
+/**
+ * The eventfd is read instead of only waited for : asio tries a read before
+ * waiting, so a completion signalled while no handler was pending is not
+ * missed (the socket is registered edge-triggered in epoll).
+ */
+void IoUringReceiver::wait_completions()
+{
+    waiting_ = true;
+    eventFd_.async_read_some(boost::asio::buffer(&eventCount_, sizeof(eventCount_)),
+        boost::asio::bind_executor(strand_,
+            alive_.guard(std::bind(&IoUringReceiver::completions_callback, this, _1))));
+}
+
+void IoUringReceiver::completions_callback(const boost::system::error_code& err)
+{
+    waiting_ = false;
+    if (err == boost::asio::error::operation_aborted)
+        return;
+    stats_.wakeups++;
+
+    bool delivered = false;
+    bool rearm     = false;
+    boost::system::error_code failure;
+
+    unsigned head = *ring_->cqHead;
+    unsigned tail = __atomic_load_n(ring_->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const auto& cqe = ring_->cqes[head & *ring_->cqMask];
+        if (ends_recv(cqe) && armed_ > 0)
+            armed_--;
+        if (running_ && cqe.user_data == generation_) {
+            if (cqe.res > 0) {
+                unsigned int bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                auto buffer = output_->prepare(cqe.res);
+                std::memcpy(buffer.data(), ring_->buffers.data() + bid * bufferSize_, cqe.res);
+                output_->commit(cqe.res);
+                delivered = true;
+                stats_.completions++;
+                stats_.bytes += cqe.res;
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                    rearm = true;
+            }
+            else if (cqe.res == 0) {
+                failure = boost::asio::error::eof;
+            }
+            else if (cqe.res == -ENOBUFS) {
+                // All the buffers were in use, they are given back below.
+                stats_.noBuffers++;
+                rearm = true;
+            }
+            else if (cqe.res != -ECANCELED) {
+                failure = boost::system::error_code(-cqe.res, boost::system::system_category());
+            }
+        }
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+            ring_->add_buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+    __atomic_store_n(ring_->cqHead, head, __ATOMIC_RELEASE);
+    ring_->publish_buffers();
+
+    if (delivered)
+        dataCallback_();
+    if (failure)
+        this->fail(failure);
+    else if (rearm && running_)
+        this->submit_recv();
+
+    this->wait_completions();
+}
+
+void IoUringReceiver::fail(const boost::system::error_code& err)
+{
+    if (!running_) return;
+    running_ = false;
+    generation_++;
+    errorCallback_(err);
+}
+
+#else  // OCULUS_DRIVER_IO_URING
+
+struct IoUringReceiver::Ring {};
+
+IoUringReceiver::IoUringReceiver(const Strand& strand,
+                                 unsigned int bufferCount,
+                                 std::size_t bufferSize) :
+    strand_(strand),
+    eventFd_(strand.get_inner_executor()),
+    eventCount_(0),
+    bufferCount_(bufferCount),
+    bufferSize_(bufferSize),
+    socketFd_(-1),
+    generation_(0),
+    armed_(0),
+    running_(false),
+    waiting_(false),
+    output_(nullptr)
+{}
+
+IoUringReceiver::~IoUringReceiver() = default;
+
+bool IoUringReceiver::is_supported()
+{
+    return false;
+}
+
+void IoUringReceiver::start(int, ReceiveBuffer&, const DataCallback&, const ErrorCallback&)
+{
+    throw std::runtime_error("oculus::IoUringReceiver : oculus_driver was built without "
+                             "io_uring support (OCULUS_DRIVER_IO_URING=OFF)");
+}
+
+void IoUringReceiver::stop() {}
+
+#endif  // OCULUS_DRIVER_IO_URING
+
+}  // namespace oculus
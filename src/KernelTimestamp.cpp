@@ -0,0 +1,93 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/KernelTimestamp.h"
+
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <time.h>
+#endif
+
+namespace oculus {
+
+#ifdef __linux__
+
+bool enable_kernel_timestamps(int socketFd)
+{
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (::setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+        return true;
+
+    int enable = 1;
+    return ::setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+}
+
+bool peek_kernel_timestamp(int socketFd, Message::TimePoint& stamp)
+{
+    // Peeking a single byte : TCP reports the timestamp of the segment
+    // containing it.
+    uint8_t byte;
+    iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len  = 1;
+
+    alignas(cmsghdr) char control[256];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (::recvmsg(socketFd, &msg, MSG_PEEK | MSG_DONTWAIT) <= 0)
+        return false;
+
+    const timespec* ts = nullptr;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level != SOL_SOCKET) continue;
+        if (c->cmsg_type == SO_TIMESTAMPING || c->cmsg_type == SO_TIMESTAMPNS) {
+            // For SO_TIMESTAMPING the software stamp is the first of 3.
+            ts = reinterpret_cast<const timespec*>(CMSG_DATA(c));
+            break;
+        }
+    }
+    if (!ts || (ts->tv_sec == 0 && ts->tv_nsec == 0))
+        return false;
+
+    stamp = Message::TimePoint(std::chrono::duration_cast<Message::TimePoint::duration>(
+        std::chrono::seconds(ts->tv_sec) + std::chrono::nanoseconds(ts->tv_nsec)));
+    return true;
+}
+
+#else
+
+bool enable_kernel_timestamps(int)
+{
+    return false;
+}
+
+bool peek_kernel_timestamp(int, Message::TimePoint&)
+{
+    return false;
+}
+
+#endif
+
+}  // namespace oculus
@@ -0,0 +1,166 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/LatencyHistogram.h"
+
+#include <bit>
+#include <limits>
+#include <sstream>
+
+namespace oculus {
+
+LatencyHistogram::LatencyHistogram()
+{
+    this->reset();
+}
+
+/**
+ * Values below 2*SubBucketCount have their own bucket. Above, each power of two
+ * [2^m, 2^(m+1)[ is split in SubBucketCount buckets of width 2^(m - SubBucketBits).
+ */
+unsigned int LatencyHistogram::bucket_index(uint64_t value)
+{
+    constexpr uint64_t maxValue = (uint64_t(1) << MaxValueBits) - 1;
+    if (value > maxValue)
+        value = maxValue;
+    if (value < 2*SubBucketCount)
+        return value;
+
+    unsigned int msb   = 63 - std::countl_zero(value);
+    unsigned int shift = msb - SubBucketBits;
+    return shift * SubBucketCount + (value >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(unsigned int index)
+{
+    if (index < 2*SubBucketCount)
+        return index;
+    unsigned int shift = index / SubBucketCount - 1;
+    uint64_t     sub   = index - shift * SubBucketCount;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    counts_[bucket_index(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = min_.load(std::memory_order_relaxed);
+    while (nanoseconds < current &&
+           !min_.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {}
+    current = max_.load(std::memory_order_relaxed);
+    while (nanoseconds > current &&
+           !max_.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& c : counts_) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Duration LatencyHistogram::min() const
+{
+    if (this->count() == 0) return Duration(0);
+    return Duration(min_.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Duration LatencyHistogram::max() const
+{
+    return Duration(max_.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Duration LatencyHistogram::mean() const
+{
+    auto count = this->count();
+    if (count == 0) return Duration(0);
+    return Duration(sum_.load(std::memory_order_relaxed) / count);
+}
+
+/**
+ * Returns the smallest value such that at least p percent of the recorded
+ * values are lower or equal (within the bucket precision).
+ */
+LatencyHistogram::Duration LatencyHistogram::percentile(double p) const
+{
+    uint64_t count = this->count();
+    if (count == 0) return Duration(0);
+
+    uint64_t target = static_cast<uint64_t>(0.01 * p * count + 0.5);
+    if (target < 1)     target = 1;
+    if (target > count) target = count;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < BucketCount; i++) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(Duration(bucket_upper_bound(i)), this->max());
+        }
+    }
+    return this->max();
+}
+
+std::string LatencyHistogram::summary() const
+{
+    auto us = [](const Duration& d) { return 1.0e-3 * d.count(); };
+    std::ostringstream oss;
+    oss << "count " << this->count()
+        << ", mean " << us(this->mean())
+        << "us, p50 " << us(this->percentile(50.0))
+        << "us, p99 " << us(this->percentile(99.0))
+        << "us, p999 " << us(this->percentile(99.9))
+        << "us, max " << us(this->max()) << "us";
+    return oss.str();
+}
+
+const char* ReceiveLatency::stage_name(Stage stage)
+{
+    switch (stage) {
+        case HeaderToPayload:  return "header_to_payload";
+        case PayloadToHandler: return "payload_to_handler";
+        case MessageCallbacks: return "message_callbacks";
+        case PingCallbacks:    return "ping_callbacks";
+        case Total:            return "total";
+        default:               return "invalid";
+    }
+}
+
+void ReceiveLatency::reset()
+{
+    for (auto& h : histograms_) {
+        h.reset();
+    }
+}
+
+std::string ReceiveLatency::summary() const
+{
+    std::ostringstream oss;
+    for (unsigned int i = 0; i < StageCount; i++) {
+        oss << "- " << stage_name(static_cast<Stage>(i)) << " : "
+            << histograms_[i].summary() << '\n';
+    }
+    return oss.str();
+}
+
+}  // namespace oculus
@@ -0,0 +1,240 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/MessageDispatcher.h"
+
+#include <algorithm>
+
+namespace oculus {
+
+MessageDispatcher::Subscriber::Subscriber(const std::string& name, Policy policy,
+                                          std::size_t capacity,
+                                          const MessageCallback& callback) :
+    name_(name),
+    policy_(policy),
+    callback_(callback),
+    queue_(policy == LatestOnly ? 2 : capacity),  // (minimum capacity is 2)
+    running_(true),
+    pushCount_(0),
+    popCount_(0),
+    receivedCount_(0),
+    deliveredCount_(0),
+    droppedCount_(0)
+{}
+
+MessageDispatcher::Subscriber::~Subscriber()
+{
+    this->stop();
+}
+
+void MessageDispatcher::Subscriber::stop()
+{
+    if (!running_.exchange(false)) return;
+    pushCount_.fetch_add(1);
+    pushCount_.notify_all();
+    popCount_.fetch_add(1);
+    popCount_.notify_all();  // a Block producer may be waiting
+    // From the callback, run() returns after it and releases the subscriber.
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id())
+        thread_.join();
+    else if (thread_.joinable())
+        thread_.detach();
+}
+
+void MessageDispatcher::Subscriber::start()
+{
+    thread_ = std::thread(&Subscriber::run, this->shared_from_this());
+}
+
+void MessageDispatcher::Subscriber::run()
+{
+    Message::ConstPtr message;
+    while (running_) {
+        if (!queue_.try_pop(message)) {
+            auto count = pushCount_.load(std::memory_order_acquire);
+            // checking again, a push may have happened before the load
+            if (!queue_.try_pop(message)) {
+                pushCount_.wait(count, std::memory_order_acquire);
+                continue;
+            }
+        }
+        popCount_.fetch_add(1, std::memory_order_release);
+        if (policy_ == Block)
+            popCount_.notify_one();
+
+        callback_(message);
+        message.reset();  // not holding a pooled buffer while waiting
+        deliveredCount_++;
+    }
+}
+
+void MessageDispatcher::Subscriber::push(const Message::ConstPtr& message)
+{
+    if (!running_) return;
+    receivedCount_++;
+
+    switch (policy_)
+    {
+    case Block:
+        while (!queue_.try_push(message)) {
+            auto count = popCount_.load(std::memory_order_acquire);
+            if (queue_.try_push(message)) break;
+            if (!running_) return;
+            popCount_.wait(count, std::memory_order_acquire);
+        }
+        break;
+    case LatestOnly:
+        {
+            Message::ConstPtr previous;
+            while (queue_.try_pop(previous)) {
+                droppedCount_++;
+            }
+        }
+        [[fallthrough]];
+    case DropOldest:
+        while (!queue_.try_push(message)) {
+            Message::ConstPtr oldest;
+            if (queue_.try_pop(oldest)) {
+                droppedCount_++;
+            }
+        }
+        break;
+    case DropNewest:
+        if (!queue_.try_push(message)) {
+            droppedCount_++;
+            return;
+        }
+        break;
+    }
+
+    pushCount_.fetch_add(1, std::memory_order_release);
+    pushCount_.notify_one();
+}
+
+MessageDispatcher::Stats MessageDispatcher::Subscriber::stats() const
+{
+    Stats res;
+    res.name      = name_;
+    res.policy    = policy_;
+    res.capacity  = policy_ == LatestOnly ? 1 : queue_.capacity();
+    res.queued    = queue_.size();
+    res.received  = receivedCount_;
+    res.delivered = deliveredCount_;
+    res.dropped   = droppedCount_;
+    return res;
+}
+
+MessageDispatcher::MessageDispatcher(const std::shared_ptr<spdlog::logger>& logger) :
+    logger(logger->clone("oculus::MessageDispatcher")),
+    subscribers_(std::make_shared<SubscriberList>())
+{}
+
+MessageDispatcher::~MessageDispatcher()
+{
+    // A message being dispatched in a driver thread is waited for.
+    alive_.kill();
+    for (auto& connection : connections_) {
+        connection.first->message_callbacks().remove(connection.second);
+    }
+
+    auto subscribers = this->snapshot();
+    this->publish(std::make_shared<SubscriberList>());
+    for (auto& subscriber : *subscribers) {
+        subscriber->stop();
+    }
+}
+
+MessageDispatcher::Subscriber::Ptr MessageDispatcher::subscribe(
+    const MessageCallback& callback, Policy policy,
+    std::size_t capacity, const std::string& name)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto subscribers = std::make_shared<SubscriberList>(*this->snapshot());
+    auto subscriber  = std::make_shared<Subscriber>(
+        name.empty() ? "subscriber_" + std::to_string(subscribers->size()) : name,
+        policy, std::max<std::size_t>(capacity, 1), callback);
+    subscriber->start();
+    subscribers->push_back(subscriber);
+    this->publish(std::move(subscribers));
+    return subscriber;
+}
+
+MessageDispatcher::Subscriber::Ptr MessageDispatcher::subscribe_pings(
+    const PingCallback& callback, Policy policy,
+    std::size_t capacity, const std::string& name)
+{
+    return this->subscribe([callback](const Message::ConstPtr& message) {
+        if (message->is_ping_message())
+            callback(PingMessage::Create(message));
+    }, policy, capacity, name);
+}
+
+void MessageDispatcher::unsubscribe(const Subscriber::Ptr& subscriber)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto subscribers = std::make_shared<SubscriberList>(*this->snapshot());
+        subscribers->erase(std::remove(subscribers->begin(), subscribers->end(), subscriber),
+                           subscribers->end());
+        this->publish(std::move(subscribers));
+    }
+    subscriber->stop();
+}
+
+std::shared_ptr<const MessageDispatcher::SubscriberList> MessageDispatcher::snapshot() const
+{
+    std::unique_lock<std::mutex> lock(snapshotMutex_);
+    return subscribers_;
+}
+
+void MessageDispatcher::publish(std::shared_ptr<const SubscriberList> subscribers)
+{
+    std::unique_lock<std::mutex> lock(snapshotMutex_);
+    subscribers_.swap(subscribers);
+    // The previous list is released outside of the lock.
+    lock.unlock();
+}
+
+void MessageDispatcher::dispatch(const Message::ConstPtr& message)
+{
+    auto subscribers = this->snapshot();
+    for (auto& subscriber : *subscribers) {
+        subscriber->push(message);
+    }
+}
+
+SonarDriver::MessageCallbacksType::Handle MessageDispatcher::connect(SonarDriver& driver)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto handle = driver.message_callbacks().append(alive_.guard(
+        [this](const Message::ConstPtr& message) { this->dispatch(message); }));
+    connections_.emplace_back(&driver, handle);
+    return handle;
+}
+
+std::vector<MessageDispatcher::Stats> MessageDispatcher::stats() const
+{
+    auto subscribers = this->snapshot();
+    std::vector<Stats> res;
+    for (const auto& subscriber : *subscribers) {
+        res.push_back(subscriber->stats());
+    }
+    return res;
+}
+
+}  // namespace oculus
@@ -0,0 +1,128 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/MessagePool.h"
+
+namespace oculus {
+
+MessagePool::MessagePool(std::size_t capacity) :
+    capacity_(capacity),
+    maxMessageSize_(0),
+    allocationCount_(0)
+{
+    free_.reserve(capacity_);
+}
+
+MessagePool::Ptr MessagePool::Create(std::size_t capacity)
+{
+    return Ptr(new MessagePool(capacity));
+}
+
+/**
+ * Returns a Message with a data buffer able to hold at least messageSize bytes
+ * (and at least max_message_size() bytes) without reallocation.
+ *
+ * The content of the returned message is unspecified (it may hold data from a
+ * previously released message).
+ */
+Message::Ptr MessagePool::acquire(std::size_t messageSize)
+{
+    std::unique_ptr<Message> message;
+    std::size_t reservedSize;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (messageSize > maxMessageSize_)
+            maxMessageSize_ = messageSize;
+        reservedSize = maxMessageSize_;
+
+        if (!free_.empty()) {
+            message = std::move(free_.back());
+            free_.pop_back();
+        }
+        else {
+            allocationCount_++;
+        }
+    }
+    if (!message) {
+        message = std::make_unique<Message>();
+    }
+
+    // Done outside of the lock. This is a no-op in steady state.
+    message->data_.reserve(reservedSize);
+
+    // The deleter holds a weak reference to the pool so that messages still
+    // held by the user when the pool is destroyed are simply deallocated.
+    std::weak_ptr<MessagePool> pool = this->shared_from_this();
+    return Message::Ptr(message.release(), [pool](Message* msg) {
+        if (auto p = pool.lock()) {
+            p->release(msg);
+        }
+        else {
+            delete msg;
+        }
+    });
+}
+
+void MessagePool::release(Message* message)
+{
+    std::unique_ptr<Message> msg(message);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_.size() < capacity_) {
+        free_.push_back(std::move(msg));
+    }
+    // else msg is deallocated when going out of scope
+}
+
+std::size_t MessagePool::capacity() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+void MessagePool::set_capacity(std::size_t capacity)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    if (free_.size() > capacity_) {
+        free_.resize(capacity_);
+    }
+}
+
+std::size_t MessagePool::available() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+std::size_t MessagePool::max_message_size() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return maxMessageSize_;
+}
+
+/**
+ * Total number of Message allocations performed by the pool. This stops
+ * increasing once the pool holds enough buffers for the application.
+ */
+std::size_t MessagePool::allocation_count() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return allocationCount_;
+}
+
+}  // namespace oculus
@@ -0,0 +1,296 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/MmapFileReader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace oculus {
+
+struct MmapFileReader::Mapping
+{
+    void*       address;
+    std::size_t size;
+
+    Mapping(void* address, std::size_t size) : address(address), size(size) {}
+    ~Mapping() { ::munmap(address, size); }
+};
+
+MmapFileReader::MmapFileReader(const std::string& filename) :
+    data_(nullptr),
+    size_(0),
+    itemPosition_(0)
+{
+    std::memset(&fileHeader_, 0, sizeof(fileHeader_));
+    std::memset(&nextItem_,   0, sizeof(nextItem_));
+    this->open(filename);
+}
+
+MmapFileReader::~MmapFileReader()
+{
+    this->close();
+}
+
+void MmapFileReader::open(const std::string& filename)
+{
+    this->close();
+    filename_ = filename;
+    index_.reset();
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::ostringstream oss;
+        oss << "Could not open file for reading : " << filename;
+        throw std::runtime_error(oss.str());
+    }
+    struct stat info;
+    std::size_t size = ::fstat(fd, &info) == 0 ? info.st_size : 0;
+    if (size < sizeof(fileHeader_)) {
+        ::close(fd);
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : error reading file header.\n";
+        oss << "    file : '" << filename_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);  // the mapping keeps the file open
+    if (address == MAP_FAILED) {
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : could not map file (" << std::strerror(error) << ").\n";
+        oss << "    file : '" << filename_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+    ::madvise(address, size, MADV_SEQUENTIAL);
+
+    mapping_ = std::make_shared<const Mapping>(address, size);
+    data_    = static_cast<const uint8_t*>(address);
+    size_    = size;
+
+    std::memcpy(&fileHeader_, data_, sizeof(fileHeader_));
+    if (fileHeader_.fileHeader != Recorder::FileMagicNumber) {
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : invalid file header, is it a .oculus file ?.\n";
+        oss << "    file : '" << filename_ << "'";
+        this->close();
+        throw std::runtime_error(oss.str());
+    }
+    if (fileHeader_.version != 1) {
+        std::cerr << "oculus::FileHeader version is != 1. Reading may fail" << std::endl;
+    }
+    if (fileHeader_.encryption != 0) {
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : file is encrypted. Cannot decode.\n";
+        oss << "    file : '" << filename_ << "'";
+        this->close();
+        throw std::runtime_error(oss.str());
+    }
+    this->rewind();
+}
+
+void MmapFileReader::close()
+{
+    mapping_.reset();  // unmapped when the last view is gone
+    data_ = nullptr;
+    size_ = 0;
+    itemPosition_ = 0;
+    std::memset(&nextItem_, 0, sizeof(nextItem_));
+}
+
+void MmapFileReader::rewind()
+{
+    imageDecoder_.reset();
+    this->read_header_at(sizeof(fileHeader_));
+}
+
+/**
+ * Like FileReader, an incomplete item header at the end of the file is the
+ * end of the file (recording interrupted).
+ */
+void MmapFileReader::read_header_at(std::size_t position)
+{
+    if (!data_ || position + sizeof(nextItem_) > size_) {
+        std::memset(&nextItem_, 0, sizeof(nextItem_));
+        itemPosition_ = 0;
+        return;
+    }
+    std::memcpy(&nextItem_, data_ + position, sizeof(nextItem_));
+    itemPosition_ = position;
+}
+
+std::span<const uint8_t> MmapFileReader::next_item_data() const
+{
+    if (nextItem_.type == 0) {
+        return {};
+    }
+    std::size_t offset = itemPosition_ + sizeof(nextItem_);
+    if (offset + nextItem_.payloadSize > size_) {
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : error reading item data. File might be corrupted.\n";
+        oss << "    file : '" << filename_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+    return {data_ + offset, nextItem_.payloadSize};
+}
+
+std::size_t MmapFileReader::jump_item()
+{
+    if (nextItem_.type == 0) {
+        return 0;
+    }
+    std::size_t currentItemPosition = itemPosition_;
+    this->read_header_at(itemPosition_ + sizeof(nextItem_) + nextItem_.payloadSize);
+    return currentItemPosition;
+}
+
+MessageView MmapFileReader::read_next_message()
+{
+    // Reading file until we find a rt_oculusSonar message or end of file
+    while (nextItem_.type != blueprint::rt_oculusSonar && this->jump_item()) {}
+    if (nextItem_.type == 0) {
+        return MessageView();
+    }
+
+    auto item     = nextItem_;
+    auto position = itemPosition_;
+    auto payload  = this->next_item_data();
+    this->jump_item();
+
+    std::shared_ptr<const void> owner = mapping_;
+    const uint8_t* data = payload.data();
+    std::size_t    size = payload.size();
+    if (item.compression != NoCompression) {
+        auto buffer = std::make_shared<std::vector<uint8_t>>(item.originalSize);
+        try {
+            if (item.compression == SonarImage) {
+                imageDecoder_.decode(payload.data(), payload.size(),
+                                     buffer->data(), buffer->size());
+            }
+            else {
+                decompress(item.compression, payload.data(), payload.size(),
+                           buffer->data(), buffer->size());
+            }
+        }
+        catch (const std::runtime_error& e) {
+            std::ostringstream oss;
+            oss << "oculus::MmapFileReader : could not decompress item at " << position
+                << " : " << e.what() << "\n";
+            oss << "    file : '" << filename_ << "'";
+            throw std::runtime_error(oss.str());
+        }
+        data  = buffer->data();
+        size  = buffer->size();
+        owner = std::move(buffer);
+    }
+    if (size < sizeof(OculusMessageHeader)) {
+        std::ostringstream oss;
+        oss << "oculus::MmapFileReader : truncated message at " << position << ".\n";
+        oss << "    file : '" << filename_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+
+    // Reading TimeStamp from next item if it is there. Falling back to the
+    // LogItem date if it is not there.
+    MessageView::TimePoint stamp;
+    if (nextItem_.type == blueprint::rt_oculusSonarStamp
+        && nextItem_.payloadSize == sizeof(TimeStamp))
+    {
+        TimeStamp fileStamp;
+        std::memcpy(&fileStamp, this->next_item_data().data(), sizeof(fileStamp));
+        this->jump_item();
+        stamp = fileStamp.to_sonar_stamp();
+    }
+    else {
+        uint64_t nanos = 1000000000*item.time;
+        stamp = MessageView::TimePoint{
+            std::chrono::duration_cast<MessageView::TimePoint::duration>(
+                std::chrono::nanoseconds(nanos)
+            )
+        };
+    }
+    return MessageView(std::move(owner), data, size, stamp);
+}
+
+MessageView MmapFileReader::read_next_ping()
+{
+    auto msg = this->read_next_message();
+    while (msg && !msg.is_ping_message()) {
+        msg = this->read_next_message();
+    }
+    return msg;
+}
+
+const FileIndex::ConstPtr& MmapFileReader::index() const
+{
+    if (!index_) {
+        index_ = FileIndex::load_or_build(filename_);
+    }
+    return index_;
+}
+
+/**
+ * Same as FileReader::seek(), the SonarImage items between the keyframe and
+ * the target have their prefix decoded.
+ */
+bool MmapFileReader::seek(std::size_t pingIndex)
+{
+    const auto& index   = *this->index();
+    const auto& entries = index.entries();
+    std::size_t entryIndex = pingIndex < index.ping_count() ? index.ping_entry(pingIndex)
+                                                            : index.message_count();
+
+    imageDecoder_.reset();
+    for (auto i = index.decode_start(entryIndex); i < entryIndex; i++) {
+        if (entries[i].compression != SonarImage)
+            continue;
+        this->read_header_at(entries[i].offset);
+        auto payload = this->next_item_data();
+        try {
+            imageDecoder_.decode_prefix(payload.data(), payload.size());
+        }
+        catch (const std::runtime_error& e) {
+            std::ostringstream oss;
+            oss << "oculus::MmapFileReader : could not decompress item at " << entries[i].offset
+                << " : " << e.what() << "\n";
+            oss << "    file : '" << filename_ << "'";
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    // Moving to the end of the file if there is no such ping.
+    this->read_header_at(entryIndex < entries.size() ? entries[entryIndex].offset : size_);
+    return entryIndex < entries.size();
+}
+
+std::size_t MmapFileReader::seek_time(const Message::TimePoint& stamp)
+{
+    auto pingIndex = this->index()->find_ping(stamp);
+    this->seek(pingIndex);
+    return pingIndex;
+}
+
+}  // namespace oculus
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/ReceiveBuffer.h"
+
+#include <cstring>
+
+namespace oculus {
+
+ReceiveBuffer::ReceiveBuffer(std::size_t capacity) :
+    buffer_(capacity),
+    begin_(0),
+    end_(0)
+{}
+
+/**
+ * Returns the writable area at the end of the buffer. This area is at least
+ * minFreeSize bytes long (the buffer is compacted and/or grown if needed).
+ */
+boost::asio::mutable_buffer ReceiveBuffer::prepare(std::size_t minFreeSize)
+{
+    if (buffer_.size() - end_ < minFreeSize && begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, this->size());
+        end_  -= begin_;
+        begin_ = 0;
+    }
+    if (buffer_.size() - end_ < minFreeSize) {
+        buffer_.resize(end_ + minFreeSize);
+    }
+    return boost::asio::buffer(buffer_.data() + end_, buffer_.size() - end_);
+}
+
+void ReceiveBuffer::commit(std::size_t byteCount)
+{
+    end_ += byteCount;
+    if (end_ > buffer_.size())
+        throw std::runtime_error("ReceiveBuffer : committed more bytes than prepared");
+}
+
+void ReceiveBuffer::consume(std::size_t byteCount)
+{
+    begin_ += byteCount;
+    if (begin_ >= end_) {
+        // Nothing left to read. Restarting from the beginning of the buffer
+        // for free.
+        begin_ = 0;
+        end_   = 0;
+    }
+}
+
+}  // namespace oculus
@@ -1,12 +1,15 @@
 #include "oculus_driver/Recorder.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "oculus_driver/print_utils.h"
 
 namespace oculus {
 
-Recorder::Recorder()
+Recorder::Recorder() :
+    compression_(NoCompression),
+    compressionLevel_(-1)
 {}
 
 Recorder::~Recorder()
@@ -25,7 +28,13 @@ void Recorder::open(const std::string& filename, bool force)
         throw std::runtime_error(oss.str());
     }
 
-    // preparing file header
+    auto header = make_file_header();
+    file_.write((const char*)&header, sizeof(header));
+    imageEncoder_.reset();
+}
+
+blueprint::LogHeader Recorder::make_file_header()
+{
     blueprint::LogHeader header;
     std::memset(&header, 0, sizeof(header));
 
@@ -36,8 +45,30 @@ void Recorder::open(const std::string& filename, bool force)
     header.encryption = 0;
     header.time = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+    return header;
+}
 
-    file_.write((const char*)&header, sizeof(header));
+void Recorder::make_items(const Message& message,
+                          blueprint::LogItem& messageItem,
+                          blueprint::LogItem& stampItem,
+                          TimeStamp& stamp)
+{
+    stamp = TimeStamp::from_sonar_stamp(message.timestamp());
+
+    std::memset(&messageItem, 0, sizeof(messageItem));
+    messageItem.itemHeader   = ItemMagicNumber;
+    messageItem.sizeHeader   = sizeof(messageItem);
+    messageItem.type         = blueprint::rt_oculusSonar;
+    messageItem.version      = 0;
+    messageItem.time         = stamp.to_seconds<double>();
+    messageItem.compression  = 0;
+    messageItem.originalSize = message.data().size();
+    messageItem.payloadSize  = messageItem.originalSize;
+
+    stampItem = messageItem;
+    stampItem.type         = blueprint::rt_oculusSonarStamp;
+    stampItem.originalSize = sizeof(stamp);
+    stampItem.payloadSize  = stampItem.originalSize;
 }
 
 void Recorder::close()
@@ -45,6 +76,18 @@ void Recorder::close()
     file_.close();
 }
 
+void Recorder::set_compression(Compression compression, int level)
+{
+    if (!compression_supported(compression)) {
+        std::ostringstream oss;
+        oss << "oculus::Recorder : compression " << compression
+            << " not supported by this build";
+        throw std::runtime_error(oss.str());
+    }
+    compression_      = compression;
+    compressionLevel_ = level;
+}
+
 std::size_t Recorder::write(const blueprint::LogItem& header,
                             const uint8_t* data) const
 {
@@ -64,25 +107,27 @@ std::size_t Recorder::write(const Message& message) const
     }
     std::size_t writtenSize = 0;
 
-    TimeStamp stamp = TimeStamp::from_sonar_stamp(message.timestamp());
-
-    blueprint::LogItem item;
-    std::memset(&item, 0, sizeof(item));
-
-    item.itemHeader   = ItemMagicNumber;
-    item.sizeHeader   = sizeof(item);
-    item.type         = blueprint::rt_oculusSonar;
-    item.version      = 0;
-    item.time         = stamp.to_seconds<double>();
-    item.compression  = 0;
-    item.originalSize = message.data().size();
-    item.payloadSize  = item.originalSize;
-    writtenSize += this->write(item, message.data().data());
-
-    item.type         = blueprint::rt_oculusSonarStamp;
-    item.originalSize = sizeof(stamp);
-    item.payloadSize  = item.originalSize;
-    writtenSize += this->write(item, (const uint8_t*)&stamp);
+    blueprint::LogItem messageItem, stampItem;
+    TimeStamp stamp;
+    make_items(message, messageItem, stampItem, stamp);
+    if (compression_ == NoCompression) {
+        writtenSize += this->write(messageItem, message.data().data());
+    }
+    else {
+        Compression compression = compression_;
+        const auto& data = message.data();
+        if (compression != SonarImage
+            || !imageEncoder_.encode(data.data(), data.size(), compressed_))
+        {
+            if (compression == SonarImage)
+                compression = QCompress;  // not a ping
+            compress(compression, data.data(), data.size(), compressed_, compressionLevel_);
+        }
+        messageItem.compression = compression;
+        messageItem.payloadSize = compressed_.size();
+        writtenSize += this->write(messageItem, compressed_.data());
+    }
+    writtenSize += this->write(stampItem, (const uint8_t*)&stamp);
 
     return writtenSize;
 }
@@ -140,12 +185,21 @@ void FileReader::open(const std::string& filename)
         throw std::runtime_error(oss.str());
     }
     FileReader::check_file_header(fileHeader_);
+    imageDecoder_.reset();
+    index_.reset();
     this->read_next_header();
 }
 
 void FileReader::rewind()
 {
-    file_.seekg(sizeof(fileHeader_));
+    imageDecoder_.reset();
+    this->seek_item(sizeof(fileHeader_));
+}
+
+void FileReader::seek_item(std::size_t position) const
+{
+    file_.clear();  // the end of the file may have been reached
+    file_.seekg(position);
     this->read_next_header();
 }
 
@@ -185,6 +239,33 @@ std::size_t FileReader::jump_item() const
     return currentItemPosition;
 }
 
+std::size_t FileReader::peek_next_item(uint8_t* dst, std::size_t size) const
+{
+    if (nextItem_.type == 0) {
+        return 0;
+    }
+    auto position = file_.tellg();
+    file_.read(reinterpret_cast<char*>(dst), std::min<std::size_t>(size, nextItem_.payloadSize));
+    std::size_t count = file_.gcount();
+    file_.clear();
+    file_.seekg(position);
+    return count;
+}
+
+std::size_t FileReader::peek_image_prefix(std::vector<uint8_t>& dst) const
+{
+    // The coded prefix is usually much smaller than this.
+    if (dst.size() < 4096)
+        dst.resize(4096);
+    std::size_t count  = this->peek_next_item(dst.data(), dst.size());
+    std::size_t needed = SonarImageDecoder::prefix_coded_size(dst.data(), count);
+    if (needed > count) {
+        dst.resize(needed);
+        count = this->peek_next_item(dst.data(), dst.size());
+    }
+    return count;
+}
+
 std::size_t FileReader::read_next_item(uint8_t* dst) const
 {
     if (nextItem_.type == 0) {
@@ -206,12 +287,48 @@ std::size_t FileReader::read_next_item(uint8_t* dst) const
 
 
 std::size_t FileReader::read_next_item(std::vector<uint8_t>& dst) const
+{
+    return this->read_next_item_into(dst);
+}
+
+std::size_t FileReader::read_next_item(Message::Buffer& dst) const
+{
+    return this->read_next_item_into(dst);
+}
+
+template <class Buffer>
+std::size_t FileReader::read_next_item_into(Buffer& dst) const
 {
     if (nextItem_.type == 0) {
         return 0;
     }
-    dst.resize(nextItem_.payloadSize);
-    return this->read_next_item(dst.data());
+    if (nextItem_.compression == NoCompression) {
+        dst.resize(nextItem_.payloadSize);
+        return this->read_next_item(dst.data());
+    }
+
+    auto item = nextItem_;
+    compressed_.resize(item.payloadSize);
+    std::size_t position = this->read_next_item(compressed_.data());
+    dst.resize(item.originalSize);
+    try {
+        if (item.compression == SonarImage) {
+            imageDecoder_.decode(compressed_.data(), compressed_.size(),
+                                 dst.data(), dst.size());
+        }
+        else {
+            decompress(item.compression, compressed_.data(), compressed_.size(),
+                       dst.data(), dst.size());
+        }
+    }
+    catch (const std::runtime_error& e) {
+        std::ostringstream oss;
+        oss << "oculus::FileReader : could not decompress item at " << position
+            << " : " << e.what() << "\n";
+        oss << "    file : '" << filename_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+    return position;
 }
 
 Message::ConstPtr FileReader::read_next_message() const
@@ -222,13 +339,21 @@ Message::ConstPtr FileReader::read_next_message() const
         return nullptr;
     }
 
+    // The previous message may still be in use, it must not be overwritten
+    // (its buffer is reused otherwise).
+    if (message_.use_count() > 1) {
+        message_ = Message::Create();
+    }
+
     double nextItemDate = nextItem_.time;
     this->read_next_item(message_->data_);
     (*message_).update_from_data();
 
     // Reading TimeStamp from next message if it is there. Falling back to the
     // LogItem date if it is not there.
-    if (nextItem_.type == blueprint::rt_oculusSonarStamp) {
+    if (nextItem_.type == blueprint::rt_oculusSonarStamp
+        && nextItem_.payloadSize == sizeof(TimeStamp))
+    {
         // next message is timestamp associated with the message we just read.
         TimeStamp stamp;
         this->read_next_item(reinterpret_cast<uint8_t*>(&stamp));
@@ -256,4 +381,69 @@ PingMessage::ConstPtr FileReader::read_next_ping() const
     return PingMessage::Create(msg);
 }
 
+const FileIndex::ConstPtr& FileReader::index() const
+{
+    if (!index_) {
+        index_ = FileIndex::load_or_build(filename_);
+    }
+    return index_;
+}
+
+/**
+ * The SonarImage items between the keyframe and the target have their prefix
+ * decoded, the images are skipped.
+ */
+void FileReader::seek_entry(std::size_t entryIndex)
+{
+    const auto& index   = *this->index();
+    const auto& entries = index.entries();
+
+    imageDecoder_.reset();
+    std::vector<uint8_t> coded;
+    for (auto i = index.decode_start(entryIndex); i < entryIndex; i++) {
+        if (entries[i].compression != SonarImage)
+            continue;
+        this->seek_item(entries[i].offset);
+        std::size_t count = this->peek_image_prefix(coded);
+        try {
+            imageDecoder_.decode_prefix(coded.data(), count);
+        }
+        catch (const std::runtime_error& e) {
+            std::ostringstream oss;
+            oss << "oculus::FileReader : could not decompress item at " << entries[i].offset
+                << " : " << e.what() << "\n";
+            oss << "    file : '" << filename_ << "'";
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    if (entryIndex < entries.size()) {
+        this->seek_item(entries[entryIndex].offset);
+    }
+    else {
+        // End of file : same state as after reading the last item.
+        file_.clear();
+        file_.seekg(0, std::ios::end);
+        this->read_next_header();
+    }
+}
+
+bool FileReader::seek(std::size_t pingIndex)
+{
+    const auto& index = *this->index();
+    if (pingIndex >= index.ping_count()) {
+        this->seek_entry(index.message_count());
+        return false;
+    }
+    this->seek_entry(index.ping_entry(pingIndex));
+    return true;
+}
+
+std::size_t FileReader::seek_time(const Message::TimePoint& stamp)
+{
+    auto pingIndex = this->index()->find_ping(stamp);
+    this->seek(pingIndex);
+    return pingIndex;
+}
+
 }  // namespace oculus
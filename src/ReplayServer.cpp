@@ -0,0 +1,173 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/ReplayServer.h"
+
+namespace oculus {
+
+using namespace std::placeholders;
+
+ReplayServer::ReplayServer(const IoServicePtr& service,
+                           const std::shared_ptr<spdlog::logger>& logger,
+                           const std::string& filename,
+                           const Settings& settings,
+                           const Config& config) :
+    SonarServer(service, logger, config),
+    reader_(filename),
+    settings_(settings),
+    timer_(*service),
+    rebase_(true),
+    finished_(false),
+    replayedCount_(0),
+    loopCount_(0),
+    burstDropCount_(0)
+{
+    if (!this->load_next()) {
+        throw std::runtime_error("oculus::ReplayServer : no sonar message in '"
+                                 + filename + "'");
+    }
+    const auto& header = *reinterpret_cast<const OculusMessageHeader*>(next_->data());
+    this->set_device(header.srcDeviceId, header.partNumber);
+}
+
+ReplayServer::~ReplayServer()
+{
+    alive_.kill();  // before the members used by the handlers are destroyed
+}
+
+/**
+ * Reads the next sonar message from the file into next_. Returns false at the
+ * end of the file (after rewinding if looping).
+ */
+bool ReplayServer::load_next()
+{
+    auto message = reader_.read_next_message();
+    if (!message && settings_.loop && replayedCount_ > 0) {
+        reader_.rewind();
+        message = reader_.read_next_message();
+        loopCount_++;
+        rebase_ = true;  // recorded timestamps are starting over
+    }
+    if (!message) {
+        next_ = nullptr;
+        return false;
+    }
+    const auto& data = message->data();
+    next_      = std::make_shared<const Buffer>(data.begin(), data.end());
+    nextStamp_ = message->timestamp();
+    return true;
+}
+
+ReplayServer::Clock::time_point ReplayServer::due_time(const Message::TimePoint& stamp) const
+{
+    return replayStart_ + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(stamp - firstStamp_) / settings_.speed);
+}
+
+/**
+ * In timed mode, messages are dropped when the client does not read fast
+ * enough (full send queue). This is logged once per burst of drops.
+ */
+void ReplayServer::send_next()
+{
+    auto droppedCount = this->dropped_count();
+    this->enqueue(next_);
+    if (this->dropped_count() != droppedCount) {
+        if (burstDropCount_ == 0) {
+            logger->warn("Send queue full, dropping messages (client too slow)");
+        }
+        burstDropCount_++;
+    }
+    else if (burstDropCount_ > 0) {
+        logger->info("Send queue available again, {} messages dropped", burstDropCount_);
+        burstDropCount_ = 0;
+    }
+    replayedCount_++;
+    if (!this->load_next()) {
+        logger->info("End of file reached ({} messages replayed)", replayedCount_);
+        finished_ = true;
+    }
+}
+
+/**
+ * As fast as possible mode : keeps a few messages in the send queue so the
+ * socket never waits for the file.
+ */
+void ReplayServer::fill_queue()
+{
+    while (next_ && this->client_connected() && this->queue_size() < settings_.queueDepth) {
+        this->send_next();
+    }
+}
+
+void ReplayServer::schedule_next()
+{
+    if (!next_ || !this->client_connected()) return;
+
+    if (rebase_) {
+        replayStart_ = Clock::now();
+        firstStamp_  = nextStamp_;
+        rebase_      = false;
+    }
+    timer_.expires_at(this->due_time(nextStamp_));
+    timer_.async_wait(alive_.guard(std::bind(&ReplayServer::timer_callback, this, _1)));
+}
+
+void ReplayServer::timer_callback(const boost::system::error_code& err)
+{
+    if (err) return;
+
+    // Sending everything that is due (several messages may have the same
+    // timestamp, or we may be late).
+    auto now = Clock::now();
+    do {
+        this->send_next();
+    } while (next_ && !rebase_ && this->due_time(nextStamp_) <= now);
+
+    this->schedule_next();
+}
+
+void ReplayServer::on_client_connected()
+{
+    rebase_ = true;
+    if (settings_.speed <= 0.0) {
+        this->fill_queue();
+    }
+    else {
+        this->schedule_next();
+    }
+}
+
+void ReplayServer::on_client_disconnected()
+{
+    timer_.cancel();
+}
+
+void ReplayServer::on_message_sent()
+{
+    if (settings_.speed <= 0.0) {
+        this->fill_queue();
+    }
+}
+
+void ReplayServer::on_message(const OculusMessageHeader& header, const Buffer&)
+{
+    logger->debug("Ignoring message from client (msgId : {})", header.msgId);
+}
+
+}  // namespace oculus
@@ -18,6 +18,8 @@
 
 #include "oculus_driver/SonarClient.h"
 
+#include "oculus_driver/KernelTimestamp.h"
+
 #include <magic_enum_all.hpp>
 
 namespace oculus
@@ -28,20 +30,70 @@ using namespace std::placeholders;
 SonarClient::SonarClient(const IoServicePtr &service,
                          const std::shared_ptr<spdlog::logger> &logger,
                          const Duration &checkerPeriod)
-    : ioService_(service),
-      logger(logger->clone("oculus::SonarClient")),
+    : SonarClient(service, logger, std::make_shared<StatusListener>(service, logger),
+                  0, checkerPeriod)
+{}
+
+SonarClient::SonarClient(const IoServicePtr &service,
+                         const std::shared_ptr<spdlog::logger> &logger,
+                         const std::shared_ptr<StatusListener>& statusListener,
+                         uint16_t deviceId,
+                         const Duration &checkerPeriod)
+    : logger(logger->clone("oculus::SonarClient")),
+      ioService_(service),
+      strand_(boost::asio::make_strand(*service)),
       socket_(nullptr),
       remote_(),
       sonarId_(0),
       connectionState_(Initializing),
       checkerPeriod_(checkerPeriod),
       checkerTimer_(*service, checkerPeriod_),
-      statusListener_(service, logger),
-      message_(Message::Create()) {}
+      statusListener_(statusListener),
+      deviceFilter_(deviceId),
+      headerOffset_(0),
+      messagePool_(MessagePool::Create()),
+      message_(Message::Create()),
+      framingMode_(PerMessage),
+      partialMessage_(false),
+      receiveEngine_(Callbacks),
+      receiveTimeout_(boost::posix_time::seconds(10)),
+      reconnectDelay_(boost::posix_time::seconds(1)),
+      session_(0),
+      coroutineSession_(false),
+      firePending_(false),
+      sendActive_(false),
+      kernelTimestamps_(false),
+      kernelStampsActive_(false),
+      stampPeeked_(false),
+      kernelStampValid_(false),
+      resyncing_(false),
+      resyncByteCount_(0),
+      skippedByteCount_(0)
+{
+    std::memset(&header_, 0, sizeof(header_));
+    std::memset(&lastStatus_, 0, sizeof(lastStatus_));
+    std::memset(&pendingFire_, 0, sizeof(pendingFire_));
+    std::memset(&writingFire_, 0, sizeof(writingFire_));
+    pendingPromises_.reserve(16);
+    writingPromises_.reserve(16);
+    statusHandle_ = statusListener_->callbacks().append(
+        std::bind(&SonarClient::on_status, this, _1));
+}
+
+SonarClient::~SonarClient()
+{
+    this->remove_status_callback();
+}
+
+void SonarClient::remove_status_callback()
+{
+    statusListener_->callbacks().remove(statusHandle_);
+}
 
 bool SonarClient::is_valid(const OculusMessageHeader& header)
 {
-    return header.oculusId == OCULUS_CHECK_ID && header.srcDeviceId == sonarId_;
+    return header.oculusId == OCULUS_CHECK_ID && header.srcDeviceId == sonarId_
+        && header.payloadSize <= MaxPayloadSize;
 }
 
 bool SonarClient::connected() const
@@ -57,6 +109,90 @@ size_t SonarClient::send(const boost::asio::streambuf& buffer) const
     return socket_->send(buffer.data());
 }
 
+std::future<bool> SonarClient::send_fire_message(const OculusSimpleFireMessage2& message)
+{
+    std::promise<bool> promise;
+    auto result = promise.get_future();
+
+    std::unique_lock<std::mutex> lock(sendMutex_);
+    sendStats_.requested++;
+    if (firePending_) {
+        // Replaced before being written : these callers get false.
+        sendStats_.coalesced++;
+        for (auto& superseded : pendingPromises_) {
+            superseded.set_value(false);
+        }
+        pendingPromises_.clear();
+    }
+    pendingFire_ = message;
+    firePending_ = true;
+    pendingPromises_.push_back(std::move(promise));
+    if (!sendActive_) {
+        sendActive_ = true;
+        boost::asio::post(strand_, std::bind(&SonarClient::send_next, this));
+    }
+    return result;
+}
+
+SonarClient::SendStats SonarClient::send_stats() const
+{
+    std::unique_lock<std::mutex> lock(sendMutex_);
+    return sendStats_;
+}
+
+/**
+ * Writes the pending fire message, if any (in the strand). Messages queued
+ * while this write is in progress are sent by the next call, from
+ * send_callback().
+ */
+void SonarClient::send_next()
+{
+    {
+        std::unique_lock<std::mutex> lock(sendMutex_);
+        if (!firePending_) {
+            sendActive_ = false;
+            return;
+        }
+        writingFire_ = pendingFire_;
+        std::swap(writingPromises_, pendingPromises_);
+        firePending_ = false;
+    }
+
+    std::unique_lock<std::mutex> lock(socketMutex_);
+    if (!socket_ || !this->connected()) {
+        lock.unlock();
+        this->send_callback(boost::asio::error::not_connected, 0);
+        return;
+    }
+    boost::asio::async_write(*socket_,
+        boost::asio::buffer(&writingFire_, sizeof(writingFire_)),
+        boost::asio::bind_executor(strand_,
+            std::bind(&SonarClient::send_callback, this, _1, _2)));
+}
+
+void SonarClient::send_callback(const boost::system::error_code& err,
+                                std::size_t byteCount)
+{
+    bool success = !err && byteCount == sizeof(writingFire_);
+    if (!success) {
+        logger->error("Could not send fire message ({}/{} bytes) : {}",
+                      byteCount, sizeof(writingFire_), err.message());
+    }
+    {
+        std::unique_lock<std::mutex> lock(sendMutex_);
+        if (success)
+            sendStats_.sent++;
+        else
+            sendStats_.failed++;
+    }
+    for (auto& promise : writingPromises_) {
+        promise.set_value(success);
+    }
+    writingPromises_.clear();
+
+    this->send_next();
+}
+
 /**
  * Connection Watchdog.
  *
@@ -80,8 +216,8 @@ void SonarClient::checker_callback(const boost::system::error_code& err)
 
     // Programming now the next check
     this->checkerTimer_.expires_from_now(checkerPeriod_);
-    this->checkerTimer_.async_wait(
-        std::bind(&SonarClient::checker_callback, this, std::placeholders::_1));
+    this->checkerTimer_.async_wait(boost::asio::bind_executor(strand_,
+        std::bind(&SonarClient::checker_callback, this, std::placeholders::_1)));
 
     if (connectionState_ == Initializing || connectionState_ == Attempt)
     {
@@ -89,7 +225,7 @@ void SonarClient::checker_callback(const boost::system::error_code& err)
         return;
     }
 
-    auto lastStatusTime = statusListener_.time_since_last_status();
+    auto lastStatusTime = statusClock_.now<float>();
     if (lastStatusTime > 5)
     {
         // The status is retrieved through broadcasted UDP packets. No status
@@ -113,6 +249,21 @@ void SonarClient::checker_callback(const boost::system::error_code& err)
     }
 }
 
+/**
+ * Called when byteCount bytes are dropped from the stream because they are not
+ * part of a valid message. Logs once per loss of synchronization.
+ */
+void SonarClient::resync(std::size_t byteCount)
+{
+    if (!resyncing_) {
+        logger->error("Invalid message header. Resynchronizing stream.");
+        resyncing_ = true;
+        resyncByteCount_ = 0;
+    }
+    resyncByteCount_ += byteCount;
+    skippedByteCount_ += byteCount;
+}
+
 void SonarClient::check_reception(const boost::system::error_code& err)
 {
     // no real handling for now
@@ -130,7 +281,7 @@ void SonarClient::reset_connection()
 
     connectionState_ = Attempt;
 
-    eventpp::counterRemover(statusListener_.callbacks())
+    eventpp::counterRemover(statusCallbacks_)
         .append(std::bind(&SonarClient::on_first_status, this,
                             std::placeholders::_1));
 }
@@ -141,7 +292,20 @@ void SonarClient::close_connection()
     std::unique_lock<std::mutex> lock(socketMutex_);
     this->checkerTimer_.cancel();
     checkerTimer_.expires_at(boost::posix_time::neg_infin);
-    if (socket_)
+    session_++;
+    if (socket_ && coroutineSession_)
+    {
+        // The coroutine may be starting a read on this socket in its strand.
+        // Closing it there, the coroutine then sees the new session number.
+        logger->info("Socket open. Closing now");
+        boost::asio::post(strand_, [socket = std::move(socket_)]() {
+            boost::system::error_code err;
+            socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, err);
+            socket->close(err);
+        });
+        logger->info("Connection closed");
+    }
+    else if (socket_)
     {
         logger->info("Socket open. Closing now");
         try
@@ -164,7 +328,23 @@ void SonarClient::close_connection()
         logger->info("Connection closed");
     }
     connectionState_ = Initializing;
-    status_callbacks()(statusListener_.get_latest());
+    status_callbacks()(lastStatus_);
+}
+
+/**
+ * Called on every status received by the status listener.
+ */
+void SonarClient::on_status(const OculusStatusMsg& msg)
+{
+    if (deviceFilter_ != 0 && msg.head.srcDeviceId != deviceFilter_)
+        return;
+    // The listener may run in another thread (or io_service). Handling the
+    // status in the client strand.
+    boost::asio::post(strand_, [this, msg]() {
+        statusClock_.reset();
+        lastStatus_ = msg;
+        statusCallbacks_(msg);
+    });
 }
 
 void SonarClient::on_first_status(const OculusStatusMsg& msg)
@@ -185,9 +365,16 @@ void SonarClient::on_first_status(const OculusStatusMsg& msg)
             magic_enum::enum_cast<OculusTemperatureStatusType>((msg.status & 0x0000c000) >> 14)
                 .value_or(OculusTemperatureStatusType::TempReserved)));
 
+    coroutineSession_ = receiveEngine_ == Coroutine;
+    if (coroutineSession_) {
+        this->start_coroutine_session();
+        return;
+    }
+
     // attempting connection
-    socket_ = std::make_unique<Socket>(*ioService_);
-    socket_->async_connect(remote_, std::bind(&SonarClient::connect_callback, this, _1));
+    socket_ = std::make_shared<Socket>(*ioService_);
+    socket_->async_connect(remote_, boost::asio::bind_executor(strand_,
+        std::bind(&SonarClient::connect_callback, this, _1)));
 }
 
 void SonarClient::connect_callback(const boost::system::error_code& err)
@@ -203,37 +390,110 @@ void SonarClient::connect_callback(const boost::system::error_code& err)
     logger->info("Connection successful ({})", remote_.address().to_string());
 
     this->checkerTimer_.expires_from_now(checkerPeriod_);
-    this->checkerTimer_.async_wait(
-        std::bind(&SonarClient::checker_callback, this, std::placeholders::_1));
+    this->checkerTimer_.async_wait(boost::asio::bind_executor(strand_,
+        std::bind(&SonarClient::checker_callback, this, std::placeholders::_1)));
 
     clock_.reset();
 
     connectionState_ = Connected;
 
+    this->reset_receive_state();
+
     // this enters the ping data reception loop
-    this->initiate_receive();
+    if (receiveEngine_ == IoUring && this->start_uring_receive()) {
+        // nothing more to do, the io_uring receiver calls parse_batch().
+    }
+    else if (framingMode_ == Batched) {
+        this->initiate_batch_receive();
+    }
+    else {
+        this->initiate_receive();
+    }
     this->on_connect();
     connect_callbacks()();
 }
 
+/**
+ * Resets the reception state for a new connection and enables kernel receive
+ * timestamps on the socket if requested.
+ */
+void SonarClient::reset_receive_state()
+{
+    headerOffset_       = 0;
+    resyncing_          = false;
+    partialMessage_     = false;
+    stampPeeked_        = false;
+    kernelStampValid_   = false;
+    kernelStampsActive_ = false;
+    receiveBuffer_.clear();
+    if (!kernelTimestamps_) return;
+
+    std::unique_lock<std::mutex> lock(socketMutex_);
+    if (socket_) {
+        kernelStampsActive_ = enable_kernel_timestamps(socket_->native_handle());
+    }
+    if (kernelStampsActive_) {
+        logger->info("Using kernel receive timestamps");
+    }
+    else {
+        logger->warn("Could not enable kernel receive timestamps. "
+                     "Falling back to user-space timestamps.");
+    }
+}
+
+/**
+ * Starts the io_uring receive loop on the connected socket. Returns false if
+ * io_uring is not available (the asio receive loop is then used).
+ */
+bool SonarClient::start_uring_receive()
+{
+    if (!IoUringReceiver::is_supported()) {
+        logger->warn("io_uring receive is not available. Using the asio receive loop.");
+        return false;
+    }
+    if (kernelStampsActive_) {
+        logger->warn("Kernel receive timestamps are not used with io_uring.");
+        kernelStampsActive_ = false;
+    }
+    if (!uring_) {
+        uring_ = std::make_unique<IoUringReceiver>(strand_);
+    }
+
+    std::unique_lock<std::mutex> lock(socketMutex_);
+    if (!socket_) return true;
+    uring_->start(socket_->native_handle(), receiveBuffer_,
+        [this]() { this->parse_batch(false); },
+        std::bind(&SonarClient::check_reception, this, _1));
+    return true;
+}
+
 void SonarClient::initiate_receive()
 {
     std::unique_lock<std::mutex> lock(socketMutex_);
     if (!socket_) return;
     // asynchronously scan input until finding a valid header.
-    // /!\ To be checked : This function and its callback handle the data
-    // synchronization with the start of the ping message. It is relying on the
-    // assumption that if the data left in the socket is less than the size of
-    // the header, a short read will happen, so that the next read will be
-    // exactly aligned on the next header.
+    // This function and its callback handle the data synchronization with the
+    // start of the ping message. If an invalid header is received, its bytes
+    // are scanned for the start of the next message and only the missing part
+    // of the header is read (see header_received_callback). headerOffset_ is
+    // the number of header bytes already at the beginning of header_.
     static unsigned int count = 0;
     logger->trace("Initiate receive: {}", count++);
+    if (kernelStampsActive_ && headerOffset_ == 0 && !stampPeeked_)
+    {
+        // Waiting for the first byte of the next message to get its kernel
+        // timestamp before actually reading it.
+        socket_->async_wait(Socket::wait_read,
+            boost::asio::bind_executor(strand_,
+                std::bind(&SonarClient::stamp_received_callback, this, _1, false, 0)));
+        return;
+    }
     boost::asio::async_read(
         *socket_,
-        boost::asio::buffer(
-            reinterpret_cast<uint8_t*>(&message_->header_),
-            sizeof(message_->header_)),
-        std::bind(&SonarClient::header_received_callback, this, _1, _2));
+        boost::asio::buffer(reinterpret_cast<uint8_t*>(&header_) + headerOffset_,
+                            sizeof(header_) - headerOffset_),
+        boost::asio::bind_executor(strand_,
+            std::bind(&SonarClient::header_received_callback, this, _1, _2)));
 }
 
 void SonarClient::header_received_callback(const boost::system::error_code err,
@@ -248,19 +508,50 @@ void SonarClient::header_received_callback(const boost::system::error_code err,
     // TODO : check this last statement. Checked : wrong.
     // Other message types seem to be sent but are not documented by Oculus).
     this->check_reception(err);
-    if (receivedByteCount != sizeof(message_->header_) || !this->is_valid(message_->header_))
+    bool kernelStamped = kernelStampValid_;
+    kernelStampValid_  = false;
+    stampPeeked_       = false;
+    if (receivedByteCount + headerOffset_ != sizeof(header_))
     {
-        // Either we got data in the middle of a ping or did not get enougth
-        // bytes (end of message). Continue listening to get a valid header.
+        // Did not get enough bytes. Restarting from scratch.
         logger->error("Header reception error");
+        headerOffset_ = 0;
         this->initiate_receive();
         return;
     }
+    headerOffset_ = 0;
+
+    if (!this->is_valid(header_))
+    {
+        // We got data in the middle of a message. Looking for the start of
+        // the next message in what we already have, and reading only the
+        // missing bytes.
+        auto bytes = reinterpret_cast<uint8_t*>(&header_);
+        std::size_t skipped = 1 + find_header(bytes + 1, sizeof(header_) - 1, sonarId_);
+        this->resync(skipped);
+        headerOffset_ = sizeof(header_) - skipped;
+        std::memmove(bytes, bytes + skipped, headerOffset_);
+        this->initiate_receive();
+        return;
+    }
+    if (resyncing_) {
+        logger->warn("Stream resynchronized ({} bytes skipped)", resyncByteCount_);
+        resyncing_ = false;
+    }
+
+    headerStamp_ = ReceiveLatency::Clock::now();
+    headerCallbacks_(header_);
 
     // Messsage header is valid. Now getting the remaining part of the message.
     // (The header contains the payload size, we can receive everything and
-    // parse afterwards).
+    // parse afterwards). The previous message_ is left to whoever still holds
+    // a reference to it and a recycled buffer is taken from the pool.
+    message_ = messagePool_->acquire(sizeof(header_) + header_.payloadSize);
+    message_->header_ = header_;
     message_->update_from_header();
+    if (kernelStamped) {
+        message_->timestamp_ = kernelStamp_;
+    }
     {
         std::unique_lock<std::mutex> lock(socketMutex_);
         if (!socket_) return;
@@ -268,7 +559,8 @@ void SonarClient::header_received_callback(const boost::system::error_code err,
             *socket_,
             boost::asio::buffer(message_->payload_handle(),
                                 message_->payload_size()),
-            std::bind(&SonarClient::data_received_callback, this, _1, _2));
+            boost::asio::bind_executor(strand_,
+                std::bind(&SonarClient::data_received_callback, this, _1, _2)));
     }
 }
 
@@ -284,6 +576,9 @@ void SonarClient::data_received_callback(const boost::system::error_code err,
         return;
     }
 
+    payloadStamp_ = ReceiveLatency::Clock::now();
+    latency_.record(ReceiveLatency::HeaderToPayload, headerStamp_, payloadStamp_);
+
     clock_.reset();
     // handle message is to be reimplemented in a subclass
     this->handle_message(message_);
@@ -292,4 +587,134 @@ void SonarClient::data_received_callback(const boost::system::error_code err,
     this->initiate_receive();
 }
 
+void SonarClient::initiate_batch_receive(std::size_t minReadSize)
+{
+    std::unique_lock<std::mutex> lock(socketMutex_);
+    if (!socket_) return;
+    if (kernelStampsActive_ && receiveBuffer_.empty() && !stampPeeked_)
+    {
+        // Next byte is the first byte of a message. Getting its kernel
+        // timestamp first.
+        socket_->async_wait(Socket::wait_read,
+            boost::asio::bind_executor(strand_,
+                std::bind(&SonarClient::stamp_received_callback, this, _1, true, minReadSize)));
+        return;
+    }
+    socket_->async_read_some(
+        receiveBuffer_.prepare(std::max(minReadSize, BatchReadSize)),
+        boost::asio::bind_executor(strand_,
+            std::bind(&SonarClient::batch_received_callback, this, _1, _2)));
+}
+
+/**
+ * Called when data is available on the socket and the next byte is the first
+ * byte of a message. Reads the kernel timestamp of this byte and starts the
+ * actual read.
+ */
+void SonarClient::stamp_received_callback(const boost::system::error_code err,
+                                          bool batched, std::size_t minReadSize)
+{
+    if (err)
+    {
+        this->check_reception(err);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(socketMutex_);
+        if (!socket_) return;
+        kernelStampValid_ = peek_kernel_timestamp(socket_->native_handle(), kernelStamp_);
+    }
+    stampPeeked_ = true;
+
+    if (batched) {
+        this->initiate_batch_receive(minReadSize);
+    }
+    else {
+        this->initiate_receive();
+    }
+}
+
+void SonarClient::batch_received_callback(const boost::system::error_code err,
+                                          std::size_t receivedByteCount)
+{
+    logger->trace("Batch received callback: {} bytes", receivedByteCount);
+    // Only a message starting at the beginning of this read can be stamped by
+    // the kernel (see stamp_received_callback). The other ones are stamped
+    // with the time at which their header was read.
+    bool kernelStamped = kernelStampValid_;
+    kernelStampValid_  = false;
+    stampPeeked_       = false;
+    if (err)
+    {
+        // Stopping the reception loop. If this is not caused by a requested
+        // disconnection, the watchdog will detect it and inform the user.
+        this->check_reception(err);
+        return;
+    }
+    receiveBuffer_.commit(receivedByteCount);
+
+    // Continuing the reception loop.
+    this->initiate_batch_receive(this->parse_batch(kernelStamped));
+}
+
+/**
+ * Handles all the complete messages available in receiveBuffer_. Returns the
+ * number of bytes missing to complete the last message (0 if unknown).
+ */
+std::size_t SonarClient::parse_batch(bool kernelStamped)
+{
+    auto stamp = TimeSource::now();
+    auto receiveStamp = ReceiveLatency::Clock::now();
+    std::size_t missingByteCount = 0;
+    while (receiveBuffer_.size() >= sizeof(OculusMessageHeader))
+    {
+        std::memcpy(&header_, receiveBuffer_.data(), sizeof(header_));
+        if (!this->is_valid(header_))
+        {
+            // Dropping everything up to the next plausible message start.
+            std::size_t skipped = 1 + find_header(receiveBuffer_.data() + 1,
+                                                  receiveBuffer_.size() - 1, sonarId_);
+            this->resync(skipped);
+            kernelStamped = false;
+            receiveBuffer_.consume(skipped);
+            continue;
+        }
+        if (resyncing_) {
+            logger->warn("Stream resynchronized ({} bytes skipped)", resyncByteCount_);
+            resyncing_ = false;
+        }
+
+        // The header of a partially received message was stamped on the
+        // previous read.
+        if (!partialMessage_) {
+            headerStamp_  = receiveStamp;
+            messageStamp_ = kernelStamped ? kernelStamp_ : stamp;
+            headerCallbacks_(header_);
+        }
+        kernelStamped = false;
+
+        std::size_t messageSize = sizeof(header_) + header_.payloadSize;
+        if (receiveBuffer_.size() < messageSize)
+        {
+            // Incomplete message, waiting for more data.
+            missingByteCount = messageSize - receiveBuffer_.size();
+            partialMessage_  = true;
+            break;
+        }
+        partialMessage_ = false;
+        payloadStamp_   = receiveStamp;
+        latency_.record(ReceiveLatency::HeaderToPayload, headerStamp_, payloadStamp_);
+
+        message_ = messagePool_->acquire(messageSize);
+        message_->data_.assign(receiveBuffer_.data(), receiveBuffer_.data() + messageSize);
+        message_->update_from_data();
+        message_->timestamp_ = messageStamp_;
+        receiveBuffer_.consume(messageSize);
+
+        clock_.reset();
+        this->handle_message(message_);
+    }
+    return missingByteCount;
+}
+
 }  // namespace oculus
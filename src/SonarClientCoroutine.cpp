@@ -0,0 +1,291 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/SonarClient.h"
+
+#include "oculus_driver/KernelTimestamp.h"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+namespace oculus {
+
+using boost::asio::awaitable;
+using boost::asio::redirect_error;
+using boost::asio::use_awaitable;
+
+/**
+ * Coroutine receive engine of SonarClient (see SonarClient::Coroutine).
+ *
+ * session() connects, receives and reconnects in a single loop running in the
+ * client strand. Compared to the callback chain, there is no std::bind and no
+ * socket lock per read, and closing the connection only needs to change the
+ * session number. With Boost 1.74, each co_await through the strand still
+ * costs heap allocations : the batched framing (one read for many messages)
+ * is the one to use with this engine (see throughput_benchmark --engine).
+ *
+ * Timeouts are handled by a Watchdog coroutine : the session only moves a
+ * deadline forward before each message, and the watchdog cancels the socket
+ * operations if the deadline is reached.
+ */
+struct SonarClient::CoroutineEngine
+{
+    using Clock     = std::chrono::steady_clock;
+    using ErrorCode = boost::system::error_code;
+    using Timer     = boost::asio::steady_timer;
+
+    struct Watchdog
+    {
+        Timer             timer;
+        Clock::time_point deadline;
+        SocketPtr         socket;
+        bool              expired;
+        bool              stopped;
+
+        Watchdog(IoService& service) :
+            timer(service),
+            deadline(Clock::time_point::max()),
+            expired(false),
+            stopped(false)
+        {}
+
+        void arm(const Clock::duration& timeout) {
+            bool idle = deadline == Clock::time_point::max();
+            deadline = Clock::now() + timeout;
+            if (idle)
+                timer.cancel();  // the watchdog is waiting forever, waking it
+        }
+        void disarm() { deadline = Clock::time_point::max(); }
+    };
+    using WatchdogPtr = std::shared_ptr<Watchdog>;
+
+    static Clock::duration to_duration(const SonarClient::Duration& d) {
+        return std::chrono::microseconds(d.total_microseconds());
+    }
+
+    static awaitable<void>      watch(WatchdogPtr watchdog);
+    static awaitable<void>      session(SonarClient& client, uint64_t session);
+    static awaitable<ErrorCode> receive_messages(SonarClient& client, Socket& socket,
+                                                 Watchdog& watchdog, uint64_t session);
+    static awaitable<ErrorCode> receive_batches(SonarClient& client, Socket& socket,
+                                                Watchdog& watchdog, uint64_t session);
+};
+
+awaitable<void> SonarClient::CoroutineEngine::watch(WatchdogPtr watchdog)
+{
+    while (!watchdog->stopped) {
+        ErrorCode err;
+        watchdog->timer.expires_at(watchdog->deadline);
+        co_await watchdog->timer.async_wait(redirect_error(use_awaitable, err));
+        if (watchdog->stopped)
+            break;
+        // The deadline may have been moved while waiting.
+        if (watchdog->deadline <= Clock::now()) {
+            watchdog->expired = true;
+            watchdog->disarm();
+            if (watchdog->socket)
+                watchdog->socket->cancel(err);
+        }
+    }
+}
+
+awaitable<void> SonarClient::CoroutineEngine::session(SonarClient& client, uint64_t session)
+{
+    // The I/O objects use the io_service executor, the completions are
+    // dispatched to the strand because the coroutine runs in it (an I/O object
+    // bound to the strand would add one more strand dispatch per operation).
+    auto watchdog = std::make_shared<Watchdog>(*client.ioService_);
+    boost::asio::co_spawn(client.strand_, watch(watchdog), boost::asio::detached);
+
+    auto timeout = to_duration(client.receiveTimeout_);
+    while (client.session_ == session) {
+        auto socket = std::make_shared<Socket>(*client.ioService_);
+        {
+            std::unique_lock<std::mutex> lock(client.socketMutex_);
+            if (client.session_ != session)
+                break;
+            client.socket_ = socket;
+        }
+        watchdog->socket  = socket;
+        watchdog->expired = false;
+
+        ErrorCode err;
+        watchdog->arm(timeout);
+        co_await socket->async_connect(client.remote_, redirect_error(use_awaitable, err));
+        if (client.session_ != session)
+            break;
+
+        if (!err) {
+            client.logger->info("Connection successful ({})", client.remote_.address().to_string());
+            client.clock_.reset();
+            client.connectionState_ = Connected;
+            client.reset_receive_state();
+            client.on_connect();
+            client.connect_callbacks()();
+
+            if (client.framingMode_ == Batched)
+                err = co_await receive_batches(client, *socket, *watchdog, session);
+            else
+                err = co_await receive_messages(client, *socket, *watchdog, session);
+            if (client.session_ != session)
+                break;
+            if (watchdog->expired)
+                err = boost::asio::error::timed_out;
+            client.logger->error("Connection lost : {}. Reconnecting.", err.message());
+        }
+        else {
+            if (watchdog->expired)
+                err = boost::asio::error::timed_out;
+            client.logger->error("Connection failure : {}. Remote: {}", err.message(),
+                                 client.remote_.address().to_string());
+        }
+        watchdog->disarm();
+        watchdog->socket.reset();
+
+        client.connectionState_ = Lost;
+        {
+            std::unique_lock<std::mutex> lock(client.socketMutex_);
+            if (client.socket_ == socket)
+                client.socket_.reset();
+        }
+        ErrorCode ignored;
+        socket->close(ignored);
+        client.errorCallbacks(err);
+
+        Timer delay(*client.ioService_, to_duration(client.reconnectDelay_));
+        co_await delay.async_wait(redirect_error(use_awaitable, ignored));
+    }
+
+    watchdog->stopped = true;
+    watchdog->timer.cancel();
+}
+
+/**
+ * PerMessage framing : one read for the header, one read for the payload.
+ */
+awaitable<boost::system::error_code> SonarClient::CoroutineEngine::receive_messages(
+    SonarClient& client, Socket& socket, Watchdog& watchdog, uint64_t session)
+{
+    auto timeout = to_duration(client.receiveTimeout_);
+    auto header  = reinterpret_cast<uint8_t*>(&client.header_);
+    std::size_t headerOffset = 0;
+    ErrorCode err;
+    for (;;) {
+        watchdog.arm(timeout);
+
+        bool kernelStamped = false;
+        if (client.kernelStampsActive_ && headerOffset == 0) {
+            // Waiting for the first byte of the message to get its kernel
+            // timestamp before reading it.
+            co_await socket.async_wait(Socket::wait_read, redirect_error(use_awaitable, err));
+            if (err) co_return err;
+            kernelStamped = peek_kernel_timestamp(socket.native_handle(), client.kernelStamp_);
+        }
+
+        co_await boost::asio::async_read(socket,
+            boost::asio::buffer(header + headerOffset, sizeof(client.header_) - headerOffset),
+            redirect_error(use_awaitable, err));
+        if (err) co_return err;
+
+        headerOffset = 0;
+        if (!client.is_valid(client.header_)) {
+            // Looking for the start of the next message in what we already
+            // have, only the missing bytes are read on the next iteration.
+            std::size_t skipped = 1 + find_header(header + 1, sizeof(client.header_) - 1,
+                                                  client.sonarId_);
+            client.resync(skipped);
+            headerOffset = sizeof(client.header_) - skipped;
+            std::memmove(header, header + skipped, headerOffset);
+            continue;
+        }
+        if (client.resyncing_) {
+            client.logger->warn("Stream resynchronized ({} bytes skipped)",
+                                client.resyncByteCount_);
+            client.resyncing_ = false;
+        }
+        client.headerStamp_ = ReceiveLatency::Clock::now();
+        client.headerCallbacks_(client.header_);
+
+        auto message = client.messagePool_->acquire(sizeof(client.header_)
+                                                    + client.header_.payloadSize);
+        message->header_ = client.header_;
+        message->update_from_header();
+        if (kernelStamped)
+            message->timestamp_ = client.kernelStamp_;
+
+        co_await boost::asio::async_read(socket,
+            boost::asio::buffer(message->payload_handle(), message->payload_size()),
+            redirect_error(use_awaitable, err));
+        if (err) co_return err;
+
+        client.payloadStamp_ = ReceiveLatency::Clock::now();
+        client.latency_.record(ReceiveLatency::HeaderToPayload,
+                               client.headerStamp_, client.payloadStamp_);
+
+        client.message_ = message;
+        client.clock_.reset();
+        client.handle_message(message);
+
+        // The connection may have been closed by a callback.
+        if (client.session_ != session)
+            co_return boost::asio::error::operation_aborted;
+    }
+}
+
+/**
+ * Batched framing : large reads into the receive buffer, parsed with the same
+ * code as the callback engine.
+ */
+awaitable<boost::system::error_code> SonarClient::CoroutineEngine::receive_batches(
+    SonarClient& client, Socket& socket, Watchdog& watchdog, uint64_t session)
+{
+    auto timeout = to_duration(client.receiveTimeout_);
+    std::size_t minReadSize = 0;
+    ErrorCode err;
+    for (;;) {
+        watchdog.arm(timeout);
+
+        bool kernelStamped = false;
+        if (client.kernelStampsActive_ && client.receiveBuffer_.empty()) {
+            co_await socket.async_wait(Socket::wait_read, redirect_error(use_awaitable, err));
+            if (err) co_return err;
+            kernelStamped = peek_kernel_timestamp(socket.native_handle(), client.kernelStamp_);
+        }
+
+        auto count = co_await socket.async_read_some(
+            client.receiveBuffer_.prepare(std::max(minReadSize, BatchReadSize)),
+            redirect_error(use_awaitable, err));
+        if (err) co_return err;
+        client.receiveBuffer_.commit(count);
+
+        minReadSize = client.parse_batch(kernelStamped);
+        if (client.session_ != session)
+            co_return boost::asio::error::operation_aborted;
+    }
+}
+
+void SonarClient::start_coroutine_session()
+{
+    boost::asio::co_spawn(strand_, CoroutineEngine::session(*this, session_),
+                          boost::asio::detached);
+}
+
+}  // namespace oculus
@@ -27,9 +27,82 @@ SonarDriver::SonarDriver(const IoServicePtr &service,
     : SonarClient(service, logger, checkerPeriod),
       logger(logger->clone("oculus::SonarDriver")),
       lastConfig_(default_ping_config()),
-      lastPingRate_(PingRateNormal) {}
+      lastPingRate_(PingRateNormal),
+      networkSpeed_(0xff),
+      configRetryPeriod_(boost::posix_time::seconds(1))
+{
+    this->init();
+}
+
+SonarDriver::SonarDriver(const IoServicePtr &service,
+                         const std::shared_ptr<spdlog::logger> &logger,
+                         const std::shared_ptr<StatusListener>& statusListener,
+                         uint16_t deviceId,
+                         const Duration &checkerPeriod)
+    : SonarClient(service, logger, statusListener, deviceId, checkerPeriod),
+      logger(logger->clone("oculus::SonarDriver")),
+      lastConfig_(default_ping_config()),
+      lastPingRate_(PingRateNormal),
+      networkSpeed_(0xff),
+      configRetryPeriod_(boost::posix_time::seconds(1))
+{
+    this->init();
+}
+
+void SonarDriver::init()
+{
+    configCallbacks_.append([this](const PingConfig&, const PingConfig& newConfig) {
+        configTransactions_.on_feedback(newConfig);
+    });
+    // A pending config transaction will not get its feedback.
+    error_callbacks().append([this](const boost::system::error_code&) {
+        configTransactions_.abort();
+    });
+}
+
+SonarDriver::~SonarDriver()
+{
+    // Cancellation tokens may outlive the driver.
+    alive_.kill();
+}
 
 bool SonarDriver::send_ping_config(PingConfig config)
+{
+    if (!this->connected()) {
+        logger->error("Could not send fire message : not connected");
+        return false;
+    }
+    this->async_send_ping_config(config);
+    return true;
+}
+
+std::future<bool> SonarDriver::async_send_ping_config(PingConfig config)
+{
+    {
+        std::unique_lock<std::mutex> lock(configMutex_);
+        config = this->prepare_fire_message(config);
+        configTransactions_.begin(lastConfig_, config);
+    }
+    return this->send_fire_message(config);
+}
+
+ConfigTransactions::Future SonarDriver::apply_ping_config(PingConfig config)
+{
+    ConfigTransactions::Future transaction;
+    {
+        std::unique_lock<std::mutex> lock(configMutex_);
+        config = this->prepare_fire_message(config);
+        transaction = configTransactions_.begin(lastConfig_, config);
+    }
+    this->send_fire_message(config);
+    return transaction;
+}
+
+/**
+ * Fills the message header and keeps track of the requested ping rate (called
+ * with configMutex_ locked).
+ */
+SonarDriver::PingConfig SonarDriver::prepare_fire_message(PingConfig config)
 {
     config.head.oculusId = OCULUS_CHECK_ID;
     config.head.msgId = MsgSimpleFire;
@@ -38,20 +111,7 @@ bool SonarDriver::send_ping_config(PingConfig config)
     config.head.payloadSize = sizeof(PingConfig) - sizeof(OculusMessageHeader);
     config.head.msgVersion = 2;  // Requesting SimpleFireResponse V2
 
-    // Other non runtime-configurable parameters
-    // TODO: make them launch parameters
-    config.networkSpeed = 0xff;
-
-    boost::asio::streambuf buf;
-    buf.sputn(reinterpret_cast<const char*>(&config), sizeof(config));
-
-    auto bytesSent = this->send(buf);
-    if (bytesSent != sizeof(config))
-    {
-        logger->error("Could not send whole fire message({}/{})",
-            bytesSent, sizeof(config));
-        return false;
-    }
+    config.networkSpeed = networkSpeed_;
 
     // BUG IN THE SONAR FIRMWARE : the sonar never sets the
     // config.pingRate field in the SimplePing message -> there is no
@@ -65,11 +125,12 @@ bool SonarDriver::send_ping_config(PingConfig config)
     if (lastConfig_.pingRate != PingRateStandby) {
       lastPingRate_ = lastConfig_.pingRate;
     }
-    return true;
+    return config;
 }
 
 SonarDriver::PingConfig SonarDriver::last_ping_config() const
 {
+    std::unique_lock<std::mutex> lock(configMutex_);
     return lastConfig_;
 }
 
@@ -81,7 +142,7 @@ SonarDriver::PingConfig SonarDriver::current_ping_config()
         // lastConfig_ is ALWAYS updated before the callbacks are called.
         // We only need to wait for the next message to get the current ping
         // configuration.
-        config = lastConfig_;
+        config = this->last_ping_config();
         config.head = message->header();
     };
 
@@ -92,48 +153,143 @@ SonarDriver::PingConfig SonarDriver::current_ping_config()
     return config;
 }
 
-SonarDriver::PingConfig SonarDriver::request_ping_config(PingConfig request)
+struct SonarDriver::ConfigRequest
+{
+    PingConfig                      request;
+    std::promise<PingConfig>        promise;
+    boost::asio::deadline_timer     deadline;
+    boost::asio::deadline_timer     retryTimer;
+    MessageCallbacksType::Handle    handle;
+    CancellationToken               cancel;
+    CancellationToken::Registration cancelRegistration;
+    bool                            done;
+
+    ConfigRequest(IoService& service, const PingConfig& config,
+                  const CancellationToken& token) :
+        request(config),
+        deadline(service),
+        retryTimer(service),
+        cancel(token),
+        cancelRegistration(0),
+        done(false)
+    {}
+};
+
+std::future<SonarDriver::PingConfig> SonarDriver::async_request_ping_config(
+    PingConfig request, const Duration& timeout, const CancellationToken& cancel)
 {
     request.flags |= 0x4;  // forcing sonar sending gains to true
 
-    // Waiting for a ping or a dummy message to have a feedback on
-    // the config changes.
-    PingConfig feedback;
-    int count = 0;
-    const int maxCount = 100;  // TODO: make a parameter out of this
-    do
-    {
-        if (this->send_ping_config(request))
-        {
-            try
-            {
-                feedback = this->current_ping_config();
-                if (check_config_feedback(request, feedback)) break;
-            }
-            catch(const TimeoutReached& e)
-            {
-                logger->error("Timeout reached while requesting config");
-                continue;
-            }
+    auto state  = std::make_shared<ConfigRequest>(*ioService_, request, cancel);
+    auto result = state->promise.get_future();
+    // Registered before starting, so end_config_request() always removes it.
+    // The token may be cancelled after the driver is destroyed.
+    state->cancelRegistration = cancel.on_cancel(alive_.guard(
+        [this, weakState = std::weak_ptr<ConfigRequest>(state)]() {
+            boost::asio::post(strand_, alive_.guard([this, weakState]() {
+                auto state = weakState.lock();
+                if (state && this->end_config_request(*state)) {
+                    state->promise.set_exception(std::make_exception_ptr(RequestCancelled()));
+                }
+            }));
+        }));
+    boost::asio::post(strand_, [this, state, timeout]() {
+        this->start_config_request(state, timeout);
+    });
+    return result;
+}
+
+/**
+ * Waits for the feedback of the sonar in the message callbacks (in the strand).
+ */
+void SonarDriver::start_config_request(const ConfigRequestPtr& state, const Duration& timeout)
+{
+    if (state->done) return;  // cancelled before starting
+
+    state->handle = messageCallbacks_.append([this, state](const Message::ConstPtr& message) {
+        // lastConfig_ is ALWAYS updated before the callbacks are called.
+        auto feedback = this->last_ping_config();
+        feedback.head = message->header();
+        if (check_config_feedback(state->request, feedback) && this->end_config_request(*state)) {
+            state->promise.set_value(feedback);
         }
-        count++;
-    } while (count < maxCount);
+    });
+
+    state->deadline.expires_from_now(timeout);
+    state->deadline.async_wait(boost::asio::bind_executor(strand_,
+        [this, state](const boost::system::error_code& err) {
+            if (!err && this->end_config_request(*state)) {
+                state->promise.set_exception(std::make_exception_ptr(TimeoutReached()));
+            }
+        }));
+
+    this->send_config_request(state);
+}
+
+void SonarDriver::send_config_request(const ConfigRequestPtr& state)
+{
+    if (state->done) return;
+    if (this->connected()) {
+        this->async_send_ping_config(state->request);
+    }
+    state->retryTimer.expires_from_now(configRetryPeriod_);
+    state->retryTimer.async_wait(boost::asio::bind_executor(strand_,
+        [this, state](const boost::system::error_code& err) {
+            if (!err) this->send_config_request(state);
+        }));
+}
+
+/**
+ * Stops a config request. Returns false if it was already stopped (the
+ * promise must be set only when this returns true).
+ */
+bool SonarDriver::end_config_request(ConfigRequest& state)
+{
+    if (state.done) return false;
+    state.done = true;
+    boost::system::error_code ignored;
+    state.deadline.cancel(ignored);
+    state.retryTimer.cancel(ignored);
+    messageCallbacks_.remove(state.handle);
+    state.cancel.remove(state.cancelRegistration);
+    return true;
+}
 
-    if (count >= maxCount)
+SonarDriver::PingConfig SonarDriver::request_ping_config(PingConfig request,
+                                                         const Duration& timeout)
+{
+    // The request is started in the strand : waiting for it from the strand
+    // would never return.
+    if (strand_.running_in_this_thread()) {
+        throw std::runtime_error(
+            "oculus::SonarDriver : request_ping_config called from a driver callback");
+    }
+    try
+    {
+        return this->async_request_ping_config(request, timeout).get();
+    }
+    catch(const TimeoutReached& e)
     {
         logger->error(
             "Could not get a proper feedback from the sonar. "
             "Assuming the configuration is ok (fix this)");
-        feedback = request;
-        feedback.head.msgId = 0;  // invalid, will be checkable.
     }
-
+    auto feedback = request;
+    feedback.flags |= 0x4;
+    feedback.head.msgId = 0;  // invalid, will be checkable.
     return feedback;
 }
 
+SonarDriver::TimePoint SonarDriver::ping_acquisition_time(const PingMessage& ping) const
+{
+    if (ping.header().msgVersion != 2 || !clockSync_.is_valid())
+        return ping.timestamp();
+    return clockSync_.host_time(ping.ping_start_time());
+}
+
 void SonarDriver::standby()
 {
-    auto request = lastConfig_;
+    auto request = this->last_ping_config();
 
     request.pingRate = PingRateStandby;
 
@@ -142,9 +298,12 @@ void SonarDriver::standby()
 
 void SonarDriver::resume()
 {
-    auto request = lastConfig_;
-
-    request.pingRate = lastPingRate_;
+    PingConfig request;
+    {
+        std::unique_lock<std::mutex> lock(configMutex_);
+        request = lastConfig_;
+        request.pingRate = lastPingRate_;
+    }
 
     this->send_ping_config(request);
 }
@@ -158,7 +317,7 @@ void SonarDriver::on_connect()
 {
     // This makes the oculus fire right away.
     // On first connection lastConfig_ is equal to default_ping_config().
-    status_callbacks()(statusListener_.get_latest());
+    status_callbacks()(lastStatus_);
 }
 
 /**
@@ -166,12 +325,24 @@ void SonarDriver::on_connect()
  */
 void SonarDriver::handle_message(const Message::ConstPtr& message)
 {
+    auto handlerStamp = ReceiveLatency::Clock::now();
+    latency_.record(ReceiveLatency::PayloadToHandler, payloadStamp_, handlerStamp);
+
     const auto& header = message->header();
     const auto& data = message->data();
+    // Fire messages are prepared in the caller threads (pingRate).
+    std::unique_lock<std::mutex> configLock(configMutex_);
+    auto previousConfig = lastConfig_;
     auto newConfig = lastConfig_;
     switch (header.msgId)
     {
     case MsgSimplePingResult:
+        if (header.msgVersion == 2) {
+            auto pingStartTime = reinterpret_cast<const PingResult*>(data.data())->pingStartTime;
+            if (!clockSync_.update(pingStartTime, message->timestamp())) {
+                logger->warn("Sonar clock reset detected (sonar reboot ?)");
+            }
+        }
         newConfig = reinterpret_cast<const PingResult*>(data.data())->fireMessage;
         // feedback is broken on pingRate
         newConfig.pingRate = lastConfig_.pingRate;
@@ -194,18 +365,27 @@ void SonarDriver::handle_message(const Message::ConstPtr& message)
         break;
     };
 
-    if (config_changed(lastConfig_, newConfig)) {
-        configCallbacks_(lastConfig_, newConfig);
-    }
+    // lastConfig_ is updated first : a config callback (a ConfigTransactions
+    // waiter) may send a new config right away, based on last_ping_config().
     lastConfig_ = newConfig;
+    configLock.unlock();
+    if (config_changed(previousConfig, newConfig)) {
+        configCallbacks_(previousConfig, newConfig);
+    }
+    configTransactions_.check_timeout();
 
     // Calling generic message callbacks first (in case we want to do something
     // before calling the specialized callbacks).
     messageCallbacks_(message);
+    auto callbackStamp = ReceiveLatency::Clock::now();
+    latency_.record(ReceiveLatency::MessageCallbacks, handlerStamp, callbackStamp);
+
     switch (header.msgId)
     {
     case MsgSimplePingResult:
         pingCallbacks_(PingMessage::Create(message));
+        latency_.record(ReceiveLatency::PingCallbacks, callbackStamp,
+                        ReceiveLatency::Clock::now());
         break;
     case MsgDummy:
         dummyCallbacks_(header);
@@ -222,6 +402,7 @@ void SonarDriver::handle_message(const Message::ConstPtr& message)
     default:
         break;
     }
+    latency_.record(ReceiveLatency::Total, headerStamp_, ReceiveLatency::Clock::now());
 }
 
 }  // namespace oculus
@@ -0,0 +1,693 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/SonarImageCodec.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "oculus_driver/Oculus.h"
+
+namespace oculus {
+
+namespace {
+
+// Start of an encoded ping, followed by the coded prefix, gains and image,
+// then by the bytes following the image (if any), stored as is.
+struct StreamHeader
+{
+    uint8_t  version;
+    uint8_t  flags;
+    uint8_t  sampleSize;
+    uint8_t  reserved;
+    uint32_t sequence;
+    uint32_t prefixSize;   // bytes before the image in the message
+    uint32_t imageSize;
+    uint16_t rowCount;
+    uint16_t beamCount;
+    uint32_t prefixBytes;  // coded sizes
+    uint32_t gainBytes;
+    uint32_t imageBytes;
+};
+static_assert(sizeof(StreamHeader) == 32);
+
+constexpr uint8_t StreamVersion = 1;
+constexpr uint8_t KeyframeFlag  = 0x1;
+constexpr uint8_t GainsFlag     = 0x2;
+
+struct Layout
+{
+    uint32_t prefixSize;
+    uint32_t imageSize;
+    uint16_t rowCount;
+    uint16_t beamCount;
+    uint8_t  sampleSize;
+    bool     gains;
+
+    uint32_t row_step() const { return (gains ? 4 : 0) + sampleSize*beamCount; }
+};
+
+std::runtime_error corrupted(const char* what)
+{
+    return std::runtime_error(std::string("oculus::SonarImageDecoder : ") + what);
+}
+
+template <typename PingResult>
+void read_layout(const uint8_t* data, Layout& layout, uint32_t& imageOffset, uint8_t& dataSize)
+{
+    PingResult ping;
+    std::memcpy(&ping, data, sizeof(ping));
+    imageOffset      = ping.imageOffset;
+    layout.imageSize = ping.imageSize;
+    layout.rowCount  = ping.nRanges;
+    layout.beamCount = ping.nBeams;
+    dataSize         = ping.dataSize;
+}
+
+bool parse_layout(const uint8_t* data, std::size_t size, Layout& layout)
+{
+    if (size < sizeof(OculusMessageHeader)) return false;
+    OculusMessageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.oculusId != OCULUS_CHECK_ID || header.msgId != MsgSimplePingResult)
+        return false;
+
+    uint32_t imageOffset;
+    uint8_t  dataSize;
+    if (header.msgVersion == 2) {
+        if (size < sizeof(OculusSimplePingResult2)) return false;
+        read_layout<OculusSimplePingResult2>(data, layout, imageOffset, dataSize);
+    }
+    else {
+        if (size < sizeof(OculusSimplePingResult)) return false;
+        read_layout<OculusSimplePingResult>(data, layout, imageOffset, dataSize);
+    }
+
+    if (dataSize == ImageData8Bit)       layout.sampleSize = 1;
+    else if (dataSize == ImageData16Bit) layout.sampleSize = 2;
+    else return false;
+
+    if (layout.rowCount == 0 || layout.beamCount == 0) return false;
+    if (imageOffset < sizeof(OculusMessageHeader)
+        || std::size_t(imageOffset) + layout.imageSize > size)
+        return false;
+    layout.prefixSize = imageOffset;
+
+    if (layout.imageSize % layout.rowCount != 0) return false;
+    uint32_t step = layout.imageSize / layout.rowCount;
+    if (step == layout.sampleSize*layout.beamCount)
+        layout.gains = false;
+    else if (step == layout.sampleSize*layout.beamCount + 4u)
+        layout.gains = true;
+    else
+        return false;
+    return true;
+}
+
+void put_varint(std::vector<uint8_t>& dst, uint32_t value)
+{
+    while (value >= 0x80) {
+        dst.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    dst.push_back(value);
+}
+
+uint32_t get_varint(const uint8_t*& data, const uint8_t* end)
+{
+    uint32_t value = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+        if (data >= end) throw corrupted("truncated data");
+        uint8_t byte = *data++;
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw corrupted("invalid varint");
+}
+
+/**
+ * Bytes before the image, xored with the reference and coded as
+ * (zero run length, literal length, literals) tokens.
+ */
+void put_prefix(const uint8_t* data, std::size_t size, const uint8_t* reference,
+                   std::vector<uint8_t>& dst)
+{
+    auto at = [&](std::size_t i) -> uint8_t {
+        return reference ? data[i] ^ reference[i] : data[i];
+    };
+    std::size_t i = 0;
+    while (i < size) {
+        std::size_t zeros = 0;
+        while (i < size && at(i) == 0) {
+            zeros++;
+            i++;
+        }
+
+        // Literals end on a run of 3 zeros (a token costs at least 2 bytes).
+        std::size_t start = i, end = i, zeroRun = 0;
+        while (i < size) {
+            if (at(i) != 0) {
+                zeroRun = 0;
+                end = i + 1;
+            }
+            else if (++zeroRun == 3) {
+                break;
+            }
+            i++;
+        }
+        i = end;  // following zeros go to the next token
+
+        put_varint(dst, zeros);
+        put_varint(dst, end - start);
+        for (std::size_t j = start; j < end; j++) {
+            dst.push_back(at(j));
+        }
+    }
+}
+
+void get_prefix(const uint8_t* data, const uint8_t* end, const uint8_t* reference,
+                   uint8_t* dst, std::size_t size)
+{
+    std::size_t i = 0;
+    while (i < size) {
+        uint32_t zeros   = get_varint(data, end);
+        uint32_t literal = get_varint(data, end);
+        if (zeros + literal == 0 || i + zeros + literal > size
+            || literal > std::size_t(end - data))
+            throw corrupted("invalid prefix");
+        for (uint32_t j = 0; j < zeros; j++, i++) {
+            dst[i] = reference ? reference[i] : 0;
+        }
+        for (uint32_t j = 0; j < literal; j++, i++) {
+            dst[i] = reference ? (*data++ ^ reference[i]) : *data++;
+        }
+    }
+    if (data != end) throw corrupted("invalid prefix size");
+}
+
+// LSB first bit stream.
+class BitWriter
+{
+    std::vector<uint8_t>& dst_;
+    uint64_t              acc_;
+    unsigned int          count_;
+
+    public:
+
+    BitWriter(std::vector<uint8_t>& dst) : dst_(dst), acc_(0), count_(0) {}
+
+    // n <= 32
+    void put(uint64_t bits, unsigned int n) {
+        acc_   |= bits << count_;
+        count_ += n;
+        if (count_ >= 32) {
+            uint32_t word = acc_;
+            auto offset = dst_.size();
+            dst_.resize(offset + 4);
+            std::memcpy(dst_.data() + offset, &word, 4);
+            acc_   >>= 32;
+            count_ -= 32;
+        }
+    }
+
+    void flush() {
+        while (count_ > 0) {
+            dst_.push_back(acc_ & 0xff);
+            acc_  >>= 8;
+            count_ = count_ > 8 ? count_ - 8 : 0;
+        }
+    }
+};
+
+class BitReader
+{
+    const uint8_t* data_;
+    std::size_t    size_;
+    std::size_t    position_;
+    uint64_t       acc_;
+    unsigned int   count_;
+
+    void refill() {
+        if (position_ + 8 <= size_) {
+            uint64_t word;
+            std::memcpy(&word, data_ + position_, 8);
+            acc_      |= word << count_;
+            position_ += (63 - count_) >> 3;
+            count_    |= 56;
+        }
+        else {
+            while (count_ <= 56) {
+                if (position_ < size_)
+                    acc_ |= uint64_t(data_[position_]) << count_;
+                position_++;
+                count_ += 8;
+            }
+        }
+    }
+
+    public:
+
+    BitReader(const uint8_t* data, std::size_t size) :
+        data_(data), size_(size), position_(0), acc_(0), count_(0)
+    {}
+
+    // Number of zeros before the next one bit (at most limit).
+    unsigned int unary(unsigned int limit) {
+        if (count_ < 41) this->refill();
+        unsigned int q = std::countr_zero(acc_);
+        if (q > limit) throw corrupted("invalid image code");
+        acc_  >>= q + 1;
+        count_ -= q + 1;
+        return q;
+    }
+
+    // n <= 16
+    uint32_t get(unsigned int n) {
+        if (count_ < n) this->refill();
+        uint32_t value = acc_ & ((uint64_t(1) << n) - 1);
+        acc_  >>= n;
+        count_ -= n;
+        return value;
+    }
+
+    bool overrun() const { return 8*position_ - count_ > 8*size_; }
+};
+
+/**
+ * Adaptive Rice code : the parameter k follows a running mean of the
+ * residuals (sum_ is about 16 times the mean). Residuals too large for the
+ * unary part are escaped and stored on the full sample width.
+ */
+class RiceCoder
+{
+    static constexpr unsigned int Limit = 24;
+    static constexpr unsigned int Shift = 4;
+
+    unsigned int bits_;
+    uint32_t     sum_;
+
+    unsigned int k() const {
+        return std::min<unsigned int>(std::bit_width(sum_ >> (Shift + 1)), bits_);
+    }
+    void update(uint32_t value) { sum_ += value - (sum_ >> Shift); }
+
+    public:
+
+    RiceCoder(unsigned int bits) : bits_(bits), sum_((bits == 8 ? 4 : 64) << Shift) {}
+
+    void encode(BitWriter& writer, uint32_t value) {
+        unsigned int k = this->k();
+        uint32_t q = value >> k;
+        if (q < Limit) {
+            writer.put(uint64_t(1) << q, q + 1);
+            writer.put(value & ((uint32_t(1) << k) - 1), k);
+        }
+        else {
+            writer.put(uint64_t(1) << Limit, Limit + 1);
+            writer.put(value, bits_);
+        }
+        this->update(value);
+    }
+
+    uint32_t decode(BitReader& reader) {
+        unsigned int k = this->k();
+        uint32_t q = reader.unary(Limit);
+        uint32_t value = q < Limit ? (q << k) | reader.get(k) : reader.get(bits_);
+        this->update(value);
+        return value;
+    }
+};
+
+// Residuals are coded modulo the sample range, zigzag mapped to unsigned.
+template <typename T>
+inline T zigzag(int residual)
+{
+    using S = std::make_signed_t<T>;
+    S s = S(T(residual));
+    return T((T(s) << 1) ^ T(s >> (8*sizeof(T) - 1)));
+}
+
+template <typename T>
+inline int unzigzag(T value)
+{
+    return (value >> 1) ^ -int(value & 1);
+}
+
+// Chosen for each row (2 bits before the row). The first sample of a row is
+// always predicted from the previous row.
+enum Predictor : uint8_t
+{
+    Median,   // median edge detector of LOCO-I
+    Up,       // previous range
+    Left,     // previous beam
+    Average,  // mean of the previous range and beam (smooths speckle)
+    PredictorCount
+};
+
+template <Predictor P>
+inline int predict(int left, int up, int upLeft)
+{
+    if constexpr (P == Median)
+        return std::clamp(left + up - upLeft, std::min(left, up), std::max(left, up));
+    else if constexpr (P == Up)
+        return up;
+    else if constexpr (P == Left)
+        return left;
+    else
+        return (left + up) >> 1;
+}
+
+// Branch free so that the compiler can vectorise it. Returns the sum of the
+// residuals, which is about what the Rice code of the row costs.
+template <typename T, Predictor P>
+uint32_t compute_residuals(const T* row, const T* previous, T* residuals, unsigned int count)
+{
+    residuals[0] = zigzag<T>(row[0] - previous[0]);
+    uint32_t cost = residuals[0];
+    for (unsigned int b = 1; b < count; b++) {
+        residuals[b] = zigzag<T>(row[b] - predict<P>(row[b - 1], previous[b], previous[b - 1]));
+        cost += residuals[b];
+    }
+    return cost;
+}
+
+template <typename T, Predictor P>
+void decode_row(BitReader& reader, RiceCoder& coder, const T* previous, T* row,
+                unsigned int count)
+{
+    row[0] = T(previous[0] + unzigzag(T(coder.decode(reader))));
+    for (unsigned int b = 1; b < count; b++) {
+        row[b] = T(predict<P>(row[b - 1], previous[b], previous[b - 1])
+                   + unzigzag(T(coder.decode(reader))));
+    }
+}
+
+template <typename T>
+void encode_image(const uint8_t* image, const Layout& layout, BitWriter& writer)
+{
+    unsigned int count  = layout.beamCount;
+    unsigned int step   = layout.row_step();
+    unsigned int offset = layout.gains ? 4 : 0;
+    std::vector<T> previous(count, 0), row(count);
+    std::vector<T> residuals[PredictorCount];
+    for (auto& r : residuals) r.resize(count);
+
+    RiceCoder coder(8*sizeof(T));
+    for (unsigned int r = 0; r < layout.rowCount; r++) {
+        std::memcpy(row.data(), image + r*step + offset, count*sizeof(T));
+        const T* cur  = row.data();
+        const T* prev = previous.data();
+        uint32_t costs[PredictorCount] = {
+            compute_residuals<T, Median> (cur, prev, residuals[Median].data(),  count),
+            compute_residuals<T, Up>     (cur, prev, residuals[Up].data(),      count),
+            compute_residuals<T, Left>   (cur, prev, residuals[Left].data(),    count),
+            compute_residuals<T, Average>(cur, prev, residuals[Average].data(), count),
+        };
+        unsigned int best = std::min_element(costs, costs + PredictorCount) - costs;
+
+        writer.put(best, 2);
+        for (unsigned int b = 0; b < count; b++) {
+            coder.encode(writer, residuals[best][b]);
+        }
+        std::swap(previous, row);
+    }
+}
+
+template <typename T>
+void decode_image(BitReader& reader, const Layout& layout, uint8_t* image)
+{
+    unsigned int count  = layout.beamCount;
+    unsigned int step   = layout.row_step();
+    unsigned int offset = layout.gains ? 4 : 0;
+    std::vector<T> previous(count, 0), row(count);
+    RiceCoder coder(8*sizeof(T));
+    for (unsigned int r = 0; r < layout.rowCount; r++) {
+        switch (reader.get(2)) {
+            case Median:
+                decode_row<T, Median>(reader, coder, previous.data(), row.data(), count);
+                break;
+            case Up:
+                decode_row<T, Up>(reader, coder, previous.data(), row.data(), count);
+                break;
+            case Left:
+                decode_row<T, Left>(reader, coder, previous.data(), row.data(), count);
+                break;
+            default:
+                decode_row<T, Average>(reader, coder, previous.data(), row.data(), count);
+                break;
+        }
+        std::memcpy(image + r*step + offset, row.data(), count*sizeof(T));
+        std::swap(previous, row);
+    }
+}
+
+}  // namespace
+
+SonarImageEncoder::SonarImageEncoder(unsigned int keyframeInterval) :
+    keyframeInterval_(std::max(keyframeInterval, 1u)),
+    sinceKeyframe_(0),
+    sequence_(0)
+{}
+
+bool SonarImageEncoder::is_supported(const uint8_t* data, std::size_t size)
+{
+    Layout layout;
+    return parse_layout(data, size, layout);
+}
+
+void SonarImageEncoder::reset()
+{
+    reference_.clear();
+    sinceKeyframe_ = 0;
+}
+
+bool SonarImageEncoder::next_frame(const uint8_t* data, std::size_t size, Frame& frame)
+{
+    Layout layout;
+    if (!parse_layout(data, size, layout))
+        return false;
+
+    frame.sequence = sequence_++;
+    frame.keyframe = reference_.size() != layout.prefixSize
+                  || sinceKeyframe_ >= keyframeInterval_;
+    if (frame.keyframe) {
+        frame.reference.clear();
+        sinceKeyframe_ = 1;
+    }
+    else {
+        frame.reference = reference_;
+        sinceKeyframe_++;
+    }
+    reference_.assign(data, data + layout.prefixSize);
+    return true;
+}
+
+bool SonarImageEncoder::encode(const uint8_t* data, std::size_t size, std::vector<uint8_t>& dst)
+{
+    Frame frame;
+    if (!this->next_frame(data, size, frame))
+        return false;
+    encode(data, size, frame, dst);
+    return true;
+}
+
+void SonarImageEncoder::encode(const uint8_t* data, std::size_t size, const Frame& frame,
+                               std::vector<uint8_t>& dst)
+{
+    Layout layout;
+    if (!parse_layout(data, size, layout))
+        throw std::runtime_error("oculus::SonarImageEncoder : unsupported message");
+    if (!frame.keyframe && frame.reference.size() != layout.prefixSize)
+        throw std::runtime_error("oculus::SonarImageEncoder : invalid reference");
+
+    StreamHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.version    = StreamVersion;
+    header.flags      = (frame.keyframe ? KeyframeFlag : 0) | (layout.gains ? GainsFlag : 0);
+    header.sampleSize = layout.sampleSize;
+    header.sequence   = frame.sequence;
+    header.prefixSize = layout.prefixSize;
+    header.imageSize  = layout.imageSize;
+    header.rowCount   = layout.rowCount;
+    header.beamCount  = layout.beamCount;
+
+    dst.clear();
+    dst.reserve(size + size / 16 + 64);
+    dst.resize(sizeof(header));
+
+    put_prefix(data, layout.prefixSize,
+               frame.keyframe ? nullptr : frame.reference.data(), dst);
+    header.prefixBytes = dst.size() - sizeof(header);
+
+    const uint8_t* image = data + layout.prefixSize;
+    if (layout.gains) {
+        uint32_t previous = 0;
+        for (unsigned int r = 0; r < layout.rowCount; r++) {
+            uint32_t gain;
+            std::memcpy(&gain, image + r*layout.row_step(), sizeof(gain));
+            int32_t delta = gain - previous;
+            put_varint(dst, (uint32_t(delta) << 1) ^ uint32_t(delta >> 31));
+            previous = gain;
+        }
+    }
+    header.gainBytes = dst.size() - sizeof(header) - header.prefixBytes;
+
+    BitWriter writer(dst);
+    if (layout.sampleSize == 1)
+        encode_image<uint8_t>(image, layout, writer);
+    else
+        encode_image<uint16_t>(image, layout, writer);
+    writer.flush();
+    header.imageBytes = dst.size() - sizeof(header) - header.prefixBytes - header.gainBytes;
+
+    std::size_t end = layout.prefixSize + layout.imageSize;
+    dst.insert(dst.end(), data + end, data + size);
+    std::memcpy(dst.data(), &header, sizeof(header));
+}
+
+SonarImageDecoder::SonarImageDecoder() :
+    hasReference_(false),
+    sequence_(0)
+{}
+
+void SonarImageDecoder::reset()
+{
+    hasReference_ = false;
+    reference_.clear();
+}
+
+bool SonarImageDecoder::is_keyframe(const uint8_t* data, std::size_t size)
+{
+    StreamHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    return header.flags & KeyframeFlag;
+}
+
+std::size_t SonarImageDecoder::prefix_coded_size(const uint8_t* data, std::size_t size)
+{
+    StreamHeader header;
+    if (size < sizeof(header)) return 0;
+    std::memcpy(&header, data, sizeof(header));
+    return sizeof(header) + std::size_t(header.prefixBytes);
+}
+
+void SonarImageDecoder::check_reference(bool keyframe, uint32_t sequence,
+                                        std::size_t prefixSize) const
+{
+    if (!keyframe && (!hasReference_ || reference_.size() != prefixSize
+                      || sequence != sequence_ + 1))
+    {
+        throw std::runtime_error("oculus::SonarImageDecoder : the previous ping is needed "
+                                 "to decode this one (decoding must start on a keyframe)");
+    }
+}
+
+const std::vector<uint8_t>& SonarImageDecoder::decode_prefix(const uint8_t* data,
+                                                             std::size_t size)
+{
+    StreamHeader header;
+    if (size < sizeof(header)) throw corrupted("truncated data");
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != StreamVersion)
+        throw corrupted("unknown version");
+    if (sizeof(header) + std::size_t(header.prefixBytes) > size)
+        throw corrupted("truncated prefix");
+
+    bool keyframe = header.flags & KeyframeFlag;
+    this->check_reference(keyframe, header.sequence, header.prefixSize);
+
+    // Decoding in place is fine, each byte only depends on the reference
+    // byte at the same position.
+    const uint8_t* prefix = data + sizeof(header);
+    hasReference_ = false;  // until decoded
+    reference_.resize(header.prefixSize);
+    get_prefix(prefix, prefix + header.prefixBytes,
+               keyframe ? nullptr : reference_.data(), reference_.data(), header.prefixSize);
+
+    sequence_     = header.sequence;
+    hasReference_ = true;
+    return reference_;
+}
+
+void SonarImageDecoder::decode(const uint8_t* data, std::size_t size,
+                               uint8_t* dst, std::size_t originalSize)
+{
+    StreamHeader header;
+    if (size < sizeof(header)) throw corrupted("truncated data");
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != StreamVersion)
+        throw corrupted("unknown version");
+
+    Layout layout;
+    layout.prefixSize = header.prefixSize;
+    layout.imageSize  = header.imageSize;
+    layout.rowCount   = header.rowCount;
+    layout.beamCount  = header.beamCount;
+    layout.sampleSize = header.sampleSize;
+    layout.gains      = header.flags & GainsFlag;
+    if ((layout.sampleSize != 1 && layout.sampleSize != 2)
+        || std::size_t(layout.rowCount) * layout.row_step() != layout.imageSize)
+        throw corrupted("invalid image layout");
+
+    std::size_t coded = sizeof(header) + std::size_t(header.prefixBytes)
+                      + header.gainBytes + header.imageBytes;
+    if (coded > size || std::size_t(layout.prefixSize) + layout.imageSize + (size - coded)
+                        != originalSize)
+        throw corrupted("size mismatch");
+
+    bool keyframe = header.flags & KeyframeFlag;
+    this->check_reference(keyframe, header.sequence, layout.prefixSize);
+
+    const uint8_t* prefix = data + sizeof(header);
+    get_prefix(prefix, prefix + header.prefixBytes,
+               keyframe ? nullptr : reference_.data(), dst, layout.prefixSize);
+
+    uint8_t* image = dst + layout.prefixSize;
+    if (layout.gains) {
+        const uint8_t* gains = prefix + header.prefixBytes;
+        const uint8_t* end   = gains + header.gainBytes;
+        uint32_t previous = 0;
+        for (unsigned int r = 0; r < layout.rowCount; r++) {
+            uint32_t value = get_varint(gains, end);
+            uint32_t gain  = previous + ((value >> 1) ^ -(value & 1));
+            std::memcpy(image + r*layout.row_step(), &gain, sizeof(gain));
+            previous = gain;
+        }
+        if (gains != end) throw corrupted("invalid gains size");
+    }
+
+    BitReader reader(prefix + header.prefixBytes + header.gainBytes, header.imageBytes);
+    if (layout.sampleSize == 1)
+        decode_image<uint8_t>(reader, layout, image);
+    else
+        decode_image<uint16_t>(reader, layout, image);
+    if (reader.overrun()) throw corrupted("truncated image");
+
+    std::memcpy(image + layout.imageSize, data + coded, size - coded);
+
+    reference_.assign(dst, dst + layout.prefixSize);
+    sequence_     = header.sequence;
+    hasReference_ = true;
+}
+
+}  // namespace oculus
@@ -0,0 +1,218 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/SonarManager.h"
+
+#include "oculus_driver/print_utils.h"
+
+namespace oculus {
+
+using namespace std::placeholders;
+
+SonarManager::SonarManager(const std::shared_ptr<spdlog::logger>& logger,
+                           ThreadingMode mode,
+                           unsigned int poolSize,
+                           uint16_t statusPort) :
+    logger(logger->clone("oculus::SonarManager")),
+    mode_(mode),
+    poolSize_(std::max(poolSize, 1u)),
+    shared_(mode == SharedPool ? poolSize_ : 1, "oculus_manager"),
+    running_(false),
+    autoAttach_(false),
+    statusListener_(std::make_shared<StatusListener>(shared_.io_service(), logger, statusPort))
+{
+    statusListener_->callbacks().append(std::bind(&SonarManager::on_status, this, _1));
+}
+
+SonarManager::~SonarManager()
+{
+    this->stop();
+}
+
+void SonarManager::start()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (running_) return;
+    // In ThreadPerSonar mode, the shared service only runs the status listener.
+    shared_.start();
+    for (auto& item : drivers_) {
+        if (item.second.own)
+            item.second.own->start();
+    }
+    running_ = true;
+}
+
+void SonarManager::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    // Not locked : the status listener thread may be waiting for the mutex in
+    // on_status().
+    shared_.stop();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto& item : drivers_) {
+        if (item.second.own)
+            item.second.own->stop();
+    }
+    detached_.clear();
+}
+
+void SonarManager::on_status(const OculusStatusMsg& msg)
+{
+    bool discovered = false;
+    SonarDevice device;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = devices_.find(msg.head.srcDeviceId);
+        if (it == devices_.end()) {
+            discovered = true;
+            it = devices_.emplace(msg.head.srcDeviceId, SonarDevice()).first;
+            it->second.deviceId    = msg.head.srcDeviceId;
+            it->second.statusCount = 0;
+        }
+        it->second.partNumber = msg.partNumber;
+        it->second.address    = ip_to_string(msg.ipAddr);
+        it->second.lastStatus = msg;
+        it->second.lastSeen   = Message::TimeSource::now();
+        it->second.statusCount++;
+        device = it->second;
+    }
+
+    if (!discovered) return;
+
+    logger->info("Found sonar {} at {} (part number {})",
+                 device.deviceId, device.address, device.partNumber);
+    discoveryCallbacks_(device);
+    if (autoAttach_) {
+        this->attach(device.deviceId);
+    }
+}
+
+void SonarManager::set_thread_init(const AsyncService::ThreadInit& init)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    threadInit_ = init;
+    shared_.set_thread_init(init);
+    for (auto& item : drivers_) {
+        if (item.second.own)
+            item.second.own->set_thread_init(init);
+    }
+}
+
+std::vector<SonarDevice> SonarManager::devices() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<SonarDevice> res;
+    for (const auto& item : devices_) {
+        res.push_back(item.second);
+    }
+    return res;
+}
+
+bool SonarManager::has_device(uint16_t deviceId) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return devices_.find(deviceId) != devices_.end();
+}
+
+SonarManager::DriverPtr SonarManager::attach(uint16_t deviceId)
+{
+    if (deviceId == 0) {
+        throw std::runtime_error("oculus::SonarManager : cannot attach to device id 0");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = drivers_.find(deviceId);
+    if (it != drivers_.end()) {
+        return it->second.driver;
+    }
+
+    Attached attached;
+    IoServicePtr service = shared_.io_service();
+    if (mode_ == ThreadPerSonar) {
+        attached.own = std::make_unique<AsyncService>(1, "oculus_" + std::to_string(deviceId));
+        attached.own->set_thread_init(threadInit_);
+        service = attached.own->io_service();
+    }
+    attached.driver = std::make_shared<SonarDriver>(service, logger, statusListener_, deviceId);
+    if (running_ && attached.own) {
+        attached.own->start();
+    }
+    attached.driver->reset_connection();
+
+    auto driver = attached.driver;
+    drivers_.emplace(deviceId, std::move(attached));
+    logger->info("Attached driver to sonar {}", deviceId);
+    return driver;
+}
+
+SonarManager::DriverPtr SonarManager::driver(uint16_t deviceId) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = drivers_.find(deviceId);
+    if (it == drivers_.end())
+        return nullptr;
+    return it->second.driver;
+}
+
+std::vector<uint16_t> SonarManager::attached_devices() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<uint16_t> res;
+    for (const auto& item : drivers_) {
+        res.push_back(item.first);
+    }
+    return res;
+}
+
+void SonarManager::detach(uint16_t deviceId)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = drivers_.find(deviceId);
+    if (it == drivers_.end()) return;
+
+    Attached attached = std::move(it->second);
+    drivers_.erase(it);
+    attached.driver->close_connection();
+    if (!attached.own) {
+        detached_.push_back(std::move(attached));
+        logger->info("Detached driver from sonar {}", deviceId);
+        return;
+    }
+    bool running = running_;
+    lock.unlock();
+
+    // The shared status listener posts to the driver strand : no status must
+    // be on its way when the driver service is destroyed. Not locked, the
+    // listener may be waiting for the mutex in on_status().
+    attached.driver->remove_status_callback();
+    if (running) {
+        auto flushed = statusListener_->flush();
+        if (flushed.wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
+            logger->warn("Status listener not flushed when detaching sonar {}", deviceId);
+        }
+    }
+    attached.own->stop();
+    logger->info("Detached driver from sonar {}", deviceId);
+}
+
+}  // namespace oculus
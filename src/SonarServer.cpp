@@ -0,0 +1,288 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/SonarServer.h"
+
+#include <cstring>
+
+#include "oculus_driver/utils.h"
+
+namespace oculus {
+
+using namespace std::placeholders;
+
+// Inverse of ip_to_string (first byte of the address in the lowest byte).
+static uint32_t ip_from_string(const std::string& address)
+{
+    auto bytes = boost::asio::ip::address_v4::from_string(address).to_bytes();
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+}
+
+SonarServer::SonarServer(const IoServicePtr& service,
+                         const std::shared_ptr<spdlog::logger>& logger,
+                         const Config& config) :
+    logger(logger->clone("oculus::SonarServer")),
+    ioService_(service),
+    config_(config),
+    acceptor_(*service),
+    clientGeneration_(0),
+    statusSocket_(*service),
+    statusTimer_(*service),
+    sending_(false),
+    sentCount_(0),
+    droppedCount_(0)
+{
+    std::memset(&status_, 0, sizeof(status_));
+    status_.head.oculusId    = OCULUS_CHECK_ID;
+    status_.head.srcDeviceId = config_.deviceId;
+    status_.head.msgId       = MsgStatus;
+    status_.head.payloadSize = sizeof(status_) - sizeof(status_.head);
+    status_.head.partNumber  = config_.partNumber;
+    status_.deviceId         = config_.deviceId;
+    status_.deviceType       = DeviceTypeImagingSonar;
+    status_.partNumber       = config_.partNumber;
+    status_.ipAddr           = ip_from_string(config_.address);
+    status_.ipMask           = ip_from_string("255.255.255.0");
+    status_.temperature0     = 20.0;
+    status_.pressure         = 1.0;
+}
+
+SonarServer::~SonarServer()
+{
+    alive_.kill();
+    this->stop();
+}
+
+void SonarServer::start()
+{
+    boost::asio::ip::tcp::endpoint endpoint(
+        boost::asio::ip::address::from_string(config_.address), config_.tcpPort);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(Acceptor::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    logger->info("Listening on {}:{}", config_.address, config_.tcpPort);
+
+    statusSocket_.open(boost::asio::ip::udp::v4());
+    statusSocket_.set_option(boost::asio::socket_base::broadcast(true));
+
+    this->accept_next();
+    this->status_callback(boost::system::error_code());
+}
+
+void SonarServer::stop()
+{
+    boost::system::error_code err;
+    statusTimer_.cancel();
+    acceptor_.close(err);
+    statusSocket_.close(err);
+    if (client_) {
+        client_->close(err);
+        client_.reset();
+        clientGeneration_++;
+    }
+    txQueue_.clear();
+    sending_ = false;
+}
+
+void SonarServer::accept_next()
+{
+    pendingClient_ = std::make_unique<TcpSocket>(*ioService_);
+    acceptor_.async_accept(*pendingClient_,
+                           alive_.guard(std::bind(&SonarServer::accept_callback, this, _1)));
+}
+
+void SonarServer::accept_callback(const boost::system::error_code& err)
+{
+    if (err) {
+        if (err != boost::asio::error::operation_aborted) {
+            logger->error("Accept error : {}", err.message());
+        }
+        return;
+    }
+
+    if (client_) {
+        logger->warn("New client connection, dropping the previous one");
+        this->disconnect_client();
+    }
+    client_ = std::move(pendingClient_);
+    clientGeneration_++;
+    client_->set_option(boost::asio::ip::tcp::no_delay(true));
+    logger->info("Client connected ({})", client_->remote_endpoint().address().to_string());
+
+    this->receive_header();
+    this->on_client_connected();
+    this->accept_next();
+}
+
+void SonarServer::disconnect_client()
+{
+    if (!client_) return;
+    boost::system::error_code err;
+    client_->shutdown(TcpSocket::shutdown_both, err);
+    client_->close(err);
+    client_.reset();
+    clientGeneration_++;  // pending completions are now stale
+    txQueue_.clear();
+    sending_ = false;
+    this->on_client_disconnected();
+}
+
+/**
+ * Changes the device advertised in the status messages (to be called before
+ * start()).
+ */
+void SonarServer::set_device(uint16_t deviceId, uint16_t partNumber)
+{
+    config_.deviceId         = deviceId;
+    config_.partNumber       = partNumber;
+    status_.head.srcDeviceId = deviceId;
+    status_.head.partNumber  = partNumber;
+    status_.deviceId         = deviceId;
+    status_.partNumber       = partNumber;
+}
+
+void SonarServer::status_callback(const boost::system::error_code& err)
+{
+    if (err) return;
+
+    boost::system::error_code sendErr;
+    statusSocket_.send_to(boost::asio::buffer(&status_, sizeof(status_)),
+        boost::asio::ip::udp::endpoint(
+            boost::asio::ip::address::from_string(config_.statusAddress), config_.statusPort),
+        0, sendErr);
+    if (sendErr) {
+        logger->error("Could not send status : {}", sendErr.message());
+    }
+
+    statusTimer_.expires_after(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(config_.statusPeriod)));
+    statusTimer_.async_wait(
+        alive_.guard(std::bind(&SonarServer::status_callback, this, _1)));
+}
+
+void SonarServer::receive_header()
+{
+    if (!client_) return;
+    boost::asio::async_read(*client_,
+        boost::asio::buffer(&rxHeader_, sizeof(rxHeader_)),
+        alive_.guard(std::bind(&SonarServer::header_callback, this, _1, clientGeneration_)));
+}
+
+/**
+ * The client handlers are bound to the generation of the client they were
+ * started for : completions arriving after a disconnection or a new
+ * connection are ignored.
+ */
+void SonarServer::header_callback(const boost::system::error_code& err, uint64_t generation)
+{
+    if (generation != clientGeneration_) return;
+    if (err) {
+        if (err != boost::asio::error::operation_aborted) {
+            logger->info("Client disconnected ({})", err.message());
+            this->disconnect_client();
+        }
+        return;
+    }
+    if (!header_plausible(rxHeader_)) {
+        logger->error("Invalid message header from client");
+        this->receive_header();
+        return;
+    }
+
+    rxPayload_.resize(rxHeader_.payloadSize);
+    boost::asio::async_read(*client_,
+        boost::asio::buffer(rxPayload_),
+        alive_.guard(std::bind(&SonarServer::payload_callback, this, _1, clientGeneration_)));
+}
+
+void SonarServer::payload_callback(const boost::system::error_code& err, uint64_t generation)
+{
+    if (generation != clientGeneration_) return;
+    if (err) {
+        if (err != boost::asio::error::operation_aborted) {
+            logger->info("Client disconnected ({})", err.message());
+            this->disconnect_client();
+        }
+        return;
+    }
+    this->on_message(rxHeader_, rxPayload_);
+    this->receive_header();
+}
+
+void SonarServer::send(const BufferPtr& message)
+{
+    boost::asio::post(*ioService_,
+        alive_.guard(std::bind(&SonarServer::enqueue, this, message)));
+}
+
+void SonarServer::send(const void* data, std::size_t size)
+{
+    auto ptr = static_cast<const uint8_t*>(data);
+    this->send(std::make_shared<const Buffer>(ptr, ptr + size));
+}
+
+void SonarServer::enqueue(const BufferPtr& message)
+{
+    if (!client_) return;
+    if (txQueue_.size() >= config_.maxQueueSize) {
+        droppedCount_++;
+        return;
+    }
+    txQueue_.push_back(message);
+    if (!sending_) {
+        this->write_next();
+    }
+}
+
+void SonarServer::write_next()
+{
+    if (!client_ || txQueue_.empty()) {
+        sending_ = false;
+        return;
+    }
+    sending_ = true;
+    // The message is bound to the handler to keep it alive until the write
+    // completes, even if the queue is cleared in the meantime.
+    auto message = txQueue_.front();
+    boost::asio::async_write(*client_,
+        boost::asio::buffer(*message),
+        alive_.guard(std::bind(&SonarServer::write_callback, this, _1,
+                                clientGeneration_, message)));
+}
+
+void SonarServer::write_callback(const boost::system::error_code& err, uint64_t generation,
+                                 const BufferPtr&)
+{
+    // Stale completion : the queue was cleared, it may even hold the messages
+    // of a new client (with their own write in progress).
+    if (generation != clientGeneration_) return;
+    if (err) {
+        if (err != boost::asio::error::operation_aborted) {
+            logger->info("Client disconnected ({})", err.message());
+            this->disconnect_client();
+        }
+        return;
+    }
+    sentCount_++;
+    txQueue_.pop_front();
+    this->write_next();
+    this->on_message_sent();
+}
+
+}  // namespace oculus
@@ -0,0 +1,273 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/SonarSimulator.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "oculus_driver/utils.h"
+
+namespace oculus {
+
+using namespace std::placeholders;
+
+SonarSimulator::SonarSimulator(const IoServicePtr& service,
+                               const std::shared_ptr<spdlog::logger>& logger,
+                               const Settings& settings,
+                               const Config& config) :
+    SonarServer(service, logger, config),
+    settings_(settings),
+    pingConfig_(default_ping_config()),
+    pingTimer_(*service),
+    bootTime_(Clock::now()),
+    pingId_(0),
+    pingCount_(0)
+{
+    this->build_ping_template();
+}
+
+SonarSimulator::~SonarSimulator()
+{
+    alive_.kill();  // before the members used by the handlers are destroyed
+}
+
+/**
+ * Period of the automatic pings. Returns 0 when the sonar is in standby or in
+ * network trigger mode.
+ */
+double SonarSimulator::ping_period() const
+{
+    if (pingConfig_.flags & 0x80) return 0.0;  // NetworkTrigger
+    if (pingConfig_.pingRate == PingRateStandby) return 0.0;
+    if (settings_.pingRate < 0.0) return 0.0;
+    if (settings_.pingRate > 0.0) return 1.0 / settings_.pingRate;
+    return 1.0 / ping_rate_frequency(pingConfig_.pingRate);
+}
+
+/**
+ * True if pings are sent as fast as the client reads them.
+ */
+bool SonarSimulator::free_running() const
+{
+    return settings_.pingRate < 0.0
+        && !(pingConfig_.flags & 0x80)
+        && pingConfig_.pingRate != PingRateStandby;
+}
+
+void SonarSimulator::build_ping_template()
+{
+    const PingConfig& config = pingConfig_;
+
+    uint16_t beamCount = settings_.beamCount;
+    if (beamCount == 0) {
+        beamCount = (config.flags & 0x40) ? 512 : 256;
+    }
+    uint16_t rangeCount = settings_.rangeCount;
+    uint8_t sampleSize = settings_.sampleSize;
+    if (sampleSize == 0) {
+        sampleSize = (config.flags & 0x02) ? 2 : 1;
+    }
+    bool gains = settings_.sendGains < 0 ? (config.flags & 0x04) != 0 : settings_.sendGains > 0;
+
+    uint32_t imageOffset = sizeof(PingResult) + sizeof(int16_t) * beamCount;
+    uint32_t lineSize    = (gains ? 4 : 0) + sampleSize * beamCount;
+    uint32_t imageSize   = lineSize * rangeCount;
+
+    pingTemplate_.assign(imageOffset + imageSize, 0);
+    auto& ping = *reinterpret_cast<PingResult*>(pingTemplate_.data());
+
+    ping.fireMessage                  = config;
+    ping.fireMessage.head.oculusId    = OCULUS_CHECK_ID;
+    ping.fireMessage.head.srcDeviceId = config_.deviceId;
+    ping.fireMessage.head.dstDeviceId = 0;
+    ping.fireMessage.head.msgId       = MsgSimplePingResult;
+    ping.fireMessage.head.msgVersion  = 2;
+    ping.fireMessage.head.payloadSize = pingTemplate_.size() - sizeof(OculusMessageHeader);
+    ping.fireMessage.head.partNumber  = config_.partNumber;
+
+    ping.frequency         = config.masterMode == 1 ? 720.0e3 : 1.2e6;
+    ping.temperature       = 15.0;
+    ping.pressure          = 1.0;
+    ping.speeedOfSoundUsed = config.speedOfSound > 0.0 ? config.speedOfSound : 1500.0;
+    ping.dataSize          = sampleSize == 2 ? ImageData16Bit : ImageData8Bit;
+    ping.rangeResolution   = config.range / rangeCount;
+    ping.nRanges           = rangeCount;
+    ping.nBeams            = beamCount;
+    ping.imageOffset       = imageOffset;
+    ping.imageSize         = imageSize;
+    ping.messageSize       = pingTemplate_.size();
+
+    // Bearings are not evenly spaced on a real sonar (more resolution in the
+    // center). Using a sine spacing, a single beam points straight ahead.
+    double aperture = (config.masterMode == 1 ? 130.0 : 70.0) * M_PI / 180.0;
+    auto bearings = reinterpret_cast<int16_t*>(pingTemplate_.data() + sizeof(PingResult));
+    for (unsigned int b = 0; b < beamCount; b++) {
+        double position = beamCount > 1 ? 2.0 * b / (beamCount - 1) - 1.0 : 0.0;
+        double s = std::sin(0.5*aperture) * position;
+        bearings[b] = std::lround(100.0 * std::asin(s) * 180.0 / M_PI);
+    }
+
+    // Synthetic image : attenuation with range, a few bright targets.
+    uint8_t* line = pingTemplate_.data() + imageOffset;
+    for (unsigned int r = 0; r < rangeCount; r++, line += lineSize) {
+        uint8_t* samples = line;
+        if (gains) {
+            uint32_t gain = 1 + r;
+            std::memcpy(line, &gain, sizeof(gain));
+            samples += 4;
+        }
+        for (unsigned int b = 0; b < beamCount; b++) {
+            double value = 0.5 * std::exp(-3.0 * r / rangeCount)
+                         * (1.0 + 0.3 * std::sin(0.05 * b + 0.11 * r));
+            if ((r % 97) < 3 && (b % 61) < 4) value = 1.0;
+            if (sampleSize == 2) {
+                uint16_t v = value * 65535;
+                std::memcpy(samples + 2*b, &v, sizeof(v));
+            }
+            else {
+                samples[b] = value * 255;
+            }
+        }
+    }
+}
+
+SonarServer::BufferPtr SonarSimulator::make_ping()
+{
+    auto ping = std::make_shared<Buffer>(pingTemplate_);
+    auto& metadata = *reinterpret_cast<PingResult*>(ping->data());
+    metadata.pingId        = pingId_++;
+    metadata.pingStartTime = std::chrono::duration<double>(Clock::now() - bootTime_).count();
+    pingCount_++;
+    return ping;
+}
+
+void SonarSimulator::send_ping()
+{
+    this->enqueue(this->make_ping());
+}
+
+void SonarSimulator::send_dummy()
+{
+    OculusMessageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.oculusId    = OCULUS_CHECK_ID;
+    header.srcDeviceId = config_.deviceId;
+    header.msgId       = MsgDummy;
+    header.msgVersion  = 2;
+    header.partNumber  = config_.partNumber;
+    this->send(&header, sizeof(header));
+}
+
+void SonarSimulator::schedule_next()
+{
+    pingTimer_.cancel();
+    if (!this->client_connected()) return;
+
+    if (pingConfig_.flags & 0x80) return;  // pings only on request
+    if (this->free_running()) {
+        this->fill_queue();
+        return;
+    }
+
+    auto period = this->ping_period();
+    if (period <= 0.0) {
+        // Standby : a real sonar sends dummy messages.
+        period = 1.0;
+    }
+
+    // Absolute schedule, so the rate does not drift with processing time.
+    auto now = Clock::now();
+    nextPing_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+    if (nextPing_ < now) {
+        nextPing_ = now;
+    }
+    pingTimer_.expires_at(nextPing_);
+    pingTimer_.async_wait(
+        alive_.guard(std::bind(&SonarSimulator::ping_callback, this, _1)));
+}
+
+void SonarSimulator::ping_callback(const boost::system::error_code& err)
+{
+    if (err) return;
+    if (pingConfig_.pingRate == PingRateStandby) {
+        this->send_dummy();
+    }
+    else {
+        this->send_ping();
+    }
+    this->schedule_next();
+}
+
+/**
+ * Free running mode : keeps a few pings in the send queue so the socket is
+ * never idle.
+ */
+void SonarSimulator::fill_queue()
+{
+    while (this->client_connected() && this->queue_size() < 4) {
+        this->enqueue(this->make_ping());
+    }
+}
+
+void SonarSimulator::on_message_sent()
+{
+    if (this->free_running()) {
+        this->fill_queue();
+    }
+}
+
+void SonarSimulator::on_client_connected()
+{
+    // A real sonar starts pinging with its last configuration.
+    nextPing_ = Clock::now();
+    this->schedule_next();
+}
+
+void SonarSimulator::on_client_disconnected()
+{
+    pingTimer_.cancel();
+}
+
+void SonarSimulator::on_message(const OculusMessageHeader& header, const Buffer& payload)
+{
+    if (header.msgId != MsgSimpleFire) {
+        logger->warn("Unhandled message type from client : {}", header.msgId);
+        return;
+    }
+    if (payload.size() + sizeof(header) < sizeof(PingConfig)) {
+        logger->error("Fire message too short ({} bytes)", payload.size());
+        return;
+    }
+
+    std::memcpy(&pingConfig_, &header, sizeof(header));
+    std::memcpy(reinterpret_cast<uint8_t*>(&pingConfig_) + sizeof(header),
+                payload.data(), sizeof(PingConfig) - sizeof(header));
+    this->build_ping_template();
+
+    if (pingConfig_.flags & 0x80) {
+        // Network trigger : one ping per fire message.
+        pingTimer_.cancel();
+        this->send_ping();
+        return;
+    }
+    nextPing_ = Clock::now();
+    this->schedule_next();
+}
+
+}  // namespace oculus
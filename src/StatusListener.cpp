@@ -26,6 +26,7 @@ StatusListener::StatusListener(const IoServicePtr &service,
                                const std::shared_ptr<spdlog::logger> &logger,
                                uint16_t listeningPort)
     : logger(logger->clone("oculus::StatusListener")),
+      strand_(boost::asio::make_strand(*service)),
       socket_(*service),
       remote_(boost::asio::ip::address_v4::any(), listeningPort)
 {
@@ -44,13 +45,27 @@ StatusListener::StatusListener(const IoServicePtr &service,
     this->get_one_message();
 }
 
+std::future<void> StatusListener::flush()
+{
+    auto done   = std::make_shared<std::promise<void>>();
+    auto future = done->get_future();
+    if (strand_.running_in_this_thread()) {
+        done->set_value();
+    }
+    else {
+        boost::asio::post(strand_, [done]() { done->set_value(); });
+    }
+    return future;
+}
+
 void StatusListener::get_one_message()
 {
     socket_.async_receive(
         boost::asio::buffer(
             static_cast<void*>(&msg_),
             sizeof(msg_)),
-        std::bind(&StatusListener::message_callback, this, _1, _2));
+        boost::asio::bind_executor(strand_,
+            std::bind(&StatusListener::message_callback, this, _1, _2)));
 }
 
 void StatusListener::message_callback(const boost::system::error_code& err,
@@ -0,0 +1,278 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "oculus_driver/TriggerScheduler.h"
+
+namespace oculus {
+
+TriggerScheduler::TriggerScheduler(SonarDriver& driver,
+                                   const std::shared_ptr<spdlog::logger>& logger) :
+    logger(logger->clone("oculus::TriggerScheduler")),
+    driver_(driver),
+    triggerTimer_(driver.strand()),
+    timeoutTimer_(driver.strand()),
+    mode_(Manual),
+    config_(default_ping_config()),
+    period_(Clock::duration::zero()),
+    pingTimeout_(std::chrono::seconds(1)),
+    running_(false),
+    inFlight_(false),
+    triggerPending_(false),
+    triggerId_(0),
+    scheduleId_(0),
+    triggerCount_(0),
+    pingCount_(0),
+    lostCount_(0),
+    skippedCount_(0)
+{
+    config_.flags |= NetworkTriggerFlag;
+    headerHandle_ = driver_.header_callbacks().append(alive_.guard(
+        std::bind(&TriggerScheduler::on_header, this, std::placeholders::_1)));
+    connectHandle_ = driver_.connect_callbacks().append(alive_.guard(
+        std::bind(&TriggerScheduler::on_connect, this)));
+}
+
+TriggerScheduler::~TriggerScheduler()
+{
+    // Handlers still pending in the strand (or the timer handlers aborted
+    // when the timers are destroyed) do nothing after this.
+    alive_.kill();
+    driver_.header_callbacks().remove(headerHandle_);
+    driver_.connect_callbacks().remove(connectHandle_);
+}
+
+void TriggerScheduler::start_manual(const PingConfig& config)
+{
+    this->start_scheduled(config, Manual, Clock::duration::zero(), Clock::now());
+}
+
+void TriggerScheduler::start_pipelined(const PingConfig& config)
+{
+    this->start_scheduled(config, Pipelined, Clock::duration::zero(), Clock::now());
+}
+
+void TriggerScheduler::start_periodic(const PingConfig& config,
+                                      const Clock::duration& period,
+                                      const TimePoint& start)
+{
+    if (period <= Clock::duration::zero()) {
+        throw std::runtime_error("TriggerScheduler : the period must be positive");
+    }
+    this->start_scheduled(config, Periodic, period, start);
+}
+
+void TriggerScheduler::start_scheduled(const PingConfig& config, Mode mode,
+                                       const Clock::duration& period,
+                                       const TimePoint& start)
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this, config, mode, period, start]() {
+        mode_           = mode;
+        config_         = config;
+        config_.flags  |= NetworkTriggerFlag;
+        period_         = period;
+        running_        = true;
+        triggerPending_ = false;
+        scheduleId_++;
+        triggerTimer_.cancel();
+
+        if (mode_ == Pipelined) {
+            this->send_trigger();
+        }
+        else if (mode_ == Periodic) {
+            nextTrigger_ = start;
+            this->schedule_at(nextTrigger_);
+        }
+    }));
+}
+
+void TriggerScheduler::stop()
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this]() {
+        running_        = false;
+        inFlight_       = false;
+        triggerPending_ = false;
+        scheduleId_++;
+        triggerId_++;
+        triggerTimer_.cancel();
+        timeoutTimer_.cancel();
+    }));
+}
+
+void TriggerScheduler::trigger()
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this]() { this->send_trigger(); }));
+}
+
+void TriggerScheduler::trigger_at(const TimePoint& when)
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this, when]() {
+        if (!running_ || mode_ != Manual) {
+            logger->warn("trigger_at() ignored : the scheduler is not in Manual mode");
+            return;
+        }
+        scheduleId_++;
+        nextTrigger_ = when;
+        this->schedule_at(when);
+    }));
+}
+
+void TriggerScheduler::set_config(const PingConfig& config)
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this, config]() {
+        config_        = config;
+        config_.flags |= NetworkTriggerFlag;
+    }));
+}
+
+void TriggerScheduler::set_ping_timeout(const Clock::duration& timeout)
+{
+    boost::asio::post(driver_.strand(), alive_.guard([this, timeout]() {
+        pingTimeout_ = timeout;
+    }));
+}
+
+/**
+ * Sends a trigger now, or when the ping in flight arrives (in the strand).
+ */
+void TriggerScheduler::send_trigger()
+{
+    if (!running_) return;
+    if (inFlight_) {
+        triggerPending_ = true;
+        return;
+    }
+    if (!driver_.connected()) {
+        logger->warn("Trigger dropped : not connected");
+        return;
+    }
+
+    inFlight_     = true;
+    triggerStamp_ = Clock::now();
+    triggerCount_++;
+    driver_.async_send_ping_config(config_);
+
+    auto id = ++triggerId_;
+    timeoutTimer_.expires_after(pingTimeout_);
+    timeoutTimer_.async_wait(alive_.guard([this, id](const boost::system::error_code& err) {
+        this->timeout_callback(err, id);
+    }));
+}
+
+void TriggerScheduler::schedule_at(const TimePoint& when)
+{
+    auto id = scheduleId_;
+    triggerTimer_.expires_at(when);
+    triggerTimer_.async_wait(alive_.guard([this, id](const boost::system::error_code& err) {
+        this->scheduled_callback(err, id);
+    }));
+}
+
+void TriggerScheduler::scheduled_callback(const boost::system::error_code& err,
+                                          uint64_t scheduleId)
+{
+    if (err || !running_ || scheduleId != scheduleId_) return;
+
+    auto now = Clock::now();
+    lateness_.record(now - nextTrigger_);
+    if (mode_ == Manual) {
+        this->send_trigger();
+        return;
+    }
+
+    // Periodic
+    if (inFlight_) {
+        skippedCount_++;
+    }
+    else {
+        this->send_trigger();
+    }
+    // Slots already gone (long ping or io thread delayed) are skipped.
+    nextTrigger_ += period_;
+    while (nextTrigger_ <= now) {
+        nextTrigger_ += period_;
+        skippedCount_++;
+    }
+    this->schedule_at(nextTrigger_);
+}
+
+void TriggerScheduler::on_header(const OculusMessageHeader& header)
+{
+    // Called in the strand by the driver receive loop.
+    if (!inFlight_ || header.msgId != MsgSimplePingResult) return;
+
+    triggerToPing_.record(Clock::now() - triggerStamp_);
+    pingCount_++;
+    this->trigger_done();
+}
+
+void TriggerScheduler::on_connect()
+{
+    // New connection (in the strand) : the ping of a trigger in flight will
+    // never come, and the pipeline has to be restarted.
+    inFlight_ = false;
+    triggerId_++;
+    timeoutTimer_.cancel();
+    if (running_ && (mode_ == Pipelined || triggerPending_)) {
+        triggerPending_ = false;
+        this->send_trigger();
+    }
+}
+
+void TriggerScheduler::timeout_callback(const boost::system::error_code& err,
+                                        uint64_t triggerId)
+{
+    if (err || !inFlight_ || triggerId != triggerId_) return;
+
+    logger->warn("No ping received {}ms after the trigger",
+        std::chrono::duration_cast<std::chrono::milliseconds>(pingTimeout_).count());
+    lostCount_++;
+    this->trigger_done();
+}
+
+void TriggerScheduler::trigger_done()
+{
+    inFlight_ = false;
+    triggerId_++;
+    timeoutTimer_.cancel();
+    if (mode_ == Pipelined || triggerPending_) {
+        triggerPending_ = false;
+        this->send_trigger();
+    }
+}
+
+TriggerScheduler::Stats TriggerScheduler::stats() const
+{
+    Stats stats;
+    stats.triggers = triggerCount_;
+    stats.pings    = pingCount_;
+    stats.lost     = lostCount_;
+    stats.skipped  = skippedCount_;
+    return stats;
+}
+
+void TriggerScheduler::reset_statistics()
+{
+    triggerCount_ = 0;
+    pingCount_    = 0;
+    lostCount_    = 0;
+    skippedCount_ = 0;
+    triggerToPing_.reset();
+    lateness_.reset();
+}
+
+}  // namespace oculus
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/AsyncRecorder.h"
+#include "oculus_driver/Recorder.h"
+#include "test_messages.h"
+using namespace oculus;
+
+int main()
+{
+    const std::string filename = "/tmp/async_recorder_test.oculus";
+    const unsigned int messageCount = 2000;
+
+    std::vector<Message::ConstPtr> messages;
+    for (unsigned int i = 0; i < messageCount; i++) {
+        messages.push_back(make_message(i, 1000 + 37*(i % 100)));
+        if (!messages.back()) {
+            cout << "Could not build message " << i << endl;
+            return -1;
+        }
+    }
+
+    // Nothing must be lost with the Block policy, even with a small queue.
+    {
+        AsyncRecorder recorder(16, AsyncRecorder::Block, 64*1024);
+        recorder.open(filename);
+        for (const auto& msg : messages) {
+            recorder.write(msg);
+        }
+        recorder.close();
+
+        auto stats = recorder.stats();
+        cout << "Block : received " << stats.received << ", written " << stats.written
+             << ", dropped " << stats.dropped << ", " << stats.bytes << " bytes in "
+             << stats.writeCalls << " writes" << endl;
+        cout << "- write : " << recorder.write_latency().summary() << endl;
+        if (!recorder.error().empty()) {
+            cout << "Write error : " << recorder.error() << endl;
+            return -1;
+        }
+        if (stats.written != messageCount || stats.dropped != 0) {
+            cout << "Messages lost with the Block policy" << endl;
+            return -1;
+        }
+        if (stats.writeCalls >= messageCount) {
+            cout << "Writes were not coalesced" << endl;
+            return -1;
+        }
+    }
+
+    // Reading back with the synchronous FileReader.
+    {
+        FileReader reader(filename);
+        unsigned int count = 0;
+        while (auto msg = reader.read_next_message()) {
+            if (count >= messageCount) {
+                cout << "Too many messages in the file" << endl;
+                return -1;
+            }
+            const auto& expected = messages[count];
+            if (msg->data() != expected->data()) {
+                cout << "Message " << count << " content mismatch" << endl;
+                return -1;
+            }
+            if (msg->timestamp() != expected->timestamp()) {
+                cout << "Message " << count << " timestamp mismatch" << endl;
+                return -1;
+            }
+            count++;
+        }
+        if (count != messageCount) {
+            cout << "Read " << count << " messages, expected " << messageCount << endl;
+            return -1;
+        }
+    }
+
+    // Every message is accounted for when the writer cannot keep up.
+    {
+        AsyncRecorder recorder(4, AsyncRecorder::DropNewest, 4096);
+        recorder.open(filename);
+        for (const auto& msg : messages) {
+            recorder.write(msg);
+        }
+        recorder.close();
+
+        auto stats = recorder.stats();
+        cout << "DropNewest : received " << stats.received << ", written " << stats.written
+             << ", dropped " << stats.dropped << endl;
+        if (stats.received != messageCount
+            || stats.written + stats.dropped != messageCount) {
+            cout << "Messages not accounted for" << endl;
+            return -1;
+        }
+
+        FileReader reader(filename);
+        unsigned int count = 0;
+        while (reader.read_next_message()) count++;
+        if (count != stats.written) {
+            cout << "Read " << count << " messages, " << stats.written << " written" << endl;
+            return -1;
+        }
+    }
+
+    cout << "Success" << endl;
+    return 0;
+}
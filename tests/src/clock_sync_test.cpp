@@ -0,0 +1,52 @@
+#include <iostream>
+#include <random>
+using namespace std;
+
+#include "oculus_driver/ClockSync.h"
+using namespace oculus;
+
+// Synthetic pings : sonar clock drifting by 50ppm, receive delay of 5ms plus
+// an exponentially distributed jitter.
+int main()
+{
+    using namespace std::chrono;
+    ClockSync sync;
+    sync.set_fixed_delay(0.005);
+
+    std::mt19937 gen(0);
+    std::exponential_distribution<double> jitter(1.0 / 0.010);
+
+    auto t0 = Message::TimeSource::now();
+    auto host_of = [&](double sonarTime) {
+        return t0 + duration_cast<Message::TimePoint::duration>(
+            duration<double>((1.0 + 50.0e-6) * (sonarTime - 100.0)));
+    };
+
+    double maxError = 0.0;
+    for (int i = 0; i < 2000; i++) {
+        double sonarTime = 100.0 + 0.1 * i;
+        auto received = host_of(sonarTime) + duration_cast<Message::TimePoint::duration>(
+            duration<double>(0.005 + jitter(gen)));
+        sync.update(sonarTime, received);
+        if (i > 300) {
+            double error = duration<double>(sync.host_time(sonarTime) - host_of(sonarTime)).count();
+            maxError = std::max(maxError, std::abs(error));
+        }
+    }
+    cout << "skew      : " << 1.0e6 * sync.skew() << "ppm (expected 50)" << endl;
+    cout << "max error : " << 1.0e3 * maxError << "ms (raw jitter mean 10ms)" << endl;
+
+    // Host side stall : late samples are not a reboot.
+    for (int i = 2000; i < 2005; i++) {
+        double sonarTime = 100.0 + 0.1 * i;
+        sync.update(sonarTime, host_of(sonarTime) + std::chrono::seconds(3));
+    }
+    cout << "stall     : " << sync.reset_count() << " resets (expected 0)" << endl;
+    if (sync.reset_count() != 0) return -1;
+
+    // Sonar reboot
+    sync.update(1.0, Message::TimeSource::now());
+    cout << "resets    : " << sync.reset_count() << " (expected 1)" << endl;
+
+    return (maxError < 0.002 && sync.reset_count() == 1) ? 0 : -1;
+}
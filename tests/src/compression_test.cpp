@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/AsyncRecorder.h"
+#include "oculus_driver/Compression.h"
+#include "oculus_driver/Recorder.h"
+#include "test_messages.h"
+using namespace oculus;
+
+int main()
+{
+    std::vector<Message::ConstPtr> messages;
+    for (unsigned int i = 0; i < 200; i++) {
+        messages.push_back(make_message(i, 20000 + 13*i));
+    }
+
+    // qCompress layout : big-endian uncompressed size then a zlib stream.
+    {
+        const auto& data = messages[0]->data();
+        std::vector<uint8_t> compressed;
+        compress(QCompress, data.data(), data.size(), compressed);
+        uint32_t prefix = (compressed[0] << 24) | (compressed[1] << 16)
+                        | (compressed[2] << 8)  |  compressed[3];
+        if (prefix != data.size() || compressed[4] != 0x78) {
+            cout << "Not a qCompress buffer" << endl;
+            return -1;
+        }
+        std::vector<uint8_t> decompressed(data.size());
+        decompress(QCompress, compressed.data(), compressed.size(),
+                   decompressed.data(), decompressed.size());
+        if (!std::equal(decompressed.begin(), decompressed.end(), data.begin(), data.end())) {
+            cout << "qCompress round trip failed" << endl;
+            return -1;
+        }
+        cout << "qCompress ratio : " << (double)data.size() / compressed.size() << endl;
+
+        compressed[compressed.size() / 2] ^= 0xff;
+        bool thrown = false;
+        try {
+            decompress(QCompress, compressed.data(), compressed.size(),
+                       decompressed.data(), decompressed.size());
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            cout << "Corrupted data not detected" << endl;
+            return -1;
+        }
+    }
+
+    std::vector<Compression> compressions = {NoCompression, QCompress};
+    if (compression_supported(Zstd))
+        compressions.push_back(Zstd);
+
+    for (auto compression : compressions) {
+        std::string filename = "/tmp/compression_test_"
+                             + std::to_string(compression) + ".oculus";
+        {
+            Recorder recorder;
+            recorder.set_compression(compression);
+            recorder.open(filename, true);
+            for (const auto& msg : messages) {
+                recorder.write(msg);
+            }
+            recorder.close();
+        }
+        if (!check_file(filename, messages, compression))
+            return -1;
+
+        AsyncRecorder::Stats stats;
+        {
+            AsyncRecorder recorder(64, AsyncRecorder::Block, 256*1024);
+            recorder.set_compression(compression, -1, 2);
+            recorder.open(filename);
+            for (const auto& msg : messages) {
+                recorder.write(msg);
+            }
+            recorder.close();
+            stats = recorder.stats();
+        }
+        if (stats.written != messages.size()) {
+            cout << "AsyncRecorder wrote " << stats.written << " messages" << endl;
+            return -1;
+        }
+        cout << "compression " << compression << " : " << stats.rawBytes << " -> "
+             << stats.bytes << " bytes" << endl;
+        if (compression != NoCompression && 4*stats.bytes > 3*stats.rawBytes) {
+            cout << "Poor compression" << endl;
+            return -1;
+        }
+        if (!check_file(filename, messages, compression))
+            return -1;
+    }
+
+    cout << "Success" << endl;
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+double seconds_since(const std::chrono::steady_clock::time_point& t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Config requests against a SonarSimulator (which echoes the requested config
+// in its pings) : they must complete on the first matching ping, not after a
+// fixed wait.
+int main()
+{
+    AsyncService simService;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger());
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    ioService.start();
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!sonar.connected()) {
+        cout << "Could not connect to the simulator" << endl;
+        return -1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    sonar.current_ping_config();
+    double elapsed = seconds_since(t0);
+    cout << "current_ping_config : " << elapsed << "s" << endl;
+    if (elapsed > 1.0) return -1;
+
+    auto request = default_ping_config();
+    request.range = 12.5;
+    t0 = std::chrono::steady_clock::now();
+    auto feedback = sonar.request_ping_config(request);
+    elapsed = seconds_since(t0);
+    cout << "request_ping_config : " << elapsed << "s, range " << feedback.range << endl;
+    if (elapsed > 1.0 || feedback.head.msgId != MsgSimplePingResult || feedback.range != 12.5)
+        return -1;
+
+    // From a driver callback, waiting for the strand would never return.
+    std::promise<bool> thrown;
+    std::atomic<bool>  called(false);
+    auto handle = sonar.ping_callbacks().append([&](const PingMessage::ConstPtr&) {
+        if (called.exchange(true)) return;
+        try {
+            sonar.request_ping_config(request, boost::posix_time::milliseconds(100));
+            thrown.set_value(false);
+        }
+        catch(const std::runtime_error&) {
+            thrown.set_value(true);
+        }
+    });
+    auto thrownFuture = thrown.get_future();
+    if (thrownFuture.wait_for(std::chrono::seconds(2)) != std::future_status::ready
+        || !thrownFuture.get()) {
+        cout << "request_ping_config from a callback did not throw" << endl;
+        return -1;
+    }
+    sonar.ping_callbacks().remove(handle);
+
+    // No feedback without a connection : deadline and cancellation.
+    sonar.close_connection();
+    request.range = 20.0;
+    t0 = std::chrono::steady_clock::now();
+    auto result = sonar.async_request_ping_config(request, boost::posix_time::milliseconds(300));
+    try {
+        result.get();
+        cout << "Request without connection succeeded" << endl;
+        return -1;
+    }
+    catch(const TimeoutReached&) {
+        elapsed = seconds_since(t0);
+        cout << "Timeout reached after " << elapsed << "s" << endl;
+        if (elapsed < 0.25 || elapsed > 1.0) return -1;
+    }
+
+    CancellationToken cancel;
+    result = sonar.async_request_ping_config(request, boost::posix_time::seconds(10), cancel);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    t0 = std::chrono::steady_clock::now();
+    cancel.cancel();
+    try {
+        result.get();
+        cout << "Cancelled request succeeded" << endl;
+        return -1;
+    }
+    catch(const RequestCancelled&) {
+        elapsed = seconds_since(t0);
+        cout << "Cancelled after " << elapsed << "s" << endl;
+        if (elapsed > 0.1) return -1;
+    }
+
+    // A token reused for several requests must not keep their callbacks.
+    CancellationToken reused;
+    request.range = 12.5;
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (int i = 0; i < 3; i++) {
+        sonar.async_request_ping_config(request, boost::posix_time::seconds(10), reused).get();
+    }
+    cout << "Cancellation registrations left : " << reused.registration_count() << endl;
+    if (reused.registration_count() != 0) return -1;
+
+    ioService.stop();
+    simService.stop();
+    return 0;
+}
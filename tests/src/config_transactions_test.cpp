@@ -0,0 +1,102 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+double to_seconds(const ConfigTransactions::Clock::duration& d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+// Settle time of config changes against a SonarSimulator.
+int main()
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 20.0;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    std::atomic<std::size_t> appliedCount(0);
+    sonar.config_transactions().applied_callbacks().append(
+        [&](const ConfigTransactions::Result&) { appliedCount++; });
+    ioService.start();
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!sonar.connected()) {
+        cout << "Could not connect to the simulator" << endl;
+        return -1;
+    }
+    sonar.request_ping_config(default_ping_config());
+
+    // Range and frequency switch
+    auto config = sonar.last_ping_config();
+    config.range      = 15.0;
+    config.masterMode = 1;
+    auto result = sonar.apply_ping_config(config).get();
+    cout << "Transaction " << result.id << " : applied " << result.applied
+         << " in " << to_seconds(result.settleTime) << "s, range "
+         << result.feedback.range << endl;
+    if (!result.applied || result.feedback.range != 15.0 || result.feedback.masterMode != 1
+        || to_seconds(result.settleTime) > 1.0)
+        return -1;
+    const auto& transactions = sonar.config_transactions();
+    if (transactions.histogram(ConfigTransactions::Range).count() != 1
+        || transactions.histogram(ConfigTransactions::MasterMode).count() != 1
+        || transactions.histogram(ConfigTransactions::Gain).count() != 0)
+        return -1;
+
+    // Nothing changed : applied right away.
+    result = sonar.apply_ping_config(config).get();
+    if (!result.applied || result.fields != 0) return -1;
+
+    // Burst : only the last one is applied.
+    config.gain = 20.0;
+    auto first = sonar.apply_ping_config(config);
+    config.gain = 30.0;
+    auto second = sonar.apply_ping_config(config);
+    if (first.get().applied || !second.get().applied || second.get().feedback.gain != 30.0)
+        return -1;
+
+    cout << "Settle times :\n" << transactions.summary();
+    cout << transactions.applied_count() << " applied, " << transactions.superseded_count()
+         << " superseded, " << appliedCount << " applied callbacks" << endl;
+    if (transactions.superseded_count() != 1 || appliedCount != transactions.applied_count())
+        return -1;
+
+    // A request the sonar never reports ends on timeout, or on abort().
+    ConfigTransactions standalone;
+    auto request = config;
+    request.range = 42.0;
+    auto aborted = standalone.begin(config, request);
+    standalone.abort();
+    standalone.set_timeout(std::chrono::milliseconds(10));
+    auto expired = standalone.begin(config, request);
+    standalone.check_timeout();
+    if (expired.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        return -1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    standalone.check_timeout();
+    if (aborted.get().status != ConfigTransactions::Aborted
+        || expired.get().status != ConfigTransactions::TimedOut
+        || standalone.failed_count() != 2 || standalone.pending())
+    {
+        cout << "Pending transactions not ended by abort() or timeout" << endl;
+        return -1;
+    }
+
+    ioService.stop();
+    simService.stop();
+    return 0;
+}
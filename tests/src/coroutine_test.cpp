@@ -0,0 +1,98 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Coroutine receive engine, against a SonarSimulator over loopback.
+int run(SonarClient::FramingMode mode)
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 100.0;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    sonar.set_receive_engine(SonarClient::Coroutine);
+    sonar.set_framing_mode(mode);
+
+    std::atomic<int> pingCount(0);
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr&) { pingCount++; });
+    sonar.connect_callbacks().append([&]() {
+        sonar.send_ping_config(default_ping_config());
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    // closing and reconnecting while receiving
+    sonar.reset_connection();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ioService.stop();
+    simService.stop();
+
+    cout << "Framing mode " << mode << " : received " << pingCount << " pings, sent "
+         << simulator.ping_count() << endl;
+    return pingCount >= 150 ? 0 : -1;
+}
+
+// The sonar stops sending after one ping (network trigger mode) : the
+// coroutine must time out and reconnect by itself.
+int run_timeout()
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 50.0;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    sonar.set_receive_engine(SonarClient::Coroutine);
+    sonar.set_receive_timeout(boost::posix_time::milliseconds(500));
+    sonar.set_reconnect_delay(boost::posix_time::milliseconds(100));
+
+    std::atomic<int> pingCount(0);
+    std::atomic<int> connectCount(0);
+    std::atomic<int> timeoutCount(0);
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr&) { pingCount++; });
+    sonar.error_callbacks().append([&](const boost::system::error_code& err) {
+        if (err == boost::asio::error::timed_out)
+            timeoutCount++;
+    });
+    sonar.connect_callbacks().append([&]() {
+        auto config = default_ping_config();
+        if (connectCount++ == 0)
+            config.flags |= 0x80;  // network trigger : a single ping
+        sonar.send_ping_config(config);
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    ioService.stop();
+    simService.stop();
+
+    cout << "Timeout : " << connectCount << " connections, " << timeoutCount
+         << " timeouts, " << pingCount << " pings" << endl;
+    if (connectCount < 2 || timeoutCount < 1)
+        return -1;
+    return pingCount >= 50 ? 0 : -1;
+}
+
+int main()
+{
+    if (run(SonarClient::PerMessage) < 0) return -1;
+    if (run(SonarClient::Batched) < 0) return -1;
+    if (run_timeout() < 0) return -1;
+    return 0;
+}
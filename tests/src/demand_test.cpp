@@ -0,0 +1,109 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/DemandController.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Ping rate following the subscribers, against a SonarSimulator pinging at
+// the requested PingRateType.
+int main()
+{
+    AsyncService simService;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger());
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    DemandController demand(sonar, spdlog::default_logger());
+    demand.set_standby_delay(std::chrono::milliseconds(200));
+    demand.set_full_rate(PingRateHighest);
+    ioService.start();
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!sonar.connected()) {
+        cout << "Could not connect to the simulator" << endl;
+        return -1;
+    }
+
+    // No subscriber : standby after the delay.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    if (simulator.ping_config().pingRate != PingRateStandby) {
+        cout << "Not in standby without subscribers" << endl;
+        return -1;
+    }
+
+    // A slow consumer : the slowest rate above 4Hz.
+    std::atomic<int> pingCount(0);
+    auto slow = demand.subscribe([&](const PingMessage::ConstPtr&) { pingCount++; }, 4.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    if (simulator.ping_config().pingRate != PingRateLow || pingCount == 0) {
+        cout << "Expected the low ping rate after a 4Hz subscriber" << endl;
+        return -1;
+    }
+
+    // A consumer without minimum : full rate.
+    auto full = demand.subscribe(nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (simulator.ping_config().pingRate != PingRateHighest) {
+        cout << "Expected the full ping rate" << endl;
+        return -1;
+    }
+    full.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (simulator.ping_config().pingRate != PingRateLow) {
+        cout << "Expected the low ping rate after unsubscribing" << endl;
+        return -1;
+    }
+
+    // A subscriber leaving and coming back within the delay : no standby.
+    slow.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    slow = demand.subscribe(nullptr, 4.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto stats = demand.stats();
+    if (stats.standbys != 1) {
+        cout << "Unexpected standby" << endl;
+        return -1;
+    }
+
+    slow.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    auto resumeCount = pingCount.load();
+    slow = demand.subscribe([&](const PingMessage::ConstPtr&) { pingCount++; }, 10.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    stats = demand.stats();
+    cout << stats.transitions << " transitions, " << stats.standbys << " standbys, "
+         << stats.resumes << " resumes, "
+         << std::chrono::duration<double>(stats.standbyTime).count() << "s in standby" << endl
+         << "resume latency : " << demand.resume_latency().summary() << endl;
+    if (stats.standbys != 2 || stats.resumes != 2 || pingCount == resumeCount
+        || simulator.ping_config().pingRate != PingRateNormal)
+        return -1;
+    // Resuming within one ping period (the slowest resume was at 5Hz, the
+    // simulator sends the first ping one period after the fire message).
+    if (demand.resume_latency().max() > std::chrono::milliseconds(250))
+        return -1;
+
+    slow.reset();
+
+    // Destroyed with its updates still pending in the strand.
+    for (int i = 0; i < 10; i++) {
+        DemandController transient(sonar, spdlog::default_logger());
+        transient.set_enabled(false);
+        auto subscription = transient.subscribe(nullptr);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ioService.stop();
+    simService.stop();
+    return 0;
+}
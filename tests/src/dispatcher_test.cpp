@@ -0,0 +1,142 @@
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/BoundedQueue.h"
+#include "oculus_driver/MessageDispatcher.h"
+using namespace oculus;
+
+// Checks the lock-free queue and the dispatcher policies (no sonar needed).
+int queue_test()
+{
+    BoundedQueue<uint64_t> queue(64);
+    const uint64_t count = 200000;
+    std::atomic<uint64_t> sum(0), popped(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 4; p++) {
+        threads.emplace_back([&]() {
+            for (uint64_t i = 1; i <= count; i++)
+                while (!queue.try_push(i)) std::this_thread::yield();
+        });
+    }
+    for (int c = 0; c < 2; c++) {
+        threads.emplace_back([&]() {
+            uint64_t value;
+            while (popped < 4*count) {
+                if (queue.try_pop(value)) { sum += value; popped++; }
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    bool ok = sum == 4 * count * (count + 1) / 2;
+    cout << "queue : " << (ok ? "ok" : "FAILED") << endl;
+    return ok ? 0 : -1;
+}
+
+int policy_test(MessageDispatcher::Policy policy)
+{
+    const int count = 2000;
+    std::vector<Message::ConstPtr> messages;
+    std::unordered_map<const Message*, int> indexes;
+    for (int i = 0; i < count; i++) {
+        messages.push_back(Message::Create());
+        indexes[messages.back().get()] = i;
+    }
+
+    MessageDispatcher dispatcher(spdlog::default_logger());
+    std::vector<int> received;
+    auto subscriber = dispatcher.subscribe([&](const Message::ConstPtr& msg) {
+        received.push_back(indexes[msg.get()]);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }, policy, 8);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& msg : messages) {
+        dispatcher.dispatch(msg);
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+    double dispatchTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    auto stats = subscriber->stats();
+    while (stats.delivered + stats.dropped < stats.received) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stats = subscriber->stats();
+    }
+    dispatcher.unsubscribe(subscriber);
+
+    bool ok = stats.received == count && stats.delivered == received.size()
+           && stats.delivered + stats.dropped == count
+           && std::is_sorted(received.begin(), received.end());
+    // The last message is always delivered, except when dropping new ones.
+    if (policy != MessageDispatcher::DropNewest)
+        ok = ok && received.back() == count - 1;
+    if (policy == MessageDispatcher::Block)
+        ok = ok && stats.dropped == 0;
+    else
+        ok = ok && stats.dropped > 0;
+
+    cout << "policy " << policy << " : delivered " << stats.delivered
+         << ", dropped " << stats.dropped << ", dispatch loop "
+         << dispatchTime << "s : " << (ok ? "ok" : "FAILED") << endl;
+    return ok ? 0 : -1;
+}
+
+// A dispatcher destroyed before its driver must disconnect from it.
+int connect_test()
+{
+    auto service  = std::make_shared<SonarDriver::IoService>();
+    auto listener = std::make_shared<StatusListener>(service, spdlog::default_logger(), 0);
+    SonarDriver driver(service, spdlog::default_logger(), listener);
+    {
+        MessageDispatcher dispatcher(spdlog::default_logger());
+        dispatcher.connect(driver);
+    }
+    bool ok = driver.message_callbacks().empty();
+    cout << "connect : " << (ok ? "ok" : "FAILED") << endl;
+    return ok ? 0 : -1;
+}
+
+// A subscriber unsubscribing from its own callback.
+int self_unsubscribe_test()
+{
+    MessageDispatcher dispatcher(spdlog::default_logger());
+    std::atomic<int> calls(0);
+    MessageDispatcher::Subscriber::Ptr subscriber;
+    std::mutex mutex;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        subscriber = dispatcher.subscribe([&](const Message::ConstPtr&) {
+            MessageDispatcher::Subscriber::Ptr self;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                std::swap(self, subscriber);
+            }
+            if (self) dispatcher.unsubscribe(self);
+            calls++;
+        });
+    }
+    for (int i = 0; i < 10; i++) {
+        dispatcher.dispatch(Message::Create());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bool ok = calls == 1 && dispatcher.stats().empty();
+    cout << "self unsubscribe : " << (ok ? "ok" : "FAILED") << endl;
+    return ok ? 0 : -1;
+}
+
+int main()
+{
+    if (queue_test() < 0) return -1;
+    if (connect_test() < 0) return -1;
+    if (self_unsubscribe_test() < 0) return -1;
+    for (auto policy : {MessageDispatcher::Block, MessageDispatcher::DropOldest,
+                        MessageDispatcher::DropNewest, MessageDispatcher::LatestOnly}) {
+        if (policy_test(policy) < 0) return -1;
+    }
+    return 0;
+}
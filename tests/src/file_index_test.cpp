@@ -0,0 +1,163 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/FileIndex.h"
+#include "oculus_driver/MmapFileReader.h"
+#include "oculus_driver/Recorder.h"
+#include "test_messages.h"
+using namespace oculus;
+
+int main()
+{
+    const unsigned int pingCount = 200;
+    std::vector<Message::ConstPtr> pings;
+    for (unsigned int i = 0; i < pingCount; i++) {
+        pings.push_back(make_ping(i));
+    }
+    // Seek targets : keyframes (every 64 pings with SonarImage), pings right
+    // after them, config change, end of file.
+    std::vector<std::size_t> targets = {0, 1, 63, 64, 65, 199, 150, 100, 37, 128, 10};
+
+    const std::string filename = "/tmp/file_index_test.oculus";
+    const std::string sidecar  = FileIndex::sidecar_filename(filename);
+    for (auto compression : {NoCompression, QCompress, SonarImage}) {
+        std::remove(sidecar.c_str());
+        {
+            Recorder recorder;
+            recorder.set_compression(compression);
+            recorder.open(filename, true);
+            for (unsigned int i = 0; i < pingCount; i++) {
+                recorder.write(pings[i]);
+                if (i % 9 == 0)
+                    recorder.write(make_status(i));
+            }
+            recorder.close();
+        }
+
+        auto index = FileIndex::build(filename);
+        if (index->ping_count() != pingCount || index->message_count() != pingCount + 23) {
+            cout << "Indexed " << index->ping_count() << " pings and " << index->message_count()
+                 << " messages (compression " << compression << ")" << endl;
+            return -1;
+        }
+        for (std::size_t i = 0; i < pingCount; i++) {
+            const auto& entry = index->ping(i);
+            if (entry.pingId != 1000 + i || entry.timestamp() != pings[i]->timestamp()
+                || entry.messageId != MsgSimplePingResult || entry.compression != compression
+                || entry.configHash != index->ping(i < 150 ? 0 : 199).configHash
+                || entry.is_keyframe() != (compression != SonarImage || i % 64 == 0))
+            {
+                cout << "Wrong index entry for ping " << i << " (compression "
+                     << compression << ")" << endl;
+                return -1;
+            }
+        }
+        if (index->ping(0).configHash == index->ping(199).configHash) {
+            cout << "Config change not detected" << endl;
+            return -1;
+        }
+        if (index->find_ping(pings[42]->timestamp()) != 42
+            || index->find_ping(pings[42]->timestamp() - std::chrono::milliseconds(50)) != 42
+            || index->find_ping(Message::TimePoint()) != 0
+            || index->find_ping(pings[199]->timestamp() + std::chrono::seconds(1)) != pingCount)
+        {
+            cout << "find_ping failed" << endl;
+            return -1;
+        }
+
+        FileReader reader(filename);
+        MmapFileReader mmapReader(filename);
+        for (auto target : targets) {
+            if (!reader.seek(target) || !mmapReader.seek(target)) {
+                cout << "Could not seek to ping " << target << endl;
+                return -1;
+            }
+            // Reading a few pings after the target, across keyframes.
+            for (std::size_t i = target; i < std::min<std::size_t>(target + 3, pingCount); i++) {
+                auto ping = reader.read_next_ping();
+                auto view = mmapReader.read_next_ping();
+                if (!ping || ping->data() != pings[i]->data()
+                    || ping->timestamp() != pings[i]->timestamp()
+                    || !view || view.data().size() != pings[i]->data().size()
+                    || std::memcmp(view.data().data(), pings[i]->data().data(),
+                                   view.data().size()) != 0)
+                {
+                    cout << "Wrong ping " << i << " after seeking to " << target
+                         << " (compression " << compression << ")" << endl;
+                    return -1;
+                }
+            }
+        }
+
+        if (reader.seek(pingCount) || reader.read_next_message()
+            || mmapReader.seek(pingCount) || mmapReader.read_next_message())
+        {
+            cout << "Seeking past the end did not reach the end" << endl;
+            return -1;
+        }
+        if (reader.seek_time(pings[77]->timestamp() - std::chrono::milliseconds(1)) != 77
+            || reader.read_next_ping()->data() != pings[77]->data())
+        {
+            cout << "seek_time failed" << endl;
+            return -1;
+        }
+        reader.rewind();
+        if (reader.read_next_ping()->data() != pings[0]->data()) {
+            cout << "rewind after seek failed" << endl;
+            return -1;
+        }
+    }
+
+    // Sidecar file : written on first use, reused while the recording does
+    // not change.
+    {
+        FileReader reader(filename);
+        reader.seek(3);
+        auto loaded = FileIndex::load(sidecar);
+        if (!loaded->is_up_to_date(filename) || loaded->ping_count() != pingCount
+            || std::memcmp(loaded->entries().data(), reader.index()->entries().data(),
+                           sizeof(FileIndex::Entry) * loaded->message_count()) != 0)
+        {
+            cout << "Sidecar index mismatch" << endl;
+            return -1;
+        }
+
+        Recorder recorder;
+        recorder.open(filename, true);
+        recorder.write(pings[0]);
+        recorder.close();
+        if (loaded->is_up_to_date(filename)
+            || FileIndex::load_or_build(filename, false)->ping_count() != 1)
+        {
+            cout << "Stale sidecar index was used" << endl;
+            return -1;
+        }
+    }
+
+    // Corrupted entry count in the sidecar file : rebuilt, not allocated.
+    {
+        std::fstream file(sidecar, std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t entryCount = uint64_t(1) << 60;
+        file.seekp(8);  // magic, version, entrySize
+        file.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+        file.close();
+        bool thrown = false;
+        try {
+            FileIndex::load(sidecar);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown || FileIndex::load_or_build(filename, false)->ping_count() != 1) {
+            cout << "Corrupted sidecar entry count not detected" << endl;
+            return -1;
+        }
+    }
+
+    cout << "Success" << endl;
+    return 0;
+}
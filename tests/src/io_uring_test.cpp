@@ -0,0 +1,87 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// io_uring receive engine against a SonarSimulator over loopback. Skipped if
+// the library was built without io_uring or the kernel does not support it.
+int main()
+{
+    if (!IoUringReceiver::is_supported()) {
+        cout << "io_uring receive not available, skipping" << endl;
+        return 0;
+    }
+
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate  = 100.0;
+    settings.beamCount = 512;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    sonar.set_receive_engine(SonarClient::IoUring);
+
+    std::atomic<int> pingCount(0);
+    std::atomic<int> badCount(0);
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr& ping) {
+        if (ping->range_count() != 512 || ping->bearing_count() != 512)
+            badCount++;
+        pingCount++;
+    });
+    sonar.connect_callbacks().append([&]() {
+        auto config = default_ping_config();
+        config.flags |= 0x40;  // 512 beams
+        sonar.send_ping_config(config);
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    // reconnecting on the same io_uring instance
+    sonar.reset_connection();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ioService.stop();
+    simService.stop();
+
+    cout << "Received " << pingCount << " pings, sent " << simulator.ping_count()
+         << ", " << badCount << " unexpected" << endl;
+    if (auto receiver = sonar.io_uring_receiver()) {
+        const auto& stats = receiver->stats();
+        cout << "io_uring : " << stats.completions << " completions in "
+             << stats.wakeups << " wake ups, " << stats.submissions << " submissions, "
+             << stats.noBuffers << " buffer shortages" << endl;
+        if (stats.completions == 0)
+            return -1;
+    }
+    else {
+        return -1;
+    }
+    if (pingCount < 150 || badCount != 0)
+        return -1;
+
+    // Destroyed with its recv still armed (the cancellation is waited for).
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+    auto service = std::make_shared<IoUringReceiver::IoService>();
+    ReceiveBuffer output;
+    for (int i = 0; i < 10; i++) {
+        IoUringReceiver receiver(boost::asio::make_strand(*service));
+        receiver.start(fds[0], output, []() {}, [](const boost::system::error_code&) {});
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <boost/asio.hpp>
+
+#include "oculus_driver/KernelTimestamp.h"
+using namespace oculus;
+
+// Checks kernel receive timestamps over loopback (no sonar needed).
+int main()
+{
+    using boost::asio::ip::tcp;
+    boost::asio::io_service service;
+
+    tcp::acceptor acceptor(service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    tcp::socket client(service);
+    client.connect(acceptor.local_endpoint());
+    tcp::socket server(service);
+    acceptor.accept(server);
+
+    if (!enable_kernel_timestamps(client.native_handle())) {
+        cerr << "Could not enable kernel timestamps" << endl;
+        return -1;
+    }
+
+    // The kernel turns receive stamping on asynchronously (deferred static
+    // key) : segments arriving right after the first socket enables it may
+    // not be stamped.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto sendTime = Message::TimeSource::now();
+    uint8_t data[16] = {0};
+    boost::asio::write(server, boost::asio::buffer(data));
+
+    // Receiving late : the kernel stamp must be close to the send time, not to
+    // the read time.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    client.wait(tcp::socket::wait_read);
+
+    Message::TimePoint stamp;
+    if (!peek_kernel_timestamp(client.native_handle(), stamp)) {
+        cerr << "No kernel timestamp received" << endl;
+        return -1;
+    }
+    auto readTime = Message::TimeSource::now();
+    cout << "kernel stamp - send time : "
+         << std::chrono::duration<double, std::milli>(stamp - sendTime).count() << "ms" << endl;
+    cout << "read time - kernel stamp : "
+         << std::chrono::duration<double, std::milli>(readTime - stamp).count() << "ms" << endl;
+
+    // Data must still be there after peeking.
+    if (client.available() != sizeof(data)) {
+        cerr << "Peeking consumed data" << endl;
+        return -1;
+    }
+    return (stamp - sendTime) < std::chrono::milliseconds(50) ? 0 : -1;
+}
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <random>
+using namespace std;
+
+#include "oculus_driver/LatencyHistogram.h"
+using namespace oculus;
+
+int main()
+{
+    LatencyHistogram histogram;
+
+    // uniform values between 1us and 1ms
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<uint64_t> dist(1000, 1000000);
+    for (int i = 0; i < 100000; i++) {
+        histogram.record(dist(gen));
+    }
+    cout << histogram.summary() << endl;
+
+    auto p50 = histogram.percentile(50.0).count();
+    auto p99 = histogram.percentile(99.0).count();
+    cout << "p50 : " << p50 << "ns (expected ~500500)" << endl;
+    cout << "p99 : " << p99 << "ns (expected ~990010)" << endl;
+    if (std::abs((double)p50 - 500500.0) > 0.04 * 500500.0) return -1;
+    if (std::abs((double)p99 - 990010.0) > 0.04 * 990010.0) return -1;
+
+    return 0;
+}
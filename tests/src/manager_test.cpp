@@ -0,0 +1,65 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarManager.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Two simulated sonars (127.0.0.1 and 127.0.0.2) streamed concurrently in the
+// same process (no sonar needed).
+int run(SonarManager::ThreadingMode mode)
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 50.0;
+    SonarSimulator::Config config1, config2;
+    config1.deviceId = 1;
+    config2.deviceId = 2;
+    config2.address  = "127.0.0.2";
+    SonarSimulator sim1(simService.io_service(), spdlog::default_logger(), settings, config1);
+    SonarSimulator sim2(simService.io_service(), spdlog::default_logger(), settings, config2);
+    sim1.start();
+    sim2.start();
+    simService.start();
+
+    std::atomic<int> counts[3] = {0, 0, 0};
+    std::atomic<int> wrongDevice(0);
+
+    SonarManager manager(spdlog::default_logger(), mode, 2);
+    manager.discovery_callbacks().append([&](const SonarDevice& device) {
+        auto driver = manager.attach(device.deviceId);
+        uint16_t id = device.deviceId;
+        driver->ping_callbacks().append([&, id](const PingMessage::ConstPtr& ping) {
+            if (ping->message()->header().srcDeviceId != id) wrongDevice++;
+            counts[id]++;
+        });
+    });
+    manager.start();
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    // Detached while its status messages keep coming.
+    manager.detach(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    if (manager.attached_devices().size() != 1)
+        return -1;
+    manager.stop();
+    simService.stop();
+
+    cout << "mode " << mode << " : " << manager.devices().size() << " devices, "
+         << counts[1] << " pings from sonar 1, " << counts[2] << " pings from sonar 2, "
+         << wrongDevice << " from wrong device" << endl;
+    if (manager.devices().size() != 2 || wrongDevice > 0)
+        return -1;
+    return counts[1] > 50 && counts[2] > 50 ? 0 : -1;
+}
+
+int main()
+{
+    if (run(SonarManager::SharedPool) < 0) return -1;
+    if (run(SonarManager::ThreadPerSonar) < 0) return -1;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/MessagePool.h"
+using namespace oculus;
+
+int main()
+{
+    auto pool = MessagePool::Create(4);
+
+    // Holding more messages than the pool capacity.
+    std::vector<Message::ConstPtr> held;
+    for (int i = 0; i < 6; i++) {
+        held.push_back(pool->acquire(1024*(i + 1)));
+    }
+    cout << "allocations      : " << pool->allocation_count() << endl;
+    cout << "max message size : " << pool->max_message_size() << endl;
+
+    held.clear();
+    cout << "available        : " << pool->available() << " / " << pool->capacity() << endl;
+
+    // These must reuse the released buffers.
+    for (int i = 0; i < 100; i++) {
+        auto msg = pool->acquire(4096);
+        if (msg->data().capacity() < pool->max_message_size()) {
+            cerr << "Recycled buffer not reserved to the max message size" << endl;
+            return -1;
+        }
+    }
+    cout << "allocations      : " << pool->allocation_count() << " (expected 6)" << endl;
+    if (pool->allocation_count() != 6) return -1;
+
+    // Messages can outlive the pool.
+    auto msg = pool->acquire();
+    pool.reset();
+    msg.reset();
+
+    return 0;
+}
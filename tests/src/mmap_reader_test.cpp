@@ -0,0 +1,122 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/MmapFileReader.h"
+#include "oculus_driver/Recorder.h"
+#include "test_messages.h"
+using namespace oculus;
+
+bool same(const MessageView& view, const Message::ConstPtr& msg)
+{
+    return view.data().size() == msg->data().size()
+        && std::memcmp(view.data().data(), msg->data().data(), msg->data().size()) == 0
+        && view.timestamp() == msg->timestamp();
+}
+
+int main()
+{
+    std::vector<Message::ConstPtr> messages;
+    for (unsigned int i = 0; i < 60; i++) {
+        messages.push_back(make_ping(i, 128, 100, 1 + (i / 30), i % 4 == 0, i % 3));
+        if (i % 7 == 0)
+            messages.push_back(make_status(i));
+    }
+
+    for (auto compression : {NoCompression, QCompress, SonarImage}) {
+        const std::string filename = "/tmp/mmap_reader_test.oculus";
+        {
+            Recorder recorder;
+            recorder.set_compression(compression);
+            recorder.open(filename, true);
+            for (const auto& msg : messages) {
+                recorder.write(msg);
+            }
+            recorder.close();
+        }
+
+        std::vector<MessageView> views;
+        {
+            MmapFileReader reader(filename);
+            while (auto view = reader.read_next_message()) {
+                views.push_back(view);
+            }
+            if (views.size() != messages.size()) {
+                cout << "Read " << views.size() << " messages, expected "
+                     << messages.size() << endl;
+                return -1;
+            }
+            reader.rewind();
+            unsigned int pingCount = 0;
+            while (auto view = reader.read_next_ping()) {
+                pingCount++;
+            }
+            if (pingCount != 60) {
+                cout << "Read " << pingCount << " pings, expected 60" << endl;
+                return -1;
+            }
+        }
+
+        // The views outlive the reader.
+        for (std::size_t i = 0; i < views.size(); i++) {
+            if (!same(views[i], messages[i])) {
+                cout << "Message " << i << " mismatch (compression " << compression << ")" << endl;
+                return -1;
+            }
+            if (!views[i].is_ping_message())
+                continue;
+            auto view = views[i].ping();
+            auto ping = PingMessage::Create(messages[i]);
+            if (view.range_count()     != ping->range_count()
+             || view.bearing_count()   != ping->bearing_count()
+             || view.sample_size()     != ping->sample_size()
+             || view.has_gains()       != ping->has_gains()
+             || view.step()            != ping->step()
+             || view.ping_data_size()  != ping->ping_data_size()
+             || view.master_mode()     != ping->master_mode()
+             || view.ping_index()      != ping->ping_index()
+             || view.range()           != ping->range()
+             || view.gain_percent()    != ping->gain_percent()
+             || view.frequency()       != ping->frequency()
+             || view.heading()         != ping->heading()
+             || view.ping_start_time() != ping->ping_start_time()
+             || std::memcmp(view.ping_data(), ping->ping_data(), ping->ping_data_size()) != 0
+             || std::memcmp(view.bearing_data(), ping->bearing_data(),
+                            sizeof(int16_t) * ping->bearing_count()) != 0)
+            {
+                cout << "Ping view " << i << " differs from PingMessage" << endl;
+                return -1;
+            }
+        }
+
+        // FileReader messages are not overwritten by the next read anymore.
+        FileReader reader(filename);
+        auto first  = reader.read_next_message();
+        auto second = reader.read_next_message();
+        if (!first || !second || first == second
+            || first->data() != messages[0]->data() || second->data() != messages[1]->data())
+        {
+            cout << "FileReader overwrote a message still in use" << endl;
+            return -1;
+        }
+    }
+
+    // Views do not copy uncompressed messages.
+    {
+        Recorder recorder;
+        recorder.open("/tmp/mmap_reader_test_raw.oculus", true);
+        recorder.write(messages[0]);
+        recorder.close();
+        MmapFileReader rawReader("/tmp/mmap_reader_test_raw.oculus");
+        auto expected = rawReader.next_item_data().data();
+        auto view = rawReader.read_next_message();
+        if (view.data().data() != expected) {
+            cout << "Message view is not in the mapping" << endl;
+            return -1;
+        }
+    }
+
+    cout << "Success" << endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/ReplayServer.h"
+#include "oculus_driver/SonarDriver.h"
+using namespace oculus;
+
+// Records synthetic pings 10ms apart, then replays them over loopback to a
+// SonarDriver (no sonar needed).
+const unsigned int PingCount = 100;
+
+void write_file(const std::string& filename)
+{
+    const unsigned int beamCount = 256, rangeCount = 100;
+    std::vector<uint8_t> data(sizeof(OculusSimplePingResult2)
+                              + 2*beamCount + beamCount*rangeCount, 0);
+    auto& ping = *reinterpret_cast<OculusSimplePingResult2*>(data.data());
+    ping.fireMessage             = default_ping_config();
+    ping.fireMessage.head.oculusId    = OCULUS_CHECK_ID;
+    ping.fireMessage.head.srcDeviceId = 42;
+    ping.fireMessage.head.msgId       = MsgSimplePingResult;
+    ping.fireMessage.head.msgVersion  = 2;
+    ping.fireMessage.head.payloadSize = data.size() - sizeof(OculusMessageHeader);
+    ping.nBeams      = beamCount;
+    ping.nRanges     = rangeCount;
+    ping.imageOffset = sizeof(OculusSimplePingResult2) + 2*beamCount;
+    ping.imageSize   = beamCount*rangeCount;
+    ping.messageSize = data.size();
+
+    Recorder recorder;
+    recorder.open(filename, true);
+    auto stamp = Message::TimeSource::now();
+    for (unsigned int i = 0; i < PingCount; i++) {
+        ping.pingId = i;
+        recorder.write(Message::Create(data.size(), data.data(),
+                                       stamp + std::chrono::milliseconds(10*i)));
+    }
+}
+
+int replay(const std::string& filename, double speed)
+{
+    AsyncService serverService;
+    ReplayServer::Settings settings;
+    settings.speed = speed;
+    ReplayServer server(serverService.io_service(), spdlog::default_logger(),
+                        filename, settings);
+    server.start();
+    serverService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    std::atomic<unsigned int> pingCount(0);
+    std::atomic<unsigned int> nextId(0);
+    std::atomic<bool> ordered(true);
+    SonarDriver::TimePoint first, last;
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr& ping) {
+        auto id = reinterpret_cast<const OculusSimplePingResult2*>(
+            ping->message()->data().data())->pingId;
+        if (id != nextId++) ordered = false;
+        if (pingCount++ == 0) first = SonarDriver::TimeSource::now();
+        last = SonarDriver::TimeSource::now();
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    ioService.stop();
+    serverService.stop();
+
+    double duration = std::chrono::duration<double>(last - first).count();
+    cout << "speed " << speed << " : received " << pingCount << " pings in "
+         << duration << "s" << endl;
+    if (pingCount != PingCount || !ordered) return -1;
+    // 99 intervals of 10ms
+    if (speed > 0.0 && std::abs(duration - 0.99 / speed) > 0.1) return -1;
+    return 0;
+}
+
+int main()
+{
+    std::string filename = "/tmp/oculus_replay_test.oculus";
+    write_file(filename);
+    if (replay(filename, 0.0) < 0) return -1;
+    if (replay(filename, 1.0) < 0) return -1;
+    if (replay(filename, 4.0) < 0) return -1;
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/utils.h"
+using namespace oculus;
+
+std::vector<uint8_t> make_message(uint16_t deviceId, uint32_t payloadSize)
+{
+    OculusMessageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.oculusId    = OCULUS_CHECK_ID;
+    header.srcDeviceId = deviceId;
+    header.msgId       = MsgSimplePingResult;
+    header.payloadSize = payloadSize;
+
+    std::vector<uint8_t> res(sizeof(header) + payloadSize, 0x53);  // payload full of magic bytes
+    std::memcpy(res.data(), &header, sizeof(header));
+    return res;
+}
+
+int main()
+{
+    const uint16_t deviceId = 42;
+
+    // Garbage, followed by a valid message.
+    std::vector<uint8_t> stream = {0x01, 0x53, 0x4f, 0xff, 0xff, 0x53, 0x53};
+    auto msg = make_message(deviceId, 128);
+    stream.insert(stream.end(), msg.begin(), msg.end());
+
+    auto offset = find_header(stream.data(), stream.size(), deviceId);
+    cout << "header found at " << offset << " (expected 7)" << endl;
+    if (offset != 7) return -1;
+
+    // Truncated candidate at the end of the buffer must be kept.
+    offset = find_header(stream.data(), 8, deviceId);
+    cout << "partial header at " << offset << " (expected 7)" << endl;
+    if (offset != 7) return -1;
+
+    // Implausible payload size is rejected.
+    auto bad = make_message(deviceId, MaxPayloadSize + 1);
+    bad.resize(sizeof(OculusMessageHeader));
+    offset = find_header(bad.data(), bad.size(), deviceId);
+    cout << "implausible header skipped : " << offset << " (expected " << bad.size() << ")" << endl;
+    if (offset != bad.size()) return -1;
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include "oculus_driver/AsyncService.h"
+using namespace oculus;
+
+// Requests real-time scheduling for the io threads. Without the permissions
+// (CAP_SYS_NICE, rtprio limit) the request fails but this must be reported
+// and the service must keep running.
+int main()
+{
+    ThreadSchedulingConfig config;
+    config.policy   = ThreadSchedulingConfig::Fifo;
+    config.priority = 10;
+    config.cpus     = {0};
+    config.jitterProbePeriod = std::chrono::milliseconds(1);
+
+    AsyncService service(2, "sched_test");
+    service.set_scheduling(config);
+    service.start();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    service.stop();
+
+    cout << service.scheduling_report();
+
+    auto reports = service.thread_reports();
+    if (reports.size() != 2)
+        return -1;
+    for (const auto& report : reports) {
+        if (report.cpus != std::vector<int>({0}))
+            return -1;
+        // either applied or an error explains why
+        if (report.policy != "fifo" && report.errors.empty())
+            return -1;
+        if (report.policy == "fifo" && report.priority != 10)
+            return -1;
+    }
+    // about 1000 expirations expected
+    if (service.wakeup_jitter().count() <= 500)
+        return -1;
+
+    // The actual error code is reported.
+    ThreadSchedulingConfig invalid;
+    invalid.cpus = {100000};
+    AsyncService invalidService(1, "sched_invalid");
+    invalidService.set_scheduling(invalid);
+    invalidService.start();
+    invalidService.stop();
+    reports = invalidService.thread_reports();
+    if (reports.size() != 1 || reports[0].errors.size() != 1
+        || reports[0].errors[0].find("Invalid argument") == std::string::npos)
+    {
+        cout << "Unexpected affinity error report" << endl;
+        return -1;
+    }
+    return 0;
+}
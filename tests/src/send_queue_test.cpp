@@ -0,0 +1,83 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Bursts of config changes (like an auto-gain loop) must not block the caller
+// and only the latest config of a burst has to reach the sonar.
+int main()
+{
+    AsyncService simService;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger());
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    ioService.start();
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!sonar.connected()) {
+        cout << "Could not connect to the simulator" << endl;
+        return -1;
+    }
+
+    const int burstSize = 1000;
+    std::vector<std::future<bool>> results;
+    auto config = default_ping_config();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < burstSize; i++) {
+        config.range = 1.0 + 0.01*i;
+        results.push_back(sonar.async_send_ping_config(config));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::size_t successCount = 0;
+    bool lastWritten = false;
+    for (auto& result : results) {
+        lastWritten = result.get();
+        if (lastWritten) successCount++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto stats = sonar.send_stats();
+    cout << "Burst of " << burstSize << " configs queued in "
+         << std::chrono::duration<double, std::micro>(t1 - t0).count() / burstSize
+         << "us per call, " << stats.sent << " sent, " << stats.coalesced
+         << " coalesced, " << stats.failed << " failed" << endl;
+    cout << "Simulator range : " << simulator.ping_config().range
+         << " (expected " << config.range << ")" << endl;
+    // Only the configs actually written report success, the last one is
+    // always written.
+    if (!lastWritten || successCount > stats.sent || stats.failed != 0)
+        return -1;
+    if (stats.sent + stats.coalesced != stats.requested || stats.sent >= burstSize)
+        return -1;
+    if (simulator.ping_config().range != config.range)
+        return -1;
+
+    // Not connected anymore : the future must be set to false.
+    sonar.close_connection();
+    auto result = sonar.async_send_ping_config(config);
+    if (result.wait_for(std::chrono::seconds(1)) != std::future_status::ready || result.get()) {
+        cout << "Send after disconnection not reported as failed" << endl;
+        return -1;
+    }
+    if (sonar.send_ping_config(config)) {
+        cout << "send_ping_config succeeded without a connection" << endl;
+        return -1;
+    }
+
+    ioService.stop();
+    simService.stop();
+    return 0;
+}
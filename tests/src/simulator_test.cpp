@@ -0,0 +1,93 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Connects a SonarDriver to a SonarSimulator over loopback (no sonar needed).
+int run(SonarClient::FramingMode mode, bool use16bits)
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 100.0;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger(), settings);
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    sonar.set_framing_mode(mode);
+
+    std::atomic<int> pingCount(0);
+    std::atomic<int> badCount(0);
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr& ping) {
+        if (ping->sample_size() != (use16bits ? 2 : 1) || ping->range_count() != 512)
+            badCount++;
+        pingCount++;
+    });
+    sonar.connect_callbacks().append([&]() {
+        auto config = default_ping_config();
+        if (use16bits)
+            config.flags |= 0x02;
+        sonar.send_ping_config(config);
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    ioService.stop();
+    simService.stop();
+
+    cout << "Framing mode " << mode << ", 16 bits " << use16bits
+         << " : received " << pingCount << " pings, sent " << simulator.ping_count()
+         << ", " << badCount << " unexpected" << endl;
+    if (pingCount < 50)
+        return -1;
+    return badCount < 10 ? 0 : -1;
+}
+
+// The simulator is destroyed in its io thread with a client connected : its
+// pending handlers (accept, status, ping timer, reads, writes) must be
+// ignored.
+int destroy_while_connected()
+{
+    AsyncService simService;
+    SonarSimulator::Settings settings;
+    settings.pingRate = 100.0;
+    auto simulator = std::make_unique<SonarSimulator>(simService.io_service(),
+                                                      spdlog::default_logger(), settings);
+    simulator->start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    std::atomic<int> pingCount(0);
+    sonar.ping_callbacks().append([&](const PingMessage::ConstPtr&) { pingCount++; });
+    sonar.connect_callbacks().append([&]() {
+        sonar.send_ping_config(default_ping_config());
+    });
+    ioService.start();
+    sonar.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    boost::asio::post(*simService.io_service(), [&]() { simulator.reset(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ioService.stop();
+    simService.stop();
+
+    cout << "Destroyed while connected : received " << pingCount << " pings" << endl;
+    return !simulator && pingCount > 0 ? 0 : -1;
+}
+
+int main()
+{
+    if (run(SonarClient::PerMessage, false) < 0) return -1;
+    if (run(SonarClient::Batched, true) < 0) return -1;
+    if (destroy_while_connected() < 0) return -1;
+    return 0;
+}
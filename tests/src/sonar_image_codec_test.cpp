@@ -0,0 +1,139 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "oculus_driver/AsyncRecorder.h"
+#include "oculus_driver/Recorder.h"
+#include "oculus_driver/SonarImageCodec.h"
+#include "test_messages.h"
+using namespace oculus;
+
+int main()
+{
+    // Round trip of every supported layout, with keyframes.
+    struct Case { uint16_t beams; uint16_t ranges; uint8_t sampleSize; bool gains; };
+    for (auto c : {Case{256, 300, 1, false}, Case{512, 200, 1, true},
+                   Case{256, 300, 2, false}, Case{512, 150, 2, true}, Case{1, 5, 1, false}})
+    {
+        SonarImageEncoder encoder(4);
+        SonarImageDecoder decoder;
+        std::size_t rawSize = 0, codedSize = 0;
+        std::vector<std::vector<uint8_t>> encoded;
+        for (unsigned int i = 0; i < 10; i++) {
+            auto ping = make_ping(i, c.beams, c.ranges, c.sampleSize, c.gains);
+            std::vector<uint8_t> coded;
+            if (!encoder.encode(ping->data().data(), ping->data().size(), coded)) {
+                cout << "Ping not supported by the encoder" << endl;
+                return -1;
+            }
+            if (SonarImageDecoder::is_keyframe(coded.data(), coded.size()) != (i % 4 == 0)) {
+                cout << "Unexpected keyframe flag on ping " << i << endl;
+                return -1;
+            }
+            Message::Buffer decoded(ping->data().size());
+            decoder.decode(coded.data(), coded.size(), decoded.data(), decoded.size());
+            if (decoded != ping->data()) {
+                cout << "Round trip failed (" << c.beams << " beams, "
+                     << (int)c.sampleSize << " bytes, gains " << c.gains
+                     << ", ping " << i << ")" << endl;
+                return -1;
+            }
+            rawSize   += ping->data().size();
+            codedSize += coded.size();
+            encoded.push_back(coded);
+        }
+        cout << c.beams << 'x' << c.ranges << ' ' << 8*(int)c.sampleSize << "-bit"
+             << (c.gains ? " gains" : "") << " ratio : " << (double)rawSize / codedSize << endl;
+
+        // Pings relative to a missing reference must be rejected.
+        SonarImageDecoder fresh;
+        std::vector<uint8_t> decoded(rawSize);
+        bool thrown = false;
+        try {
+            fresh.decode(encoded[1].data(), encoded[1].size(), decoded.data(),
+                         make_ping(1, c.beams, c.ranges, c.sampleSize, c.gains)->data().size());
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            cout << "Missing reference not detected" << endl;
+            return -1;
+        }
+    }
+
+    // Truncated data is detected.
+    {
+        auto ping = make_ping(0, 256, 100, 1, false);
+        SonarImageEncoder encoder;
+        std::vector<uint8_t> coded;
+        encoder.encode(ping->data().data(), ping->data().size(), coded);
+        coded.resize(coded.size() / 2);
+        std::vector<uint8_t> decoded(ping->data().size());
+        bool thrown = false;
+        try {
+            SonarImageDecoder decoder;
+            decoder.decode(coded.data(), coded.size(), decoded.data(), decoded.size());
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            cout << "Truncated data not detected" << endl;
+            return -1;
+        }
+    }
+
+    // Recorded with both recorders, pings mixed with other messages.
+    std::vector<Message::ConstPtr> messages;
+    for (unsigned int i = 0; i < 150; i++) {
+        messages.push_back(make_ping(i, 256, 200, 1 + (i / 75), true));
+        if (i % 10 == 0)
+            messages.push_back(make_status(i));
+    }
+    const std::string filename = "/tmp/sonar_image_codec_test.oculus";
+    {
+        Recorder recorder;
+        recorder.set_compression(SonarImage);
+        recorder.open(filename, true);
+        for (const auto& msg : messages) {
+            recorder.write(msg);
+        }
+        recorder.close();
+    }
+    if (!check_file(filename, messages, SonarImage))
+        return -1;
+    {
+        AsyncRecorder recorder(32, AsyncRecorder::Block, 64*1024);
+        recorder.set_compression(SonarImage, -1, 2);
+        recorder.open(filename);
+        for (const auto& msg : messages) {
+            recorder.write(msg);
+        }
+        recorder.close();
+        auto stats = recorder.stats();
+        cout << "AsyncRecorder : " << stats.rawBytes << " -> " << stats.bytes << " bytes" << endl;
+        if (stats.written != messages.size()) {
+            cout << "AsyncRecorder wrote " << stats.written << " messages" << endl;
+            return -1;
+        }
+    }
+    if (!check_file(filename, messages, SonarImage))
+        return -1;
+
+    // Rewinding restarts decoding from the first keyframe.
+    {
+        FileReader reader(filename);
+        for (int i = 0; i < 10; i++) reader.read_next_message();
+        reader.rewind();
+        auto msg = reader.read_next_message();
+        if (!msg || msg->data() != messages[0]->data()) {
+            cout << "Read after rewind failed" << endl;
+            return -1;
+        }
+    }
+
+    cout << "Success" << endl;
+    return 0;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "oculus_driver/Compression.h"
+#include "oculus_driver/OculusMessage.h"
+#include "oculus_driver/Recorder.h"
+
+// Messages and file checks shared by the recorder and reader tests.
+
+// Ping like payload : smooth intensities with a little noise, compressible.
+inline oculus::Message::ConstPtr make_message(unsigned int index, unsigned int payloadSize)
+{
+    using namespace oculus;
+    std::vector<uint8_t> data(sizeof(OculusMessageHeader) + payloadSize);
+    OculusMessageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.oculusId    = OCULUS_CHECK_ID;
+    header.msgId       = MsgSimplePingResult;
+    header.payloadSize = payloadSize;
+    std::memcpy(data.data(), &header, sizeof(header));
+    uint32_t seed = index;
+    for (unsigned int i = 0; i < payloadSize; i++) {
+        seed = 1664525*seed + 1013904223;
+        data[sizeof(header) + i] = ((i / 64) % 128) + ((seed >> 28) & 0x3);
+    }
+    auto stamp = Message::TimePoint(std::chrono::milliseconds(1000 + index));
+    return Message::Create(data.size(), data.data(), stamp);
+}
+
+// Version 2 ping with a speckled image and a few moving targets, 100ms
+// apart. The range changes at ping 150. extraSize bytes are appended after
+// the image.
+inline oculus::Message::ConstPtr make_ping(unsigned int index,
+                                           uint16_t beamCount  = 64,
+                                           uint16_t rangeCount = 50,
+                                           uint8_t  sampleSize = 1,
+                                           bool     gains      = false,
+                                           unsigned int extraSize = 0)
+{
+    using namespace oculus;
+    uint32_t imageOffset = sizeof(OculusSimplePingResult2) + sizeof(int16_t) * beamCount;
+    uint32_t lineSize    = (gains ? 4 : 0) + sampleSize * beamCount;
+    std::vector<uint8_t> data(imageOffset + lineSize * rangeCount + extraSize, 0);
+
+    OculusSimplePingResult2 ping;
+    std::memset(&ping, 0, sizeof(ping));
+    ping.fireMessage.head.oculusId    = OCULUS_CHECK_ID;
+    ping.fireMessage.head.msgId       = MsgSimplePingResult;
+    ping.fireMessage.head.msgVersion  = 2;
+    ping.fireMessage.head.payloadSize = data.size() - sizeof(OculusMessageHeader);
+    ping.fireMessage.masterMode = 1;
+    ping.fireMessage.range      = index < 150 ? 10.0 : 20.0;
+    ping.fireMessage.gain       = 50.0;
+    ping.pingId        = 1000 + index;
+    ping.pingStartTime = 0.1 * index;
+    ping.frequency     = 1.2e6;
+    ping.heading       = 0.1 * index;
+    ping.dataSize      = sampleSize == 2 ? ImageData16Bit : ImageData8Bit;
+    ping.nRanges       = rangeCount;
+    ping.nBeams        = beamCount;
+    ping.imageOffset   = imageOffset;
+    ping.imageSize     = lineSize * rangeCount;
+    ping.messageSize   = data.size();
+    std::memcpy(data.data(), &ping, sizeof(ping));
+
+    auto bearings = reinterpret_cast<int16_t*>(data.data() + sizeof(ping));
+    for (unsigned int b = 0; b < beamCount; b++) {
+        bearings[b] = -6500 + (13000 * b) / beamCount;
+    }
+
+    uint32_t seed = 12345 + index;
+    uint8_t* line = data.data() + imageOffset;
+    for (unsigned int r = 0; r < rangeCount; r++, line += lineSize) {
+        uint8_t* samples = line;
+        if (gains) {
+            uint32_t gain = 1000 + 3*r;
+            std::memcpy(line, &gain, sizeof(gain));
+            samples += 4;
+        }
+        for (unsigned int b = 0; b < beamCount; b++) {
+            seed = 1664525*seed + 1013904223;
+            double value = 0.4 * std::exp(-2.0 * r / rangeCount)
+                         * (1.0 + 0.25 * ((seed >> 16) & 0xff) / 255.0);
+            if (std::abs((int)r - (int)((index * 3) % rangeCount)) < 4 && (b % 50) < 6)
+                value = 0.95;
+            if (sampleSize == 2) {
+                uint16_t v = value * 65535;
+                std::memcpy(samples + 2*b, &v, sizeof(v));
+            }
+            else {
+                samples[b] = value * 255;
+            }
+        }
+    }
+    auto stamp = Message::TimePoint(std::chrono::milliseconds(1000 + 100*index));
+    return Message::Create(data.size(), data.data(), stamp);
+}
+
+inline oculus::Message::ConstPtr make_status(unsigned int index)
+{
+    using namespace oculus;
+    std::vector<uint8_t> data(sizeof(OculusMessageHeader) + 17, index & 0xff);
+    OculusMessageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.oculusId    = OCULUS_CHECK_ID;
+    header.msgId       = MsgUserConfig;
+    header.payloadSize = 17;
+    std::memcpy(data.data(), &header, sizeof(header));
+    return Message::Create(data.size(), data.data());
+}
+
+// Reads back a recording and compares it to the written messages. The
+// message items must use the given compression (SonarImage falls back to
+// QCompress for the messages the encoder does not support).
+inline bool check_file(const std::string& filename,
+                       const std::vector<oculus::Message::ConstPtr>& messages,
+                       uint16_t compression)
+{
+    using namespace oculus;
+    FileReader reader(filename);
+    unsigned int count = 0, imageCount = 0;
+    while (reader.next_item_header().type != 0) {
+        const auto& item = reader.next_item_header();
+        if (item.type == blueprint::rt_oculusSonar) {
+            if (item.compression == SonarImage)
+                imageCount++;
+            if (item.compression != compression
+                && !(compression == SonarImage && item.compression == QCompress))
+            {
+                std::cout << filename << " : item compression " << item.compression
+                          << ", expected " << compression << std::endl;
+                return false;
+            }
+        }
+        auto msg = reader.read_next_message();
+        if (!msg) break;
+        if (count >= messages.size() || msg->data() != messages[count]->data()
+            || msg->timestamp() != messages[count]->timestamp())
+        {
+            std::cout << filename << " : message " << count << " mismatch" << std::endl;
+            return false;
+        }
+        count++;
+    }
+    if (count != messages.size()) {
+        std::cout << filename << " : read " << count << " messages, expected "
+                  << messages.size() << std::endl;
+        return false;
+    }
+    if (compression == SonarImage && imageCount == 0) {
+        std::cout << filename << " : no SonarImage item" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <thread>
+#include <set>
+#include <mutex>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+using namespace oculus;
+
+// Two simulated sonars and their drivers all running on the same pool of
+// threads. Callbacks of a single driver must never run concurrently (they
+// are serialized by the client strand) even though the pool has 4 threads.
+int main()
+{
+    AsyncService pool(4, "pool_test");
+    std::atomic<int> initCount(0);
+    pool.set_thread_init([&](unsigned int) { initCount++; });
+
+    SonarSimulator::Settings settings;
+    settings.pingRate = 50.0;
+    SonarSimulator::Config config1, config2;
+    config1.address = "127.0.0.1";
+    config2.address = "127.0.0.2";
+    config2.deviceId = config1.deviceId + 1;
+    SonarSimulator simulator1(pool.io_service(), spdlog::default_logger(), settings, config1);
+    SonarSimulator simulator2(pool.io_service(), spdlog::default_logger(), settings, config2);
+
+    auto listener = std::make_shared<StatusListener>(pool.io_service(), spdlog::default_logger());
+    SonarDriver sonar1(pool.io_service(), spdlog::default_logger(), listener, config1.deviceId);
+    SonarDriver sonar2(pool.io_service(), spdlog::default_logger(), listener, config2.deviceId);
+
+    struct Counters {
+        std::atomic<int> pings      = 0;
+        std::atomic<int> inCallback = 0;
+        std::atomic<int> overlaps   = 0;
+    };
+    Counters counters[2];
+    std::mutex threadsMutex;
+    std::set<std::thread::id> threads;
+
+    SonarDriver* sonars[2] = {&sonar1, &sonar2};
+    for (int i = 0; i < 2; i++) {
+        auto& c = counters[i];
+        sonars[i]->ping_callbacks().append([&](const PingMessage::ConstPtr&) {
+            if (c.inCallback.fetch_add(1) != 0)
+                c.overlaps++;
+            {
+                std::lock_guard<std::mutex> lock(threadsMutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            c.pings++;
+            c.inCallback--;
+        });
+        auto sonar = sonars[i];
+        sonar->connect_callbacks().append([sonar]() {
+            sonar->send_ping_config(default_ping_config());
+        });
+    }
+
+    simulator1.start();
+    simulator2.start();
+    pool.start();
+    sonar1.reset_connection();
+    sonar2.reset_connection();
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    pool.stop();
+
+    cout << "Thread init called " << initCount << " times, callbacks ran in "
+         << threads.size() << " threads" << endl;
+    for (int i = 0; i < 2; i++) {
+        cout << "Sonar " << i + 1 << " : " << counters[i].pings << " pings, "
+             << counters[i].overlaps << " concurrent callbacks" << endl;
+        if (counters[i].pings < 50 || counters[i].overlaps != 0)
+            return -1;
+    }
+    return initCount == 4 ? 0 : -1;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <thread>
+using namespace std;
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/AsyncService.h"
+#include "oculus_driver/SonarDriver.h"
+#include "oculus_driver/SonarSimulator.h"
+#include "oculus_driver/TriggerScheduler.h"
+using namespace oculus;
+
+void print_stats(const std::string& name, const TriggerScheduler& scheduler)
+{
+    auto stats = scheduler.stats();
+    cout << name << " : " << stats.triggers << " triggers, " << stats.pings << " pings, "
+         << stats.lost << " lost, " << stats.skipped << " skipped" << endl
+         << "- trigger to ping : " << scheduler.trigger_to_ping().summary() << endl
+         << "- lateness        : " << scheduler.lateness().summary() << endl;
+}
+
+// Network trigger mode against a SonarSimulator (one ping per fire message).
+int main()
+{
+    AsyncService simService;
+    SonarSimulator simulator(simService.io_service(), spdlog::default_logger());
+    simulator.start();
+    simService.start();
+
+    AsyncService ioService;
+    SonarDriver sonar(ioService.io_service(), spdlog::default_logger());
+    TriggerScheduler scheduler(sonar, spdlog::default_logger());
+    ioService.start();
+    sonar.reset_connection();
+    for (int i = 0; i < 50 && !sonar.connected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!sonar.connected()) {
+        cout << "Could not connect to the simulator" << endl;
+        return -1;
+    }
+
+    scheduler.start_pipelined(default_ping_config());
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    scheduler.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    print_stats("Pipelined", scheduler);
+    auto stats = scheduler.stats();
+    if (stats.pings < 100 || stats.lost != 0 || stats.triggers - stats.pings > 1)
+        return -1;
+
+    scheduler.reset_statistics();
+    scheduler.start_periodic(default_ping_config(), std::chrono::milliseconds(50));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1020));
+    scheduler.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    print_stats("Periodic 20Hz", scheduler);
+    stats = scheduler.stats();
+    if (stats.pings < 18 || stats.pings > 22 || stats.lost != 0)
+        return -1;
+
+    scheduler.reset_statistics();
+    scheduler.start_manual(default_ping_config());
+    auto pingCount = simulator.ping_count();
+    scheduler.trigger_at(TriggerScheduler::Clock::now() + std::chrono::milliseconds(100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    for (int i = 0; i < 3; i++) {
+        scheduler.trigger();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    print_stats("Manual", scheduler);
+    stats = scheduler.stats();
+    if (stats.pings != 4 || simulator.ping_count() - pingCount != 4)
+        return -1;
+
+    // Destroyed with its handlers still pending in the strand.
+    for (int i = 0; i < 10; i++) {
+        TriggerScheduler transient(sonar, spdlog::default_logger());
+        transient.start_pipelined(default_ping_config());
+        transient.trigger();
+        transient.stop();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ioService.stop();
+    simService.stop();
+    return 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/ReplayServer.h"
+
+using namespace oculus;
+
+static void print_usage(const char* name)
+{
+    std::cout << "Usage : " << name << " [options] <file.oculus>\n"
+        << "  --speed <x>        replay speed multiplier (default : 1)\n"
+        << "  --fast             replay as fast as the client reads\n"
+        << "  --loop             restart from the beginning at the end of the file\n"
+        << "  --address <ip>     advertised address (default : 127.0.0.1)\n"
+        << "  --status-to <ip>   status destination (default : 127.0.0.1,\n"
+        << "                     use 255.255.255.255 to broadcast)\n";
+}
+
+int main(int argc, char** argv)
+{
+    ReplayServer::Settings settings;
+    ReplayServer::Config   config;
+    std::string            filename;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+        if (arg == "--speed")          settings.speed       = std::stod(next());
+        else if (arg == "--fast")      settings.speed       = 0.0;
+        else if (arg == "--loop")      settings.loop        = true;
+        else if (arg == "--address")   config.address       = next();
+        else if (arg == "--status-to") config.statusAddress = next();
+        else if (arg[0] != '-' && filename.empty()) filename = arg;
+        else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : -1;
+        }
+    }
+    if (filename.empty()) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    auto service = std::make_shared<ReplayServer::IoService>();
+    ReplayServer server(service, spdlog::default_logger(), filename, settings, config);
+    server.start();
+
+    boost::asio::signal_set signals(*service, SIGINT, SIGTERM);
+    signals.async_wait([&](const boost::system::error_code&, int) {
+        server.stop();
+        service->stop();
+    });
+
+    service->run();
+
+    std::cout << "Replayed " << server.replayed_count() << " messages ("
+              << server.dropped_count() << " dropped, "
+              << server.loop_count() << " loops)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * oculus_driver driver library for Blueprint Subsea Oculus sonar.
+ * Copyright (C) 2020 ENSTA-Bretagne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "oculus_driver/SonarSimulator.h"
+
+using namespace oculus;
+
+static void print_usage(const char* name)
+{
+    std::cout << "Usage : " << name << " [options]\n"
+        << "  --rate <Hz>        ping rate (default : rate requested by the client)\n"
+        << "  --beams <n>        beam count (default : 256 or 512 as requested)\n"
+        << "  --ranges <n>       range count (default : 512)\n"
+        << "  --8bit / --16bit   sample size (default : as requested)\n"
+        << "  --gains / --no-gains  send gains (default : as requested)\n"
+        << "  --address <ip>     advertised address (default : 127.0.0.1)\n"
+        << "  --status-to <ip>   status destination (default : 127.0.0.1,\n"
+        << "                     use 255.255.255.255 to broadcast)\n"
+        << "  --device-id <id>   device id (default : 1)\n";
+}
+
+int main(int argc, char** argv)
+{
+    SonarSimulator::Settings settings;
+    SonarSimulator::Config   config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+        if (arg == "--rate")            settings.pingRate   = std::stod(next());
+        else if (arg == "--beams")      settings.beamCount  = std::stoi(next());
+        else if (arg == "--ranges")     settings.rangeCount = std::stoi(next());
+        else if (arg == "--8bit")       settings.sampleSize = 1;
+        else if (arg == "--16bit")      settings.sampleSize = 2;
+        else if (arg == "--gains")      settings.sendGains  = 1;
+        else if (arg == "--no-gains")   settings.sendGains  = 0;
+        else if (arg == "--address")    config.address       = next();
+        else if (arg == "--status-to")  config.statusAddress = next();
+        else if (arg == "--device-id")  config.deviceId      = std::stoi(next());
+        else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : -1;
+        }
+    }
+
+    auto service = std::make_shared<SonarSimulator::IoService>();
+    SonarSimulator simulator(service, spdlog::default_logger(), settings, config);
+    simulator.start();
+
+    boost::asio::signal_set signals(*service, SIGINT, SIGTERM);
+    signals.async_wait([&](const boost::system::error_code&, int) {
+        simulator.stop();
+        service->stop();
+    });
+
+    service->run();
+
+    std::cout << "Sent " << simulator.sent_count() << " messages ("
+              << simulator.dropped_count() << " dropped)" << std::endl;
+    return 0;
+}